@@ -0,0 +1,317 @@
+#include <bench/benchmark.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <profiler/memory.h>
+#include <profiler/profiler.h>
+#include <solver/cbs_solver.h>
+#include <solver/dispatch_simulator.h>
+#include <solver/lagrangian_solver.h>
+#include <solver/meet_pass_planner.h>
+
+#if USE_CPLEX
+    #include <solver/sequential_solver.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+    // Steps faster than this, in milliseconds, are too noisy to be compared
+    constexpr double min_comparable_time = 1.0;
+    
+    // The solvers print their progress, which is of no interest while benchmarking
+    struct silenced_output {
+        silenced_output() { std::cout.setstate(std::ios::failbit); }
+        ~silenced_output() { std::cout.clear(); }
+    };
+    
+    // Sorted names of the files ending in suffix, or of the subfolders if suffix is empty, in the given folder
+    auto folder_entries(const std::string& folder, const std::string& suffix) -> bv<std::string> {
+        auto names = bv<std::string>();
+        auto* dir = opendir(folder.c_str());
+        
+        if(dir == nullptr) {
+            return names;
+        }
+        
+        while(auto* entry = readdir(dir)) {
+            auto name = std::string(entry->d_name);
+            auto path = folder + "/" + name;
+            struct stat info;
+            
+            if(name == "." || name == ".." || stat(path.c_str(), &info) != 0) {
+                continue;
+            }
+            
+            if(suffix.empty() && S_ISDIR(info.st_mode)) {
+                names.push_back(path);
+            } else if(!suffix.empty() && S_ISREG(info.st_mode) && name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                names.push_back(path);
+            }
+        }
+        
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        
+        return names;
+    }
+    
+    auto total_cost(const boost::optional<bv<path>>& paths) -> boost::optional<double> {
+        if(!paths) {
+            return boost::none;
+        }
+        
+        return std::accumulate(paths->begin(), paths->end(), 0.0, [] (double cost, const path& p) { return cost + p.cost; });
+    }
+}
+
+benchmark::stats::stats(bv<double> samples) {
+    assert(!samples.empty());
+    
+    std::sort(samples.begin(), samples.end());
+    
+    // Nearest-rank percentile
+    auto percentile = [&] (double q) {
+        auto rank = static_cast<unsigned int>(std::ceil(q * samples.size()));
+        return samples.at(std::max(rank, 1u) - 1u);
+    };
+    
+    median = percentile(0.5);
+    p10 = percentile(0.1);
+    p90 = percentile(0.9);
+    min = samples.front();
+    max = samples.back();
+}
+
+auto benchmark::find_instances(const std::string& folder) -> bv<std::string> {
+    auto instances = bv<std::string>();
+    
+    for(const auto& file_name : folder_entries(folder, ".json")) {
+        if(file_name.compare(folder.size() + 1, 7, "example") == 0) {
+            instances.push_back(file_name);
+        }
+    }
+    
+    for(const auto& file_name : folder_entries(folder + "/normal_tw", ".json")) {
+        instances.push_back(file_name);
+    }
+    
+    for(const auto& subfolder : folder_entries(folder + "/tight_tw", "")) {
+        for(const auto& file_name : folder_entries(subfolder, ".json")) {
+            instances.push_back(file_name);
+        }
+    }
+    
+    for(const auto& file_name : folder_entries(folder + "/synthetic", ".json")) {
+        instances.push_back(file_name);
+    }
+    
+    return instances;
+}
+
+auto benchmark::run(const std::string& file_name) const -> instance_result {
+    auto res = instance_result();
+    
+    res.file_name = file_name;
+    
+    // Without a reset, the peak would be the one of the largest instance run so far
+    if(!memory::reset_peak_rss()) {
+        std::cerr << "RAS_BENCH >> Cannot reset the peak resident set size: it is the one of the whole process" << std::endl;
+    }
+    
+    for(auto rep = 0u; rep < warmup + repetitions; rep++) {
+        auto objectives = bv<std::pair<std::string, boost::optional<double>>>();
+        
+        profiler::clear();
+        
+        {
+            auto quiet = silenced_output();
+            auto d = data(file_name, p);
+            
+            {
+                profiler::span phase("lagrangian/solve");
+                
+                auto s = lagrangian_solver(d);
+                
+                objectives.push_back(std::make_pair("lagrangian", total_cost(s.solve())));
+            }
+            
+            {
+                profiler::span phase("cbs/solve");
+                
+                auto s = cbs_solver(d);
+                
+                objectives.push_back(std::make_pair("cbs", total_cost(s.solve())));
+            }
+            
+            {
+                profiler::span phase("meet_pass/solve");
+                
+                auto s = meet_pass_planner(d);
+                
+                objectives.push_back(std::make_pair("meet_pass", total_cost(s.solve())));
+            }
+            
+            {
+                profiler::span phase("dispatch_simulator/solve");
+                
+                auto s = dispatch_simulator(d);
+                
+                objectives.push_back(std::make_pair("dispatch_simulator", total_cost(s.solve())));
+            }
+            
+            #if USE_CPLEX
+                {
+                    profiler::span phase("sequential/solve");
+                    
+                    auto s = sequential_solver(d);
+                    
+                    objectives.push_back(std::make_pair("sequential", total_cost(s.solve_sequentially())));
+                }
+            #endif
+            
+            res.n_nodes = std::accumulate(d.gr.n_nodes.begin(), d.gr.n_nodes.end(), 0ul);
+            res.n_arcs = std::accumulate(d.gr.n_arcs.begin(), d.gr.n_arcs.end(), 0ul);
+        }
+        
+        if(rep < warmup) {
+            continue;
+        }
+        
+        res.objectives = objectives;
+        
+        for(const auto& step : profiler::totals()) {
+            auto it = std::find_if(res.samples.begin(), res.samples.end(), [&] (const std::pair<std::string, bv<double>>& r) { return r.first == step.first; });
+            
+            if(it == res.samples.end()) {
+                res.samples.push_back(std::make_pair(step.first, bv<double>({step.second})));
+            } else {
+                it->second.push_back(step.second);
+            }
+        }
+    }
+    
+    res.peak_rss_mb = memory::peak_rss() / (1024.0 * 1024.0);
+    
+    return res;
+}
+
+auto benchmark::write(const bv<instance_result>& results, const std::string& file_name) const -> void {
+    std::ofstream out(file_name, std::ios::out);
+    
+    out << std::fixed << std::setprecision(3);
+    out << "{" << std::endl;
+    out << "    \"warmup\": " << warmup << "," << std::endl;
+    out << "    \"repetitions\": " << repetitions << "," << std::endl;
+    out << "    \"instances\": [" << std::endl;
+    
+    for(auto k = 0u; k < results.size(); k++) {
+        const auto& res = results.at(k);
+        
+        out << "        {" << std::endl;
+        out << "            \"file\": \"" << res.file_name << "\"," << std::endl;
+        out << "            \"nodes\": " << res.n_nodes << "," << std::endl;
+        out << "            \"arcs\": " << res.n_arcs << "," << std::endl;
+        out << "            \"peak_rss_mb\": " << res.peak_rss_mb << "," << std::endl;
+        out << "            \"objectives\": {";
+        
+        for(auto j = 0u; j < res.objectives.size(); j++) {
+            const auto& obj = res.objectives.at(j);
+            
+            out << (j > 0u ? ", " : "") << "\"" << obj.first << "\": ";
+            
+            if(obj.second) {
+                out << *obj.second;
+            } else {
+                out << "null";
+            }
+        }
+        
+        out << "}," << std::endl;
+        out << "            \"steps\": {" << std::endl;
+        
+        for(auto j = 0u; j < res.samples.size(); j++) {
+            auto st = stats(res.samples.at(j).second);
+            
+            out << "                \"" << res.samples.at(j).first << "\": {";
+            out << "\"median_ms\": " << st.median << ", \"p10_ms\": " << st.p10 << ", \"p90_ms\": " << st.p90 << ", ";
+            out << "\"min_ms\": " << st.min << ", \"max_ms\": " << st.max << "}";
+            out << (j + 1 < res.samples.size() ? "," : "") << std::endl;
+        }
+        
+        out << "            }" << std::endl;
+        out << "        }" << (k + 1 < results.size() ? "," : "") << std::endl;
+    }
+    
+    out << "    ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+auto benchmark::compare(const std::string& baseline_file, const std::string& report_file, double threshold) -> bool {
+    using namespace boost::property_tree;
+    
+    auto baseline = ptree();
+    auto report = ptree();
+    auto n_regressions = 0u;
+    
+    read_json(baseline_file, baseline);
+    read_json(report_file, report);
+    
+    for(const auto& instance : report.get_child("instances")) {
+        auto file_name = instance.second.get<std::string>("file");
+        auto base = std::find_if(baseline.get_child("instances").begin(), baseline.get_child("instances").end(), [&] (const ptree::value_type& b) {
+            return b.second.get<std::string>("file") == file_name;
+        });
+        
+        if(base == baseline.get_child("instances").end()) {
+            std::cout << "RAS_BENCH >> " << file_name << ": not in the baseline" << std::endl;
+            continue;
+        }
+        
+        for(const auto& obj : instance.second.get_child("objectives")) {
+            auto base_obj = base->second.get_optional<std::string>("objectives." + obj.first);
+            
+            if(base_obj && *base_obj != obj.second.data()) {
+                std::cout << "RAS_BENCH >> " << file_name << " " << obj.first << ": objective " << *base_obj << " -> " << obj.second.data() << std::endl;
+            }
+        }
+        
+        // Step names contain no '.', so they can be used as keys of a path
+        for(const auto& step : instance.second.get_child("steps")) {
+            auto base_time = base->second.get_optional<double>(ptree::path_type("steps." + step.first + ".median_ms"));
+            auto time = step.second.get<double>("median_ms");
+            
+            if(!base_time || std::max(*base_time, time) < min_comparable_time) {
+                continue;
+            }
+            
+            auto change = 100 * (time - *base_time) / std::max(*base_time, min_comparable_time);
+            
+            if(std::abs(change) <= threshold) {
+                continue;
+            }
+            
+            std::cout << "RAS_BENCH >> " << file_name << " " << step.first << ": " << *base_time << " ms -> " << time << " ms (";
+            std::cout << (change > 0 ? "+" : "") << change << "%)" << (change > 0 ? " REGRESSION" : "") << std::endl;
+            
+            if(change > 0) {
+                n_regressions++;
+            }
+        }
+    }
+    
+    std::cout << "RAS_BENCH >> " << n_regressions << " regressions over " << threshold << "%" << std::endl;
+    
+    return (n_regressions == 0u);
+}
@@ -0,0 +1,85 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <data/array.h>
+#include <params/params.h>
+
+#include <boost/optional.hpp>
+
+#include <string>
+#include <utility>
+
+/*! \brief This class times the construction of the data and the available solvers over a set of instances. Each instance is first
+ *  run a few times without recording anything, to warm up the caches and the allocator, and then a given number of times. Every
+ *  phase recorded by the profiler (reading the JSON file, building the network and the graphs, cleaning them up, building the model...)
+ *  is a step of the benchmark, together with the whole data construction and each solver; step times are wall times, so a phase
+ *  running in several threads at once counts once. Reports are written in JSON, and a report can be compared to a baseline to spot
+ *  the steps which became slower.
+ */
+struct benchmark {
+    /*! \brief Summary of the times, in milliseconds, taken by a step over all the repetitions */
+    struct stats {
+        double median;
+        double p10;
+        double p90;
+        double min;
+        double max;
+        
+        /*! Empty constructor */
+        stats() {}
+        
+        /*! Computes the statistics of the samples, which must not be empty */
+        stats(bv<double> samples);
+    };
+    
+    /*! \brief Results of the benchmark on one instance */
+    struct instance_result {
+        /*! Name of the JSON data file */
+        std::string file_name;
+        
+        /*! Total number of nodes in the trains' graphs */
+        unsigned long n_nodes;
+        
+        /*! Total number of arcs in the trains' graphs */
+        unsigned long n_arcs;
+        
+        /*! Largest resident set size of the process while running the instance, in megabytes */
+        double peak_rss_mb;
+        
+        /*! For each step, the milliseconds it took in each repetition */
+        bv<std::pair<std::string, bv<double>>> samples;
+        
+        /*! For each solver, the cost of the solution it found in the last repetition, or boost::none if it found none */
+        bv<std::pair<std::string, boost::optional<double>>> objectives;
+    };
+    
+    /*! Program params, without the results file: the solvers run by the benchmark write no results rows */
+    params p;
+    
+    /*! Number of runs of each instance which are not recorded */
+    unsigned int warmup;
+    
+    /*! Number of recorded runs of each instance */
+    unsigned int repetitions;
+    
+    /*! Basic constructor */
+    benchmark(const params& p, unsigned int warmup, unsigned int repetitions) : p{p}, warmup{warmup}, repetitions{repetitions} {
+        this->p.results_file.clear();
+    }
+    
+    /*! Lists, in alphabetical order, the instances of the benchmark in the given folder: the example files, the files in normal_tw, those in the subfolders of tight_tw and the synthetic ones */
+    static auto find_instances(const std::string& folder) -> bv<std::string>;
+    
+    /*! Runs all the steps on the given instance */
+    auto run(const std::string& file_name) const -> instance_result;
+    
+    /*! Writes the results in JSON format to the given file */
+    auto write(const bv<instance_result>& results, const std::string& file_name) const -> void;
+    
+    /*! Compares the median times of a report to those of a baseline report, and prints the steps whose time changed by more than
+     *  threshold percent. Returns false if some step became slower than that.
+     */
+    static auto compare(const std::string& baseline_file, const std::string& report_file, double threshold) -> bool;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include <bench/benchmark.h>
+#include <params/params.h>
+#include <profiler/profiler.h>
+
+#include <iostream>
+#include <string>
+
+/*
+    Usage:  ras_bench run <params file> <instances folder> <report file> [<warmup runs> <repetitions>]
+            ras_bench compare <baseline report> <report> <threshold percent>
+*/
+int main(int argc, char* argv[]) {
+    auto mode = std::string(argc > 1 ? argv[1] : "");
+    
+    if(mode == "compare" && argc == 5) {
+        return benchmark::compare(argv[2], argv[3], std::stod(argv[4])) ? 0 : 1;
+    }
+    
+    if(mode != "run" || (argc != 5 && argc != 7)) {
+        std::cerr << "Usage: " << argv[0] << " run <params file> <instances folder> <report file> [<warmup runs> <repetitions>]" << std::endl;
+        std::cerr << "       " << argv[0] << " compare <baseline report> <report> <threshold percent>" << std::endl;
+        return 1;
+    }
+    
+    auto p = params(argv[2]);
+    auto warmup = (argc == 7 ? std::stoul(argv[5]) : 1u);
+    auto repetitions = (argc == 7 ? std::stoul(argv[6]) : 5u);
+    auto b = benchmark(p, warmup, repetitions);
+    auto instances = benchmark::find_instances(argv[3]);
+    auto results = bv<benchmark::instance_result>();
+    
+    profiler::enable();
+    
+    for(auto k = 0u; k < instances.size(); k++) {
+        std::cerr << "RAS_BENCH >> (" << k + 1 << "/" << instances.size() << ") " << instances.at(k) << std::endl;
+        results.push_back(b.run(instances.at(k)));
+    }
+    
+    b.write(results, argv[4]);
+    
+    return 0;
+}
@@ -0,0 +1,20 @@
+# Writes OUTPUT_FILE, a header defining RAS_REVISION as the git revision of SOURCE_DIR. It runs at every build, but only
+# rewrites the header when the revision changes, so that the files including it are not compiled again for nothing
+execute_process(
+    COMMAND git rev-parse --short HEAD
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE RAS_REVISION
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+if(NOT RAS_REVISION)
+    set(RAS_REVISION "unknown")
+endif()
+
+set(REVISION_HEADER "#define RAS_REVISION \"${RAS_REVISION}\"\n")
+set(OLD_REVISION_HEADER "")
+if(EXISTS ${OUTPUT_FILE})
+    file(READ ${OUTPUT_FILE} OLD_REVISION_HEADER)
+endif()
+if(NOT REVISION_HEADER STREQUAL OLD_REVISION_HEADER)
+    file(WRITE ${OUTPUT_FILE} "${REVISION_HEADER}")
+endif()
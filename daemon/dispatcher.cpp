@@ -0,0 +1,559 @@
+#include <daemon/dispatcher.h>
+#include <solver/lagrangian_solver.h>
+#include <solver/safe_interval_planner.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+
+#include <boost/property_tree/json_parser.hpp>
+
+using boost::property_tree::ptree;
+using boost::property_tree::ptree_error;
+
+namespace {
+    // A re-planned path replaces the current one only if it is cheaper by more than this
+    constexpr double min_improvement = 1e-6;
+    
+    auto train_of(ptree& pt, unsigned int i) -> ptree& {
+        return std::next(pt.get_child("trains").begin(), i)->second;
+    }
+    
+    auto escaped(const std::string& text) -> std::string {
+        auto out = std::string();
+        
+        for(auto c : text) {
+            if(c == '"' || c == '\\') {
+                out += '\\';
+            }
+            
+            out += (c == '\n' ? ' ' : c);
+        }
+        
+        return out;
+    }
+}
+
+dispatcher::dispatcher(std::string file_name, const params& p) : file_name{std::move(file_name)}, dispatch_p{p}, now{0u}, stop_requested{false} {
+    dispatch_p.preprocessing.contract_chains = false;
+    
+    pt = data::read_file(this->file_name);
+    d = std::make_unique<data>(pt, this->file_name, dispatch_p, 1u, corridor(), false);
+    nodes = bv<bv<path::node>>(d->nt);
+    costs = double_vector(d->nt, 0.0);
+    cancelled = bool_vector(d->nt, false);
+    occ = std::make_unique<occupancy>(*d);
+}
+
+auto dispatcher::solve() -> bool {
+    // The graphs are only needed by the lagrangian solver, and are freed as soon as it is done
+    auto full_d = data(pt, file_name, dispatch_p, 1u, corridor(), true);
+    auto s = lagrangian_solver(full_d);
+    auto paths = s.solve();
+    
+    if(!paths) {
+        std::cerr << "DISPATCHER >> The lagrangian solver found no schedule" << std::endl;
+        return false;
+    }
+    
+    for(const auto& pa : *paths) {
+        if(pa.is_dummy() || pa.is_empty()) {
+            continue;
+        }
+        
+        nodes.at(pa.train) = pa.p;
+        costs.at(pa.train) = pa.cost;
+        occ->reserve(pa.train, pa.p);
+    }
+    
+    std::cout << "DISPATCHER >> Initial schedule with cost " << total_cost() << std::endl;
+    
+    return true;
+}
+
+auto dispatcher::handle(const std::string& message) -> std::string {
+    using namespace std::chrono;
+    
+    auto t_start = high_resolution_clock::now();
+    auto changed = boost::optional<uint_vector>();
+    auto msg = ptree();
+    
+    error.clear();
+    
+    try {
+        std::istringstream in(message);
+        
+        boost::property_tree::read_json(in, msg);
+        
+        auto type = msg.get<std::string>("type", "");
+        
+        // Any message can tell the current time, which never goes back
+        if(auto reported = msg.get_optional<unsigned int>("now")) {
+            now = std::max(now, *reported);
+        }
+        
+        if(type == "delay") {
+            changed = delay(msg);
+        } else if(type == "position") {
+            changed = position(msg);
+        } else if(type == "mow") {
+            changed = add_mow(msg);
+        } else if(type == "new_train") {
+            changed = add_train(msg);
+        } else if(type == "cancel") {
+            changed = cancel(msg);
+        } else if(type == "paths") {
+            changed = uint_vector(d->nt);
+            std::iota(changed->begin(), changed->end(), 0u);
+        } else if(type == "shutdown") {
+            stop_requested = true;
+            changed = uint_vector();
+        } else {
+            error = "Unknown message type: " + type;
+        }
+    } catch(const ptree_error& e) {
+        error = std::string("Malformed message: ") + e.what();
+    }
+    
+    if(!changed) {
+        std::cerr << "DISPATCHER >> " << error << std::endl;
+        return "{\"status\": \"error\", \"message\": \"" + escaped(error) + "\"}";
+    }
+    
+    auto t_end = high_resolution_clock::now();
+    
+    return reply(*changed, duration_cast<duration<double, std::milli>>(t_end - t_start).count());
+}
+
+auto dispatcher::total_cost() const -> double {
+    return std::accumulate(costs.begin(), costs.end(), 0.0);
+}
+
+auto dispatcher::delay(const ptree& msg) -> boost::optional<uint_vector> {
+    auto i = valid_train(msg);
+    
+    if(!i) {
+        return boost::none;
+    }
+    
+    // Once the train is in the territory its entry cannot be delayed any more: where it is must be reported instead
+    if(nodes.at(*i).size() > 1u && nodes.at(*i).at(1).t <= now) {
+        error = "Train " + std::to_string(*i) + " has already entered the territory: report its position instead";
+        return boost::none;
+    }
+    
+    auto& train_pt = train_of(pt, *i);
+    auto entry_time = train_pt.get<unsigned int>("entry_time") + msg.get<unsigned int>("minutes");
+    auto delayed_pt = train_pt;
+    
+    delayed_pt.put("entry_time", entry_time);
+    
+    if(!check_train(delayed_pt, *i)) {
+        return boost::none;
+    }
+    
+    // Only the train's arrival times change, so the data is updated in place
+    train_pt = delayed_pt;
+    d->set_entry_time(*i, entry_time);
+    
+    return replan({*i}, true);
+}
+
+auto dispatcher::position(const ptree& msg) -> boost::optional<uint_vector> {
+    auto i = valid_train(msg);
+    
+    if(!i) {
+        return boost::none;
+    }
+    
+    auto node = msg.get<unsigned int>("node");
+    auto time = msg.get<unsigned int>("time");
+    
+    // From now on the train runs as if it entered the territory at the reported junction, leaving it exactly at the reported time
+    auto new_pt = pt;
+    auto& train_pt = train_of(new_pt, *i);
+    
+    train_pt.put("origin_node", node);
+    train_pt.put("entry_time", time);
+    train_pt.put("fixed_entry", true);
+    
+    if(!rebuild(new_pt)) {
+        return boost::none;
+    }
+    
+    now = std::max(now, time);
+    
+    // The reported position replaces what the train was planned to do so far
+    return replan({*i}, false);
+}
+
+auto dispatcher::add_mow(const ptree& msg) -> boost::optional<uint_vector> {
+    auto w_ext = msg.get<unsigned int>("extreme_1");
+    auto e_ext = msg.get<unsigned int>("extreme_2");
+    auto start_time = msg.get<unsigned int>("start_time");
+    auto end_time = msg.get<unsigned int>("end_time");
+    
+    if(start_time > end_time || end_time >= d->ni) {
+        error = "The MOW must end after it starts and before the end of the time horizon";
+        return boost::none;
+    }
+    
+    if(start_time <= now) {
+        error = "The MOW must start after the current time";
+        return boost::none;
+    }
+    
+    auto on_segment = false;
+    
+    for(auto s = 1u; s <= d->ns; s++) {
+        on_segment = on_segment || (d->seg.w_ext.at(s) == w_ext && d->seg.e_ext.at(s) == e_ext);
+    }
+    
+    if(!on_segment) {
+        error = "No segment joins the extremes of the MOW";
+        return boost::none;
+    }
+    
+    auto new_pt = pt;
+    auto mow_pt = ptree();
+    
+    mow_pt.put("extreme_1", w_ext);
+    mow_pt.put("extreme_2", e_ext);
+    mow_pt.put("start_time", start_time);
+    mow_pt.put("end_time", end_time);
+    new_pt.get_child("mow").push_back(std::make_pair("", mow_pt));
+    
+    if(!rebuild(new_pt)) {
+        return boost::none;
+    }
+    
+    // Only the trains which would run through the MOW need a new path
+    auto affected = uint_vector();
+    
+    for(auto i = 0u; i < d->nt; i++) {
+        const auto& p = nodes.at(i);
+        auto hit = false;
+        
+        for(auto k = 1u; k + 1 < p.size() && !hit; k++) {
+            for(auto t = p.at(k).t; t < p.at(k + 1).t && !hit; t++) {
+                hit = d->mnt.is_mow.at(p.at(k).seg).at(t);
+            }
+        }
+        
+        if(hit) {
+            affected.push_back(i);
+        }
+    }
+    
+    return replan(affected, true);
+}
+
+auto dispatcher::add_train(const ptree& msg) -> boost::optional<uint_vector> {
+    auto train_pt = msg.get_child_optional("train");
+    
+    if(!train_pt) {
+        error = "The message has no train";
+        return boost::none;
+    }
+    
+    // A delay or a position report can make a train late, but a new train must be wanted after it enters
+    if(train_pt->get<unsigned int>("terminal_wt") < train_pt->get<unsigned int>("entry_time")) {
+        error = "The new train would be wanted at its destination before it enters";
+        return boost::none;
+    }
+    
+    auto new_pt = pt;
+    
+    new_pt.get_child("trains").push_back(std::make_pair("", *train_pt));
+    new_pt.put("trains_number", d->nt + 1u);
+    
+    if(!rebuild(new_pt)) {
+        return boost::none;
+    }
+    
+    nodes.push_back(bv<path::node>());
+    costs.push_back(0.0);
+    cancelled.push_back(false);
+    
+    return replan({d->nt - 1u}, true);
+}
+
+auto dispatcher::cancel(const ptree& msg) -> boost::optional<uint_vector> {
+    auto i = valid_train(msg);
+    
+    if(!i) {
+        return boost::none;
+    }
+    
+    // The cancelled train is re-planned like any affected one, but it gets no path: its reservations are freed for the others
+    cancelled.at(*i) = true;
+    
+    return replan({*i}, true);
+}
+
+auto dispatcher::valid_train(const ptree& msg) -> boost::optional<unsigned int> {
+    auto i = msg.get<unsigned int>("train");
+    
+    if(i >= d->nt) {
+        error = "No train with id " + std::to_string(i);
+        return boost::none;
+    }
+    
+    if(cancelled.at(i)) {
+        error = "Train " + std::to_string(i) + " has been cancelled";
+        return boost::none;
+    }
+    
+    return i;
+}
+
+auto dispatcher::check_train(const ptree& train_pt, unsigned int i) -> bool {
+    const auto& seg = d->seg;
+    auto want_time = train_pt.get<unsigned int>("terminal_wt");
+    auto entry_time = train_pt.get<unsigned int>("entry_time");
+    auto train_class = train_pt.get<char>("class");
+    auto eastbound = train_pt.get<bool>("eastbound");
+    auto origin = train_pt.get<unsigned int>("origin_node");
+    auto destination = train_pt.get<unsigned int>("destination_node");
+    auto fail = [&] (const std::string& why) {
+        error = "Train " + std::to_string(i) + " " + why;
+        return false;
+    };
+    
+    // The same conditions the trains' data asserts, plus having somewhere to start, to end and to meet each SA point
+    auto has_extreme = [&] (unsigned int extreme, bool west_end) {
+        for(auto s = 0u; s <= d->ns + 1; s++) {
+            if((west_end ? seg.w_ext.at(s) : seg.e_ext.at(s)) == extreme) {
+                return true;
+            }
+        }
+        
+        return false;
+    };
+    
+    if(entry_time >= d->ni || want_time >= d->ni) {
+        return fail("would enter or be wanted after the end of the time horizon");
+    }
+    
+    if(train_pt.get<double>("speed_multi") <= 0.0 || train_pt.get<double>("length") <= 0.0) {
+        return fail("must have a positive speed multiplier and length");
+    }
+    
+    if(train_class < trains::first_train_class || train_class > trains::last_train_class) {
+        return fail("has an unknown class");
+    }
+    
+    if(eastbound == train_pt.get<bool>("westbound")) {
+        return fail("must run either eastbound or westbound");
+    }
+    
+    if(!has_extreme(origin, eastbound) || !has_extreme(destination, !eastbound)) {
+        return fail("would have no origin or no destination segment");
+    }
+    
+    auto n_sa_points = 0u;
+    
+    for(const auto& schedule_child : train_pt.get_child("schedule")) {
+        if(schedule_child.second.get<unsigned int>("time") > d->ni) {
+            continue;
+        }
+        
+        if(!has_extreme(schedule_child.second.get<unsigned int>("node"), !eastbound)) {
+            return fail("has a SA point at no segment's end");
+        }
+        
+        n_sa_points++;
+    }
+    
+    if(train_pt.get<bool>("schedule_adherence") != (n_sa_points > 0u)) {
+        return fail("must have SA points within the time horizon iff it has schedule adherence");
+    }
+    
+    return true;
+}
+
+auto dispatcher::rebuild(ptree new_pt) -> bool {
+    // A train the data cannot hold would fail its assertions: the update is refused before the data is built
+    auto n = 0u;
+    
+    for(const auto& train_child : new_pt.get_child("trains")) {
+        if(!check_train(train_child.second, n++)) {
+            return false;
+        }
+    }
+    
+    auto new_d = std::make_unique<data>(new_pt, file_name, dispatch_p, 1u, corridor(), false);
+    
+    // The segments do not change with the updates, so the paths found so far are still valid in the new data
+    pt = std::move(new_pt);
+    d = std::move(new_d);
+    occ = std::make_unique<occupancy>(*d);
+    
+    for(auto i = 0u; i < nodes.size(); i++) {
+        occ->reserve(i, nodes.at(i));
+    }
+    
+    return true;
+}
+
+auto dispatcher::replan(const uint_vector& affected, bool keep_past) -> uint_vector {
+    auto old_nodes = bv<bv<path::node>>();
+    auto order = uint_vector(affected.size());
+    auto changed = bool_vector(d->nt, false);
+    
+    for(auto i : affected) {
+        old_nodes.push_back(nodes.at(i));
+        occ->release(i, nodes.at(i));
+        nodes.at(i).clear();
+        costs.at(i) = 0.0;
+        changed.at(i) = true;
+    }
+    
+    // The affected trains are scheduled in order of entry, as the solvers do
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&] (unsigned int k1, unsigned int k2) {
+        return d->trn.entry_time.at(affected.at(k1)) < d->trn.entry_time.at(affected.at(k2));
+    });
+    
+    for(auto k : order) {
+        auto i = affected.at(k);
+        
+        if(cancelled.at(i)) {
+            continue;
+        }
+        
+        // The train goes on from where it is now, unless its position has just been reported
+        auto planner = safe_interval_planner(*d, i, *occ);
+        auto p = keep_past ? planner.plan_from(old_nodes.at(k), now) : planner.plan();
+        
+        if(!p) {
+            std::cerr << "DISPATCHER >> Could not schedule train " << i << std::endl;
+            continue;
+        }
+        
+        occ->reserve(i, *p);
+        nodes.at(i) = *p;
+        costs.at(i) = planner.cost;
+    }
+    
+    auto candidates = neighbours(affected, old_nodes);
+    
+    for(auto pass = 0u; pass < dispatch_p.daemon.improvement_passes; pass++) {
+        auto improved = false;
+        
+        for(auto j : candidates) {
+            occ->release(j, nodes.at(j));
+            
+            auto planner = safe_interval_planner(*d, j, *occ);
+            auto p = planner.plan_from(nodes.at(j), now);
+            
+            if(p && (nodes.at(j).empty() || planner.cost < costs.at(j) - min_improvement)) {
+                nodes.at(j) = *p;
+                costs.at(j) = planner.cost;
+                changed.at(j) = true;
+                improved = true;
+            }
+            
+            occ->reserve(j, nodes.at(j));
+        }
+        
+        if(!improved) {
+            break;
+        }
+    }
+    
+    auto changed_trains = uint_vector();
+    
+    for(auto i = 0u; i < d->nt; i++) {
+        if(changed.at(i)) {
+            changed_trains.push_back(i);
+        }
+    }
+    
+    return changed_trains;
+}
+
+auto dispatcher::neighbours(const uint_vector& trains, const bv<bv<path::node>>& old_nodes) const -> uint_vector {
+    // Trains which run at the same time as the old or new path of some affected train, on some of the same segments
+    auto used = bool_vector(d->ns + 2, false);
+    auto from = d->ni + 1u;
+    auto to = 0u;
+    auto mark = [&] (const bv<path::node>& p) {
+        if(p.size() < 3u) {
+            return;
+        }
+        
+        for(auto k = 1u; k + 1 < p.size(); k++) {
+            used.at(p.at(k).seg) = true;
+        }
+        
+        from = std::min(from, p.at(1).t);
+        to = std::max(to, p.back().t);
+    };
+    
+    for(auto k = 0u; k < trains.size(); k++) {
+        mark(old_nodes.at(k));
+        mark(nodes.at(trains.at(k)));
+    }
+    
+    auto result = uint_vector();
+    
+    for(auto j = 0u; j < d->nt; j++) {
+        const auto& p = nodes.at(j);
+        
+        if(cancelled.at(j) || std::find(trains.begin(), trains.end(), j) != trains.end()) {
+            continue;
+        }
+        
+        // Trains which could not be scheduled may fit now
+        if(p.empty()) {
+            result.push_back(j);
+            continue;
+        }
+        
+        if(p.at(1).t > to + d->headway || p.back().t + d->headway < from) {
+            continue;
+        }
+        
+        if(std::any_of(p.begin() + 1, p.end() - 1, [&] (const path::node& n) { return used.at(n.seg); })) {
+            result.push_back(j);
+        }
+    }
+    
+    // The affected trains may also benefit from the neighbours moving
+    for(auto i : trains) {
+        if(!cancelled.at(i)) {
+            result.push_back(i);
+        }
+    }
+    
+    return result;
+}
+
+auto dispatcher::reply(const uint_vector& changed, double elapsed_ms) const -> std::string {
+    std::ostringstream out;
+    
+    out << "{\"status\": \"ok\", \"elapsed_ms\": " << elapsed_ms << ", \"cost\": " << total_cost() << ", \"paths\": [";
+    
+    for(auto k = 0u; k < changed.size(); k++) {
+        auto i = changed.at(k);
+        const auto& p = nodes.at(i);
+        
+        out << (k > 0u ? ", " : "") << "{\"train\": " << i << ", \"state\": \"";
+        out << (cancelled.at(i) ? "cancelled" : (p.empty() ? "unscheduled" : "scheduled")) << "\", ";
+        out << "\"cost\": " << costs.at(i) << ", \"nodes\": [";
+        
+        for(auto n = 0u; n < p.size(); n++) {
+            out << (n > 0u ? ", " : "") << "[" << p.at(n).seg << ", " << p.at(n).t << "]";
+        }
+        
+        out << "]}";
+    }
+    
+    out << "]}";
+    
+    return out.str();
+}
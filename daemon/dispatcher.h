@@ -0,0 +1,86 @@
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/occupancy.h>
+#include <data/path.h>
+#include <params/params.h>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <memory>
+#include <string>
+
+/*! \brief This class keeps an instance and its schedule in memory, and updates the schedule as the dispatch desk reports what
+ *  happens on the territory: a train is delayed, a train reports its position, a new MOW is planned, a train is added or cancelled.
+ *  The first schedule is found by the lagrangian solver; after that, only the trains affected by an update are re-planned with
+ *  the safe-interval planner around the reservations of the others, which needs no time-expanded graph. The trains running close
+ *  to them are then re-planned too, keeping the cheaper paths. Every train is re-planned from where it is at the current time, so
+ *  what it did before stays as it was, unless its position is reported. Updates the data could not hold are refused with an error. Train ids never change: a cancelled train keeps its id and has no path.
+ */
+struct dispatcher {
+    /*! Name of the JSON data file */
+    std::string file_name;
+    
+    /*! Params used for the data: chains are never contracted, as the contracted segments depend on the MOWs */
+    params dispatch_p;
+    
+    /*! Property tree of the instance, including all the updates received so far */
+    boost::property_tree::ptree pt;
+    
+    /*! Data built from pt, without the trains' graphs */
+    std::unique_ptr<data> d;
+    
+    /*! Indexed over tr, succession of nodes visited by the train: empty if the train is cancelled or could not be scheduled */
+    bv<bv<path::node>> nodes;
+    
+    /*! Indexed over tr, cost of the train's path */
+    double_vector costs;
+    
+    /*! Indexed over tr, tells wether the train has been cancelled */
+    bool_vector cancelled;
+    
+    /*! Reservations of the scheduled trains */
+    std::unique_ptr<occupancy> occ;
+    
+    /*! Current time, as last reported by the dispatch desk: only a position report changes a path before it */
+    unsigned int now;
+    
+    /*! Why the last message could not be applied */
+    std::string error;
+    
+    /*! True once a shutdown message has been received */
+    bool stop_requested;
+    
+    /*! Basic constructor */
+    dispatcher(std::string file_name, const params& p);
+    
+    /*! Finds the first schedule. Returns false if the lagrangian solver found none */
+    auto solve() -> bool;
+    
+    /*! Applies the update described by the one-line JSON message and re-plans the affected trains. Returns a one-line JSON reply
+     *  with the new paths of the trains whose path changed, from sigma to tau, or with an error if the message could not be applied.
+     */
+    auto handle(const std::string& message) -> std::string;
+    
+    /*! Total cost of the schedule */
+    auto total_cost() const -> double;
+
+private:
+    
+    auto delay(const boost::property_tree::ptree& msg) -> boost::optional<uint_vector>;
+    auto position(const boost::property_tree::ptree& msg) -> boost::optional<uint_vector>;
+    auto add_mow(const boost::property_tree::ptree& msg) -> boost::optional<uint_vector>;
+    auto add_train(const boost::property_tree::ptree& msg) -> boost::optional<uint_vector>;
+    auto cancel(const boost::property_tree::ptree& msg) -> boost::optional<uint_vector>;
+    auto valid_train(const boost::property_tree::ptree& msg) -> boost::optional<unsigned int>;
+    auto check_train(const boost::property_tree::ptree& train_pt, unsigned int i) -> bool;
+    auto rebuild(boost::property_tree::ptree new_pt) -> bool;
+    auto replan(const uint_vector& affected, bool keep_past) -> uint_vector;
+    auto neighbours(const uint_vector& trains, const bv<bv<path::node>>& old_nodes) const -> uint_vector;
+    auto reply(const uint_vector& changed, double elapsed_ms) const -> std::string;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include <daemon/dispatcher.h>
+#include <params/params.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+    Usage:  ras_daemon <data file> <params file> <socket path>
+    
+    Clients connect to the Unix socket and send one JSON message per line; each message gets a one-line JSON reply.
+        {"type": "delay", "train": 3, "minutes": 20}
+        {"type": "position", "train": 3, "node": 12, "time": 140}
+        {"type": "mow", "extreme_1": 7, "extreme_2": 8, "start_time": 200, "end_time": 320}
+        {"type": "new_train", "train": { ...same fields as the trains in the data file... }}
+        {"type": "cancel", "train": 3}
+        {"type": "paths"}
+        {"type": "shutdown"}
+    Any message can also carry the current time, e.g. {"type": "paths", "now": 150}: paths are not changed before it, and MOWs must start after it.
+*/
+namespace {
+    auto send_line(int fd, const std::string& line) -> bool {
+        auto out = line + "\n";
+        auto sent = std::size_t{0u};
+        
+        while(sent < out.size()) {
+            auto n = write(fd, out.data() + sent, out.size() - sent);
+            
+            if(n <= 0) {
+                return false;
+            }
+            
+            sent += static_cast<std::size_t>(n);
+        }
+        
+        return true;
+    }
+    
+    // Serves one client until it disconnects or asks the daemon to stop
+    auto serve(int fd, dispatcher& disp) -> void {
+        auto buffer = std::string();
+        char chunk[4096];
+        
+        while(!disp.stop_requested) {
+            auto n = read(fd, chunk, sizeof(chunk));
+            
+            if(n <= 0) {
+                return;
+            }
+            
+            buffer.append(chunk, static_cast<std::size_t>(n));
+            
+            auto end = std::string::npos;
+            
+            while(!disp.stop_requested && (end = buffer.find('\n')) != std::string::npos) {
+                auto message = buffer.substr(0u, end);
+                
+                buffer.erase(0u, end + 1u);
+                
+                if(message.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                
+                if(!send_line(fd, disp.handle(message))) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <data file> <params file> <socket path>" << std::endl;
+        return 1;
+    }
+    
+    auto p = params(argv[2]);
+    
+    // The data keeps a reference to the dispatcher's params, so the dispatcher is never moved
+    dispatcher disp(argv[1], p);
+    
+    if(!disp.solve()) {
+        return 1;
+    }
+    
+    auto address = sockaddr_un();
+    auto socket_path = std::string(argv[3]);
+    
+    if(socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "RAS_DAEMON >> Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1u);
+    
+    // A client disconnecting before reading its reply must not kill the daemon
+    std::signal(SIGPIPE, SIG_IGN);
+    unlink(socket_path.c_str());
+    
+    auto server = socket(AF_UNIX, SOCK_STREAM, 0);
+    
+    if(server < 0 || bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server, 8) != 0) {
+        std::cerr << "RAS_DAEMON >> Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    
+    std::cout << "RAS_DAEMON >> Listening on " << socket_path << std::endl;
+    
+    while(!disp.stop_requested) {
+        auto client = accept(server, nullptr, nullptr);
+        
+        if(client < 0) {
+            continue;
+        }
+        
+        serve(client, disp);
+        close(client);
+    }
+    
+    close(server);
+    unlink(socket_path.c_str());
+    
+    std::cout << "RAS_DAEMON >> Stopped with a schedule of cost " << disp.total_cost() << std::endl;
+    
+    return 0;
+}
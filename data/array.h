@@ -1,5 +1,7 @@
 #include <boost/container/vector.hpp>
 
+#include <cstdint>
+
 template<typename T>
 using bv = boost::container::vector<T>;
 
@@ -20,6 +22,18 @@ using double_matrix_2d = bv<double_vector>;
 using double_matrix_3d = bv<double_matrix_2d>;
 using double_matrix_4d = bv<double_matrix_3d>;
 
+// Arc costs are whole cents when the project is configured with NEED_INTEGER_COSTS
+#if USE_INTEGER_COSTS
+    using cost_type = std::int32_t;
+#else
+    using cost_type = double;
+#endif
+
+using cost_vector = bv<cost_type>;
+using cost_matrix_2d = bv<cost_vector>;
+using cost_matrix_3d = bv<cost_matrix_2d>;
+using cost_matrix_4d = bv<cost_matrix_3d>;
+
 #if USE_CPLEX
     #include <ilcplex/ilocplex.h>
 
@@ -0,0 +1,27 @@
+#include <data/corridor.h>
+
+#include <algorithm>
+#include <limits>
+
+corridor::corridor(unsigned int nt, unsigned int ns) {
+    earliest = uint_matrix_2d(nt, uint_vector(ns + 2, std::numeric_limits<unsigned int>::max()));
+    latest = uint_matrix_2d(nt, uint_vector(ns + 2, 0u));
+}
+
+auto corridor::widen(unsigned int tr, unsigned int s, unsigned int from, unsigned int to) -> void {
+    earliest.at(tr).at(s) = std::min(earliest.at(tr).at(s), from);
+    latest.at(tr).at(s) = std::max(latest.at(tr).at(s), to);
+}
+
+auto corridor::open(unsigned int tr) -> void {
+    std::fill(earliest.at(tr).begin(), earliest.at(tr).end(), 0u);
+    std::fill(latest.at(tr).begin(), latest.at(tr).end(), std::numeric_limits<unsigned int>::max());
+}
+
+auto corridor::contains(unsigned int tr, unsigned int s, unsigned int t) const -> bool {
+    if(earliest.empty()) {
+        return true;
+    }
+    
+    return (t >= earliest.at(tr).at(s) && t <= latest.at(tr).at(s));
+}
@@ -0,0 +1,30 @@
+#ifndef CORRIDOR_H
+#define CORRIDOR_H
+
+#include <data/array.h>
+
+/*! \brief This class restricts, for each train and segment, the time intervals at which the train can occupy the segment */
+struct corridor {
+    /*! Indexed over (tr, s), the first time interval at which tr can occupy s */
+    uint_matrix_2d earliest;
+    
+    /*! Indexed over (tr, s), the last time interval at which tr can occupy s */
+    uint_matrix_2d latest;
+    
+    /*! Empty constructor: it does not restrict anything */
+    corridor() {}
+    
+    /*! Construct a corridor where no train can occupy any segment, to be opened with widen() */
+    corridor(unsigned int nt, unsigned int ns);
+    
+    /*! Allow train tr to occupy segment s at every time interval between from and to (both included) */
+    auto widen(unsigned int tr, unsigned int s, unsigned int from, unsigned int to) -> void;
+    
+    /*! Allow train tr to occupy any segment at any time */
+    auto open(unsigned int tr) -> void;
+    
+    /*! Tells wether train tr is allowed to occupy segment s at time t */
+    auto contains(unsigned int tr, unsigned int s, unsigned int t) const -> bool;
+};
+
+#endif
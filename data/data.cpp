@@ -1,6 +1,9 @@
 #include <data/data.h>
+#include <profiler/memory.h>
+#include <profiler/profiler.h>
 
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <cmath>
 #include <iostream>
@@ -12,11 +15,18 @@
 using namespace boost::property_tree;
 using namespace boost;
 
-data::data(const std::string& file_name, const params& p) : p{p} {
+data::data(const std::string& file_name, const params& p) : data(file_name, p, 1u, corridor()) {}
+
+data::data(const std::string& file_name, const params& p, unsigned int time_step, corridor cor) : data(read_file(file_name), file_name, p, time_step, std::move(cor), true) {}
+
+data::data(ptree pt, const std::string& file_name, const params& p, unsigned int time_step, corridor cor, bool with_graphs) : time_step{time_step}, cor{std::move(cor)}, p{p} {
+    profiler::span phase("data/build");
+    
     using namespace std::chrono;
     
-    ptree pt;
-    read_json(file_name, pt);
+    if(time_step > 1u) {
+        coarsen(pt);
+    }
     
     ins = instance(pt.get<std::string>("name"), file_name);
     
@@ -27,6 +37,7 @@ data::data(const std::string& file_name, const params& p) : p{p} {
     
     spd = speeds(pt);
     seg = segments(pt);
+    original_seg = seg;
     mnt = mows(pt, ni, ns, seg);
     tiw = time_windows(pt, ni);
     pri = prices(pt);
@@ -34,8 +45,17 @@ data::data(const std::string& file_name, const params& p) : p{p} {
         
     auto t_start = high_resolution_clock::now();
 
-    net = network(nt, ns, trn, spd, seg);
-    gr = graph(nt, ns, ni, p, trn, mnt, seg, net, tiw, pri);
+    if(p.preprocessing.contract_chains) {
+        contract_chains(pt);
+    } else {
+        net = network(nt, ns, trn, spd, seg);
+    }
+    
+    if(!with_graphs) {
+        return;
+    }
+    
+    gr = graph(nt, ns, ni, p, trn, mnt, seg, net, tiw, pri, this->cor);
 
     auto t_end = high_resolution_clock::now();
     auto time_span = duration_cast<duration<double>>(t_end - t_start);
@@ -47,4 +67,82 @@ data::data(const std::string& file_name, const params& p) : p{p} {
         std::cout << "\t" << gr.n_nodes.at(i) << " nodes" << std::endl;
         std::cout << "\t" << gr.n_arcs.at(i) << " arcs" << std::endl;
     }
+    
+    memory::checkpoint("data/build", memory::graph_bytes(gr) + memory::network_bytes(net));
+}
+
+auto data::set_entry_time(unsigned int i, unsigned int entry_time) -> void {
+    assert(entry_time < ni);
+    
+    trn.entry_time.at(i) = entry_time;
+    net.update_arrival_times(i, ns, trn, seg);
+    
+    if(!gr.v.empty()) {
+        gr.update_train(i, ns, ni, p, trn, mnt, seg, net, tiw, pri, cor);
+    }
+}
+
+auto data::read_file(const std::string& file_name) -> ptree {
+    profiler::span phase("data/read_json");
+    
+    ptree pt;
+    read_json(file_name, pt);
+    
+    return pt;
+}
+
+auto data::contract_chains(const ptree& pt) -> void {
+    auto original_ns = ns;
+    auto chain = uint_matrix_2d();
+    
+    seg = network::contract_chains(ns, trn, mnt, original_seg, chain);
+    ns = seg.type.size() - 2;
+    
+    // Segment ids changed: MOWs and trains' segments have to be recomputed on the contracted network
+    mnt = mows(pt, ni, ns, seg);
+    trn = trains(pt, nt, ns, ni, spd, seg);
+    net = network(nt, ns, trn, spd, seg, original_seg, chain);
+    
+    std::cout << "Chain contraction: " << original_ns << " segments contracted to " << ns << std::endl;
+}
+
+auto data::coarsen(ptree& pt) const -> void {
+    // Times are rounded so that the coarse instance is never easier than the original one
+    auto round_up = [&] (unsigned int t) { return (t + time_step - 1) / time_step; };
+    auto coarse_ni = round_up(pt.get<unsigned int>("time_intervals"));
+    auto clamp = [&] (unsigned int t) { return std::min(t, coarse_ni - 1); };
+    
+    pt.put("time_intervals", coarse_ni);
+    pt.put("headway", round_up(pt.get<unsigned int>("headway")));
+    pt.put("want_time_tw_start", pt.get<unsigned int>("want_time_tw_start") / time_step);
+    pt.put("want_time_tw_end", pt.get<unsigned int>("want_time_tw_end") / time_step);
+    pt.put("schedule_tw_end", pt.get<unsigned int>("schedule_tw_end") / time_step);
+    
+    // Scaling speeds gives min travel times ceil(length / (speed * step)) = ceil(original min travel time / step)
+    for(auto speed : {"speed_ew", "speed_we", "speed_siding", "speed_switch", "speed_xover"}) {
+        pt.put(speed, pt.get<double>(speed) * time_step);
+    }
+    
+    // Prices are given per time interval
+    for(auto& delay_child : pt.get_child("general_delay_price")) {
+        delay_child.second.put_value(delay_child.second.get_value<double>() * time_step);
+    }
+    for(auto price : {"terminal_delay_price", "schedule_delay_price", "unpreferred_price"}) {
+        pt.put(price, pt.get<double>(price) * time_step);
+    }
+    
+    for(auto& train_child : pt.get_child("trains")) {
+        train_child.second.put("entry_time", clamp(round_up(train_child.second.get<unsigned int>("entry_time"))));
+        train_child.second.put("terminal_wt", clamp(round_up(train_child.second.get<unsigned int>("terminal_wt"))));
+        
+        // SA times are deadlines: rounding them down makes them earlier, i.e. harder to meet
+        for(auto& schedule_child : train_child.second.get_child("schedule")) {
+            schedule_child.second.put("time", schedule_child.second.get<unsigned int>("time") / time_step);
+        }
+    }
+    
+    for(auto& mow_child : pt.get_child("mow")) {
+        mow_child.second.put("start_time", clamp(mow_child.second.get<unsigned int>("start_time") / time_step));
+        mow_child.second.put("end_time", clamp(round_up(mow_child.second.get<unsigned int>("end_time"))));
+    }
 }
\ No newline at end of file
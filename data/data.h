@@ -4,6 +4,7 @@
 #include <boost/property_tree/ptree.hpp>
 
 #include <data/array.h>
+#include <data/corridor.h>
 #include <data/graph.h>
 #include <data/instance.h>
 #include <data/mows.h>
@@ -44,6 +45,9 @@ struct data {
     /*! Information about the segments */
     segments seg;
     
+    /*! Information about the segments as in the JSON data file, i.e. before chains are contracted */
+    segments original_seg;
+    
     /*! Information about the MOWs */
     mows mnt;
     
@@ -68,13 +72,33 @@ struct data {
     /*! Headway between two trains occupying the same segment */
     unsigned int headway;
     
+    /*! Number of minutes in a time interval */
+    unsigned int time_step;
+    
+    /*! Time bands the trains' graphs are restricted to */
+    corridor cor;
+    
     /*! Reference to program params */
     const params& p;
     
     /*! Build data from a JSON data file and the parameters */
     data(const std::string& file_name, const params& p);
     
+    /*! Build data from a JSON data file and the parameters, where each time interval lasts time_step minutes and graphs are restricted to the corridor */
+    data(const std::string& file_name, const params& p, unsigned int time_step, corridor cor);
+    
+    /*! Build data from the property tree of a JSON data file, e.g. one modified in memory; the trains' graphs are only built if with_graphs is true */
+    data(boost::property_tree::ptree pt, const std::string& file_name, const params& p, unsigned int time_step, corridor cor, bool with_graphs);
+    
+    /*! Reads a JSON data file into a property tree */
+    static auto read_file(const std::string& file_name) -> boost::property_tree::ptree;
+    
+    /*! Changes the entry time of train i, updating its arrival times and, if the graphs were built, its graph in place */
+    auto set_entry_time(unsigned int i, unsigned int entry_time) -> void;
+    
 private:
+    auto coarsen(boost::property_tree::ptree& pt) const -> void;
+    
     auto create_trains(const boost::property_tree::ptree& pt) -> void;
         auto calculate_trains_max_speeds() -> void;
         auto calculate_trains_origin_and_destination_segments() -> void;
@@ -84,6 +108,7 @@ private:
     auto create_network() -> void;
         auto calculate_times() -> void;
         auto calculate_main_tracks() -> void;
+        auto contract_chains(const boost::property_tree::ptree& pt) -> void;
     
     auto create_graphs() -> void;
         auto calculate_deltas() -> void;
@@ -1,8 +1,12 @@
 #include <data/graph.h>
+#include <profiler/profiler.h>
 
 #include <algorithm>
+#include <numeric>
 
-graph::graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri) {
+graph::graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor) {
+    profiler::span phase("graph/build");
+    
     n_nodes = uint_vector(nt, 0);
     n_arcs = uint_vector(nt, 0);
     v_for_someone = bool_matrix_2d(ns + 2, bool_vector(ni + 2, false));
@@ -15,18 +19,13 @@ graph::graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p,
     adj = bool_matrix_4d(nt, bool_matrix_3d(ns + 2, bool_matrix_2d(ni + 2, bool_vector(ns + 2, false))));
     n_out = uint_matrix_3d(nt, uint_matrix_2d(ns + 2, uint_vector(ni + 2, 0u)));
     n_in = uint_matrix_3d(nt, uint_matrix_2d(ns + 2, uint_vector(ni + 2, 0u)));
-    costs = double_matrix_4d(nt, double_matrix_3d(ns + 2, double_matrix_2d(ni + 2, double_vector(ns + 2, 0.0))));
+    costs = cost_matrix_4d(nt, cost_matrix_3d(ns + 2, cost_matrix_2d(ni + 2, cost_vector(ns + 2, cost_type(0)))));
     first_time_we_need_tau = uint_vector(nt, 0u);
-        
-    calculate_deltas(nt, ns, trn, seg);
-    calculate_vertices(nt, ns, ni, p, trn, mnt, seg, net);
-    calculate_starting_arcs(nt, ni, p, trn, seg, net);
-    calculate_ending_arcs(nt, ns, ni, p, trn, net);
-    calculate_escape_arcs(nt, ns, ni);
-    calculate_stop_arcs(nt, ns, ni, net);
-    calculate_movement_arcs(nt, ns, ni, net);
-    cleanup(nt, ns, ni);
-    calculate_costs(nt, ns, ni, trn, net, tiw, pri);
+    
+    auto all_trains = uint_vector(nt);
+    std::iota(all_trains.begin(), all_trains.end(), 0u);
+    
+    build(all_trains, ns, ni, p, trn, mnt, seg, net, tiw, pri, cor);
     
     for(auto i = 0u; i < nt; i++) {
         for(auto s1 = 0u; s1 <= ns + 1; s1++) {
@@ -40,9 +39,73 @@ graph::graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p,
     }
 }
 
-auto graph::calculate_deltas(unsigned int nt, unsigned int ns, const trains& trn, const segments& seg) -> void {
-    for(auto s1 = 0u; s1 <= ns + 1; s1++) {        
-        for(auto i = 0u; i < nt; i++) {
+auto graph::update_train(unsigned int i, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor) -> void {
+    profiler::span phase("graph/update_train");
+    
+    for(auto s = 0u; s <= ns + 1; s++) {
+        delta.at(i).at(s).clear();
+        inverse_delta.at(i).at(s).clear();
+        bar_delta.at(i).at(s).clear();
+        bar_inverse_delta.at(i).at(s).clear();
+        
+        for(auto t = 0u; t <= ni + 1; t++) {
+            if(v.at(i).at(s).at(t)) {
+                v.at(i).at(s).at(t) = false;
+                remove_vertex_owner(i, s, t);
+            }
+            
+            std::fill(adj.at(i).at(s).at(t).begin(), adj.at(i).at(s).at(t).end(), false);
+            std::fill(costs.at(i).at(s).at(t).begin(), costs.at(i).at(s).at(t).end(), cost_type(0));
+            n_out.at(i).at(s).at(t) = 0u;
+            n_in.at(i).at(s).at(t) = 0u;
+        }
+    }
+    
+    n_nodes.at(i) = 0u;
+    n_arcs.at(i) = 0u;
+    first_time_we_need_tau.at(i) = 0u;
+    
+    build({i}, ns, ni, p, trn, mnt, seg, net, tiw, pri, cor);
+}
+
+auto graph::build(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor) -> void {
+    calculate_deltas(train_ids, ns, trn, seg);
+    calculate_vertices(train_ids, ns, ni, p, trn, mnt, seg, net, cor);
+    calculate_starting_arcs(train_ids, ni, p, trn, seg, net);
+    calculate_ending_arcs(train_ids, ns, ni, p, trn, net);
+    calculate_escape_arcs(train_ids, ns, ni);
+    calculate_stop_arcs(train_ids, ns, ni, net);
+    calculate_movement_arcs(train_ids, ns, ni, net);
+    cleanup(train_ids, ns, ni);
+    calculate_costs(train_ids, ns, ni, trn, net, tiw, pri);
+}
+
+auto graph::add_vertex_owner(unsigned int i, unsigned int s, unsigned int t) -> void {
+    // Keeps the list sorted when a single train's graph is rebuilt
+    auto& owners = trains_for.at(s).at(t);
+    
+    owners.insert(std::upper_bound(owners.begin(), owners.end(), i), i);
+}
+
+auto graph::remove_vertex_owner(unsigned int i, unsigned int s, unsigned int t) -> void {
+    auto& owners = trains_for.at(s).at(t);
+    
+    owners.erase(std::remove(owners.begin(), owners.end(), i), owners.end());
+    
+    // As in calculate_vertices, v_for_someone is only set for the actual segments, not for sigma and tau
+    if(s == 0u || s + 1u == v_for_someone.size()) {
+        return;
+    }
+    
+    // Only the trains in trains_for can have the vertex, so there is no need to look at all the others
+    v_for_someone.at(s).at(t) = std::any_of(owners.begin(), owners.end(), [&] (unsigned int j) { return v.at(j).at(s).at(t); });
+}
+
+auto graph::calculate_deltas(const uint_vector& train_ids, unsigned int ns, const trains& trn, const segments& seg) -> void {
+    profiler::span phase("graph/calculate_deltas");
+    
+    for(auto i : train_ids) {
+        for(auto s1 = 0u; s1 <= ns + 1; s1++) {
             delta.at(i).at(s1).push_back(s1);
             inverse_delta.at(i).at(s1).push_back(s1);
             
@@ -61,36 +124,34 @@ auto graph::calculate_deltas(unsigned int nt, unsigned int ns, const trains& trn
                 bar_delta.at(i).at(s1).push_back(ns + 1);
                 bar_inverse_delta.at(i).at(ns + 1).push_back(s1);
             }
-        }
-        
-        for(auto s2 = 0u; s2 <= ns + 1; s2++) {
-            if(seg.e_ext.at(s1) == seg.w_ext.at(s2) || seg.w_ext.at(s1) == seg.e_ext.at(s2)) {                
-                for(auto i = 0u; i < nt; i++) {
-                    if( (seg.e_ext.at(s1) == seg.w_ext.at(s2) && trn.is_eastbound.at(i)) ||
-                        (seg.w_ext.at(s1) == seg.e_ext.at(s2) && trn.is_westbound.at(i))
-                    ) {
-                        assert(s1 != s2);
-                        
-                        delta.at(i).at(s1).push_back(s2);
-                        bar_delta.at(i).at(s1).push_back(s2);
-                    }
+            
+            for(auto s2 = 0u; s2 <= ns + 1; s2++) {
+                if( (seg.e_ext.at(s1) == seg.w_ext.at(s2) && trn.is_eastbound.at(i)) ||
+                    (seg.w_ext.at(s1) == seg.e_ext.at(s2) && trn.is_westbound.at(i))
+                ) {
+                    assert(s1 != s2);
                     
-                    if( (seg.e_ext.at(s1) == seg.w_ext.at(s2) && trn.is_westbound.at(i)) ||
-                        (seg.w_ext.at(s1) == seg.e_ext.at(s2) && trn.is_eastbound.at(i))
-                    ) {
-                        assert(s1 != s2);
-                        
-                        inverse_delta.at(i).at(s1).push_back(s2);
-                        bar_inverse_delta.at(i).at(s1).push_back(s2);
-                    }
+                    delta.at(i).at(s1).push_back(s2);
+                    bar_delta.at(i).at(s1).push_back(s2);
+                }
+                
+                if( (seg.e_ext.at(s1) == seg.w_ext.at(s2) && trn.is_westbound.at(i)) ||
+                    (seg.w_ext.at(s1) == seg.e_ext.at(s2) && trn.is_eastbound.at(i))
+                ) {
+                    assert(s1 != s2);
+                    
+                    inverse_delta.at(i).at(s1).push_back(s2);
+                    bar_inverse_delta.at(i).at(s1).push_back(s2);
                 }
             }
         }
     }
 }
 
-auto graph::calculate_vertices(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net) -> void {
-    for(auto i = 0u; i < nt; i++) {                
+auto graph::calculate_vertices(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const corridor& cor) -> void {
+    profiler::span phase("graph/calculate_vertices");
+    
+    for(auto i : train_ids) {
         for(auto s = 1u; s <= ns; s++) {
             if(trn.is_hazmat.at(i) && seg.type.at(s) == 'S') {
                 continue;
@@ -115,37 +176,47 @@ auto graph::calculate_vertices(unsigned int nt, unsigned int ns, unsigned int ni
                 
                 if( p.heuristics.constructive.active &&
                     p.heuristics.constructive.corridor.active &&
-                    t > net.min_time_to_arrive.at(i).at(s) + p.heuristics.constructive.corridor.max_delay_over_fastest_route
+                    t > net.min_time_to_arrive_at_chain_end(i, s, trn) + p.heuristics.constructive.corridor.max_delay_over_fastest_route
                 ) {
                     continue;
                 }
                 
+                if(!cor.contains(i, s, t)) {
+                    continue;
+                }
+                
                 v.at(i).at(s).at(t) = true;
                 n_nodes.at(i)++;
                 v_for_someone.at(s).at(t) = true;
-                trains_for.at(s).at(t).push_back(i);
+                add_vertex_owner(i, s, t);
             }
         }
         
         for(auto t = 0u; t <= ni; t++) {
             v.at(i).at(0).at(t) = true;
             n_nodes.at(i)++;
-            trains_for.at(0).at(t).push_back(i);
+            add_vertex_owner(i, 0, t);
         }
         
         for(auto t = first_time_we_need_tau.at(i); t <= ni + 1; t++) {
             v.at(i).at(ns + 1).at(t) = true;
             n_nodes.at(i)++;
-            trains_for.at(ns + 1).at(t).push_back(i);
+            add_vertex_owner(i, ns + 1, t);
         }
     }
 }
 
-auto graph::calculate_starting_arcs(unsigned int nt, unsigned int ni, const params& p, const trains& trn, const segments& seg, const network& net) -> void {
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_starting_arcs(const uint_vector& train_ids, unsigned int ni, const params& p, const trains& trn, const segments& seg, const network& net) -> void {
+    profiler::span phase("graph/calculate_starting_arcs");
+    
+    for(auto i : train_ids) {
         for(auto s : trn.orig_segs.at(i)) {
             for(auto t = trn.entry_time.at(i); t <= ni - net.min_travel_time.at(i).at(s); t++) {
                 
+                if(trn.has_fixed_entry.at(i) && t != trn.entry_time.at(i)) {
+                    continue;
+                }
+                
                 if(p.heuristics.constructive.active) {
                     if(p.heuristics.constructive.only_start_at_main && seg.type.at(s) == 'S') {
                         continue;
@@ -168,8 +239,10 @@ auto graph::calculate_starting_arcs(unsigned int nt, unsigned int ni, const para
     }
 }
 
-auto graph::calculate_ending_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const network& net) -> void {
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_ending_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const network& net) -> void {
+    profiler::span phase("graph/calculate_ending_arcs");
+    
+    for(auto i : train_ids) {
         for(auto s : trn.dest_segs.at(i)) {
             for(auto t = net.min_time_to_arrive.at(i).at(s) + net.min_travel_time.at(i).at(s) - 1; t <= ni; t++) {
                 if(v.at(i).at(s).at(t)) {
@@ -191,8 +264,10 @@ auto graph::calculate_ending_arcs(unsigned int nt, unsigned int ns, unsigned int
     }
 }
 
-auto graph::calculate_escape_arcs(unsigned int nt, unsigned int ns, unsigned int ni) -> void {
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_escape_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni) -> void {
+    profiler::span phase("graph/calculate_escape_arcs");
+    
+    for(auto i : train_ids) {
         for(auto s = 1u; s <= ns; s++) {
             if(v.at(i).at(s).at(ni) && v.at(i).at(ns + 1).at(ni + 1)) {
                 adj.at(i).at(s).at(ni).at(ns + 1) = true;
@@ -204,8 +279,10 @@ auto graph::calculate_escape_arcs(unsigned int nt, unsigned int ns, unsigned int
     }
 }
 
-auto graph::calculate_stop_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const network& net) -> void {
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_stop_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const network& net) -> void {
+    profiler::span phase("graph/calculate_stop_arcs");
+    
+    for(auto i : train_ids) {
         for(auto s = 1u; s <= ns; s++) {            
             for(auto t = net.min_time_to_arrive.at(i).at(s); t < ni; t++) {
                 if(v.at(i).at(s).at(t) && v.at(i).at(s).at(t + 1)) {
@@ -219,8 +296,10 @@ auto graph::calculate_stop_arcs(unsigned int nt, unsigned int ns, unsigned int n
     }
 }
 
-auto graph::calculate_movement_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const network& net) -> void {
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_movement_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const network& net) -> void {
+    profiler::span phase("graph/calculate_movement_arcs");
+    
+    for(auto i : train_ids) {
         for(auto s1 = 1u; s1 <= ns; s1++) {            
             for(auto s2 = 1u; s2 <= ns; s2++) {
                 if(std::find(bar_delta.at(i).at(s1).begin(), bar_delta.at(i).at(s1).end(), s2) != bar_delta.at(i).at(s1).end()) {
@@ -239,7 +318,16 @@ auto graph::calculate_movement_arcs(unsigned int nt, unsigned int ns, unsigned i
 }
 
 auto graph::cleanup(unsigned int nt, unsigned int ns, unsigned int ni) -> void {
-    for(auto i = 0u; i < nt; i++) {
+    auto all_trains = uint_vector(nt);
+    std::iota(all_trains.begin(), all_trains.end(), 0u);
+    
+    cleanup(all_trains, ns, ni);
+}
+
+auto graph::cleanup(const uint_vector& train_ids, unsigned int ns, unsigned int ni) -> void {
+    profiler::span phase("graph/cleanup");
+    
+    for(auto i : train_ids) {
         auto clean = false;
 
         while(!clean) {
@@ -274,15 +362,7 @@ auto graph::cleanup(unsigned int nt, unsigned int ns, unsigned int ni) -> void {
                             n_out.at(i).at(s1).at(t1) = 0;
                             v.at(i).at(s1).at(t1) = false;
                             n_nodes.at(i)--;
-                            
-                            auto still_valid_vertex = false;
-                            for(auto j = 0u; j < nt; j++) {
-                                if(v.at(j).at(s1).at(t1)) {
-                                    still_valid_vertex = true;
-                                    break;
-                                }
-                            }
-                            v_for_someone.at(s1).at(t1) = still_valid_vertex;
+                            remove_vertex_owner(i, s1, t1);
                             clean = false;
                         }
                     }
@@ -292,13 +372,15 @@ auto graph::cleanup(unsigned int nt, unsigned int ns, unsigned int ni) -> void {
     }
 }
 
-auto graph::calculate_costs(unsigned int nt, unsigned int ns, unsigned int ni, const trains& trn, const network& net, const time_windows& tiw, const prices& pri) -> void {    
-    for(auto i = 0u; i < nt; i++) {
+auto graph::calculate_costs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const trains& trn, const network& net, const time_windows& tiw, const prices& pri) -> void {
+    profiler::span phase("graph/calculate_costs");
+    
+    for(auto i : train_ids) {
         for(auto s : trn.orig_segs.at(i)) {
             for(auto t = trn.entry_time.at(i) + 1; t <= ni - net.min_travel_time.at(i).at(s); t++) {
                 if(adj.at(i).at(0).at(t - 1).at(s)) {
                     auto delay = t - trn.entry_time.at(i);
-                    costs.at(i).at(0).at(t - 1).at(s) += delay * pri.delay.at(trn.type.at(i));
+                    costs.at(i).at(0).at(t - 1).at(s) += prices::to_cost(delay * pri.delay.at(trn.type.at(i)));
                 }
             }
         }
@@ -308,12 +390,12 @@ auto graph::calculate_costs(unsigned int nt, unsigned int ns, unsigned int ni, c
                 if(adj.at(i).at(s).at(t).at(ns + 1)) {
                     if(t < trn.want_time.at(i) - tiw.wt_left) {
                         auto advance = trn.want_time.at(i) - tiw.wt_left - t;
-                        costs.at(i).at(s).at(t).at(ns + 1) += pri.wt * advance;
+                        costs.at(i).at(s).at(t).at(ns + 1) += prices::to_cost(pri.wt * advance);
                     }
                     
                     if(t > trn.want_time.at(i) + tiw.wt_right + 1) {
                         auto delay = t - trn.want_time.at(i) - tiw.wt_right - 1;
-                        costs.at(i).at(s).at(t).at(ns + 1) += pri.wt * delay;
+                        costs.at(i).at(s).at(t).at(ns + 1) += prices::to_cost(pri.wt * delay);
                     }
                 }
             }
@@ -325,7 +407,7 @@ auto graph::calculate_costs(unsigned int nt, unsigned int ns, unsigned int ni, c
                     for(auto s2 : bar_delta.at(i).at(s1)) {
                         if(adj.at(i).at(s1).at(t).at(s2)) {
                             auto delay = t - trn.sa_times.at(i).at(n) - tiw.sa_right - 1;
-                            costs.at(i).at(s1).at(t).at(s2) += pri.sa * delay;
+                            costs.at(i).at(s1).at(t).at(s2) += prices::to_cost(pri.sa * delay);
                         }
                     }
                 }
@@ -336,7 +418,7 @@ auto graph::calculate_costs(unsigned int nt, unsigned int ns, unsigned int ni, c
             for(auto t = net.min_time_to_arrive.at(i).at(s); t < ni; t++) {
                 for(auto ss : inverse_delta.at(i).at(s)) {
                     if(adj.at(i).at(ss).at(t-1).at(s)) {
-                        costs.at(i).at(ss).at(t-1).at(s) += pri.unpreferred;
+                        costs.at(i).at(ss).at(t-1).at(s) += prices::to_cost(pri.unpreferred);
                     }
                 }
             }
@@ -2,6 +2,7 @@
 #define GRAPH_H
 
 #include <data/array.h>
+#include <data/corridor.h>
 #include <data/mows.h>
 #include <data/network.h>
 #include <data/prices.h>
@@ -49,7 +50,7 @@ struct graph {
     uint_matrix_3d n_in;
     
     /*! Indexed as (tr, s1, t, s2) it is the cost of arc (s1, t) -> (s2, t + 1) in tr's graph */
-    double_matrix_4d costs;
+    cost_matrix_4d costs;
     
     /*! Indexed over tr, it is the first time we need tau in tr's graph, i.e. earliest possible arrival time at the destination terminal */
     uint_vector first_time_we_need_tau;
@@ -58,24 +59,33 @@ struct graph {
     graph() {}
     
     /*! Construct from data already read from the JSON data file */
-    graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri);
+    graph(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor);
     
     /*! Only keep trains specified in the vector */
     auto only_trains(const uint_vector& trains, unsigned int nt, unsigned int ns, unsigned int ni) -> void;
     
     /*! Cleans up unreachable nodes and unusable arcs */
     auto cleanup(unsigned int nt, unsigned int ns, unsigned int ni) -> void;
+    
+    /*! Rebuilds the graph of train i in place, e.g. after its entry time changed and its arrival times were updated in the network.
+     *  The other trains' graphs are untouched, and v_for_someone and trains_for are only fixed at the vertices train i loses or gains.
+     */
+    auto update_train(unsigned int i, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor) -> void;
         
 private:
     
-    auto calculate_deltas(unsigned int nt, unsigned int ns, const trains& trn, const segments& seg) -> void;
-    auto calculate_vertices(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net) -> void;
-    auto calculate_starting_arcs(unsigned int nt, unsigned int ni, const params& p, const trains& trn, const segments& seg, const network& net) -> void;
-    auto calculate_ending_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const network& net) -> void;
-    auto calculate_escape_arcs(unsigned int nt, unsigned int ns, unsigned int ni) -> void;
-    auto calculate_stop_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const network& net) -> void;
-    auto calculate_movement_arcs(unsigned int nt, unsigned int ns, unsigned int ni, const network& net) -> void;
-    auto calculate_costs(unsigned int nt, unsigned int ns, unsigned int ni, const trains& trn, const network& net, const time_windows& tiw, const prices& pri) -> void;
+    auto build(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const time_windows& tiw, const prices& pri, const corridor& cor) -> void;
+    auto calculate_deltas(const uint_vector& train_ids, unsigned int ns, const trains& trn, const segments& seg) -> void;
+    auto calculate_vertices(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const mows& mnt, const segments& seg, const network& net, const corridor& cor) -> void;
+    auto calculate_starting_arcs(const uint_vector& train_ids, unsigned int ni, const params& p, const trains& trn, const segments& seg, const network& net) -> void;
+    auto calculate_ending_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const params& p, const trains& trn, const network& net) -> void;
+    auto calculate_escape_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni) -> void;
+    auto calculate_stop_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const network& net) -> void;
+    auto calculate_movement_arcs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const network& net) -> void;
+    auto cleanup(const uint_vector& train_ids, unsigned int ns, unsigned int ni) -> void;
+    auto calculate_costs(const uint_vector& train_ids, unsigned int ns, unsigned int ni, const trains& trn, const network& net, const time_windows& tiw, const prices& pri) -> void;
+    auto add_vertex_owner(unsigned int i, unsigned int s, unsigned int t) -> void;
+    auto remove_vertex_owner(unsigned int i, unsigned int s, unsigned int t) -> void;
     
     auto clear_graph_for_train(unsigned int i, unsigned int ns, unsigned int ni) -> void;
 };
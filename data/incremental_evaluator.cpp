@@ -0,0 +1,275 @@
+#include <data/incremental_evaluator.h>
+#include <data/occupancy.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace {
+    auto by_entry(const schedule_evaluator::visit& v, unsigned int t) -> bool {
+        return v.entry < t;
+    }
+    
+    auto same_visit(const schedule_evaluator::visit& v, const schedule_evaluator::visit& w) -> bool {
+        return v.train == w.train && v.seg == w.seg && v.entry == w.entry && v.leave == w.leave;
+    }
+    
+    auto contains(const bv<schedule_evaluator::visit>& visits, const schedule_evaluator::visit& v) -> bool {
+        return std::any_of(visits.begin(), visits.end(), [&] (const schedule_evaluator::visit& w) { return same_visit(v, w); });
+    }
+}
+
+incremental_evaluator::incremental_evaluator(const data& d, const bv<path>& paths) : incremental_evaluator(d, [&] () {
+    auto nodes = bv<bv<path::node>>();
+    
+    for(const auto& p : paths) {
+        nodes.push_back(p.p);
+    }
+    
+    return nodes;
+}()) {}
+
+incremental_evaluator::incremental_evaluator(const data& d, const bv<bv<path::node>>& nodes) : d{d}, checker{d} {
+    assert(nodes.size() == d.nt);
+    
+    this->nodes = bv<bv<path::node>>(d.nt);
+    costs = bv<path::cost_breakdown>(d.nt);
+    timeline = bv<bv<visit>>(d.ns + 2);
+    sidings_of = uint_matrix_2d(d.ns + 2);
+    
+    for(auto sd : d.net.sidings) {
+        for(auto mm : d.net.main_tracks.at(sd)) {
+            sidings_of.at(mm).push_back(sd);
+        }
+    }
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        apply(evaluate(i, nodes.at(i)));
+    }
+}
+
+auto incremental_evaluator::evaluate(unsigned int train, bv<path::node> p) const -> change {
+    auto c = change();
+    auto removed = bv<visit>();
+    auto added = bv<visit>();
+    
+    c.train = train;
+    changed_visits(nodes.at(train), p, train, removed, added);
+    
+    // The cost of the ends of a path takes constant time, so it is computed anyway
+    c.delta = path::ends_cost_of(d, train, p);
+    c.delta -= path::ends_cost_of(d, train, nodes.at(train));
+    
+    for(const auto& v : removed) {
+        c.delta -= path::visit_cost_of(d, train, v.seg, v.entry, v.leave);
+    }
+    
+    for(const auto& v : added) {
+        c.delta += path::visit_cost_of(d, train, v.seg, v.entry, v.leave);
+        
+        checker.check_visit(v, c.conflicts);
+        check_timeline(v, c.conflicts);
+        
+        if(d.seg.type.at(v.seg) == 'S') {
+            auto non_sa = occupancy::no_train;
+            
+            if(!main_track_users(v.seg, v.entry, train, removed, added, non_sa)) {
+                c.conflicts.push_back({schedule_evaluator::constraint::siding, train, occupancy::no_train, v.seg, v.entry});
+            }
+            
+            if(d.trn.is_heavy.at(train) && non_sa != occupancy::no_train) {
+                c.conflicts.push_back({schedule_evaluator::constraint::heavy, train, non_sa, v.seg, v.entry});
+            }
+        }
+        
+        if(!d.trn.is_sa.at(train)) {
+            check_heavy_entries(v, c.conflicts);
+        }
+    }
+    
+    // Other trains may have entered a siding relying on this train running on its main tracks
+    for(const auto& v : removed) {
+        check_lost_support(v, removed, added, c.conflicts);
+    }
+    
+    c.p = std::move(p);
+    
+    return c;
+}
+
+auto incremental_evaluator::apply(const change& c) -> void {
+    const auto i = c.train;
+    auto removed = bv<visit>();
+    auto added = bv<visit>();
+    
+    changed_visits(nodes.at(i), c.p, i, removed, added);
+    
+    for(const auto& v : removed) {
+        auto& line = timeline.at(v.seg);
+        auto it = std::lower_bound(line.begin(), line.end(), v.entry, by_entry);
+        
+        while(it != line.end() && !same_visit(*it, v)) {
+            ++it;
+        }
+        
+        assert(it != line.end());
+        line.erase(it);
+    }
+    
+    for(const auto& v : added) {
+        auto& line = timeline.at(v.seg);
+        
+        line.insert(std::upper_bound(line.begin(), line.end(), v, [] (const visit& w, const visit& u) { return w.entry < u.entry; }), v);
+    }
+    
+    nodes.at(i) = c.p;
+    costs.at(i) += c.delta;
+    total += c.delta;
+}
+
+auto incremental_evaluator::retimed(const bv<path::node>& p, unsigned int k, int shift) -> bv<path::node> {
+    auto q = p;
+    
+    for(auto n = k; n < q.size(); n++) {
+        assert(static_cast<int>(q.at(n).t) + shift >= 0);
+        q.at(n).t = static_cast<unsigned int>(static_cast<int>(q.at(n).t) + shift);
+    }
+    
+    return q;
+}
+
+auto incremental_evaluator::changed_visits(const bv<path::node>& before, const bv<path::node>& after, unsigned int train, bv<visit>& removed, bv<visit>& added) const -> void {
+    auto same = [] (const path::node& n, const path::node& m) { return n.seg == m.seg && n.t == m.t; };
+    auto shortest = std::min(before.size(), after.size());
+    auto prefix = 0u;
+    auto suffix = 0u;
+    
+    while(prefix < shortest && same(before.at(prefix), after.at(prefix))) {
+        prefix++;
+    }
+    
+    while(suffix < shortest - prefix && same(before.at(before.size() - 1u - suffix), after.at(after.size() - 1u - suffix))) {
+        suffix++;
+    }
+    
+    // Visit k goes from node k to node k + 1, so it is unchanged if both nodes are in the common prefix or both in the common suffix
+    auto collect = [&] (const bv<path::node>& p, bv<visit>& visits) {
+        auto first = std::max(1u, prefix > 0u ? prefix - 1u : 0u);
+        auto last = std::min(static_cast<unsigned int>(p.size() - suffix), static_cast<unsigned int>(p.size() > 0u ? p.size() - 1u : 0u));
+        
+        for(auto k = first; k < last; k++) {
+            visits.push_back({train, p.at(k).seg, p.at(k).t, p.at(k + 1u).t - 1u});
+        }
+    };
+    
+    collect(before, removed);
+    collect(after, added);
+}
+
+auto incremental_evaluator::check_timeline(const visit& v, bv<violation>& conflicts) const -> void {
+    const auto& line = timeline.at(v.seg);
+    auto it = std::lower_bound(line.begin(), line.end(), v.entry, by_entry);
+    
+    // The closest visits of other trains before and after this one: if they respect the headway, so do all the others
+    auto after = it;
+    
+    while(after != line.end() && after->train == v.train) {
+        ++after;
+    }
+    
+    if(after != line.end()) {
+        if(after->entry <= v.leave) {
+            conflicts.push_back({schedule_evaluator::constraint::max_one_train, v.train, after->train, v.seg, v.entry});
+        } else if(after->entry - v.leave <= d.headway) {
+            conflicts.push_back({schedule_evaluator::constraint::headway, v.train, after->train, v.seg, v.entry});
+        }
+    }
+    
+    auto before = it;
+    
+    while(before != line.begin() && std::prev(before)->train == v.train) {
+        --before;
+    }
+    
+    if(before != line.begin()) {
+        const auto& w = *std::prev(before);
+        
+        if(v.entry <= w.leave) {
+            conflicts.push_back({schedule_evaluator::constraint::max_one_train, v.train, w.train, v.seg, v.entry});
+        } else if(v.entry - w.leave <= d.headway) {
+            conflicts.push_back({schedule_evaluator::constraint::headway, v.train, w.train, v.seg, v.entry});
+        }
+    }
+}
+
+auto incremental_evaluator::check_heavy_entries(const visit& v, bv<violation>& conflicts) const -> void {
+    // A heavy train entering one of the sidings at time t forbids the main tracks from t - headway to t + headway
+    auto from = (v.entry > d.headway ? v.entry - d.headway : 0u);
+    auto to = v.leave + d.headway;
+    
+    for(auto sd : sidings_of.at(v.seg)) {
+        const auto& line = timeline.at(sd);
+        
+        for(auto it = std::lower_bound(line.begin(), line.end(), from, by_entry); it != line.end() && it->entry <= to; ++it) {
+            if(it->train != v.train && d.trn.is_heavy.at(it->train)) {
+                conflicts.push_back({schedule_evaluator::constraint::heavy, it->train, v.train, sd, it->entry});
+            }
+        }
+    }
+}
+
+auto incremental_evaluator::check_lost_support(const visit& v, const bv<visit>& removed, const bv<visit>& added, bv<violation>& conflicts) const -> void {
+    auto from = (v.entry > d.headway ? v.entry - d.headway : 0u);
+    auto to = v.leave + d.headway;
+    
+    for(auto sd : sidings_of.at(v.seg)) {
+        const auto& line = timeline.at(sd);
+        
+        for(auto it = std::lower_bound(line.begin(), line.end(), from, by_entry); it != line.end() && it->entry <= to; ++it) {
+            auto non_sa = occupancy::no_train;
+            
+            if(it->train != v.train && !main_track_users(sd, it->entry, it->train, removed, added, non_sa)) {
+                conflicts.push_back({schedule_evaluator::constraint::siding, it->train, v.train, sd, it->entry});
+            }
+        }
+    }
+}
+
+auto incremental_evaluator::main_track_users(unsigned int sd, unsigned int t, unsigned int train, const bv<visit>& removed, const bv<visit>& added, unsigned int& non_sa) const -> bool {
+    auto from = (t > d.headway ? std::max(1u, t - d.headway) : 1u);
+    auto to = std::min(t + d.headway, d.ni + 1u);
+    auto someone = false;
+    
+    auto use = [&] (const visit& w) {
+        if(w.train != train && w.entry <= to && w.leave >= from) {
+            someone = true;
+            
+            if(!d.trn.is_sa.at(w.train)) {
+                non_sa = w.train;
+            }
+        }
+    };
+    
+    for(auto mm : d.net.main_tracks.at(sd)) {
+        const auto& line = timeline.at(mm);
+        auto it = std::upper_bound(line.begin(), line.end(), to, [] (unsigned int time, const visit& w) { return time < w.entry; });
+        
+        // Going backwards from the last visit entering by the end of the window, the visits leave before its start
+        while(it != line.begin() && std::prev(it)->leave >= from) {
+            --it;
+            
+            if(!contains(removed, *it)) {
+                use(*it);
+            }
+        }
+    }
+    
+    // The visits which are about to be added, e.g. of a train rerouted on the main tracks
+    for(const auto& w : added) {
+        if(std::find(d.net.main_tracks.at(sd).begin(), d.net.main_tracks.at(sd).end(), w.seg) != d.net.main_tracks.at(sd).end()) {
+            use(w);
+        }
+    }
+    
+    return someone;
+}
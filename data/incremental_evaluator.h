@@ -0,0 +1,86 @@
+#ifndef INCREMENTAL_EVALUATOR_H
+#define INCREMENTAL_EVALUATOR_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <data/schedule_evaluator.h>
+
+/*! \brief This class keeps a schedule, one succession of nodes per train, together with the cost of each train and, for each segment,
+ *  the timeline of the trains visiting it sorted by entry time, so that replacing the path of one train can be evaluated without
+ *  evaluating the whole schedule again. The old and the new path are compared node by node, and only the visits which differ are
+ *  priced and checked against the timelines: retiming the end of a path, or rerouting it through a siding, takes time proportional
+ *  to the part of the path which changes, times the logarithm of the number of trains visiting a segment.
+ */
+struct incremental_evaluator {
+    using visit = schedule_evaluator::visit;
+    using violation = schedule_evaluator::violation;
+    
+    /*! \brief The replacement of the path of one train, and its effects */
+    struct change {
+        /*! The train */
+        unsigned int train;
+        
+        /*! Its new succession of nodes */
+        bv<path::node> p;
+        
+        /*! How much each kind of penalty changes: negative values are improvements */
+        path::cost_breakdown delta;
+        
+        /*! The constraints violated by the part of the new path which changed, either by itself or with the other trains */
+        bv<violation> conflicts;
+        
+        /*! Tells wether the new path violates no constraint */
+        auto is_feasible() const -> bool { return conflicts.empty(); }
+    };
+    
+    /*! The problem data */
+    const data& d;
+    
+    /*! Starts from a schedule given by one path per train */
+    incremental_evaluator(const data& d, const bv<path>& paths);
+    
+    /*! Starts from a schedule given by one succession of nodes per train */
+    incremental_evaluator(const data& d, const bv<bv<path::node>>& nodes);
+    
+    /*! The objective function of the current schedule */
+    auto cost() const -> double { return total.total(); }
+    
+    /*! The cost of the current path of the train, split by penalty */
+    auto cost_of(unsigned int train) const -> const path::cost_breakdown& { return costs.at(train); }
+    
+    /*! The current succession of nodes of the train */
+    auto nodes_of(unsigned int train) const -> const bv<path::node>& { return nodes.at(train); }
+    
+    /*! Evaluates replacing the path of the train with p, without changing the schedule. An empty p unschedules the train */
+    auto evaluate(unsigned int train, bv<path::node> p) const -> change;
+    
+    /*! Replaces the path of the train. The change must have been evaluated against the train's current path */
+    auto apply(const change& c) -> void;
+    
+    /*! A copy of p in which the train enters the k-th segment, and all the following ones, shift time intervals later (or earlier,
+     *  if shift is negative). With k = 1 the whole path is retimed; with a larger k the train stops longer in segment k - 1
+     */
+    static auto retimed(const bv<path::node>& p, unsigned int k, int shift) -> bv<path::node>;
+
+private:
+    
+    schedule_evaluator checker;
+    bv<bv<path::node>> nodes;
+    bv<path::cost_breakdown> costs;
+    path::cost_breakdown total;
+    
+    // Indexed over s, visits of all trains to s, sorted by entry time
+    bv<bv<visit>> timeline;
+    
+    // Indexed over s, if s is a main track, is the list of sidings s is a main track of
+    uint_matrix_2d sidings_of;
+    
+    auto changed_visits(const bv<path::node>& before, const bv<path::node>& after, unsigned int train, bv<visit>& removed, bv<visit>& added) const -> void;
+    auto check_timeline(const visit& v, bv<violation>& conflicts) const -> void;
+    auto check_heavy_entries(const visit& v, bv<violation>& conflicts) const -> void;
+    auto check_lost_support(const visit& v, const bv<visit>& removed, const bv<visit>& added, bv<violation>& conflicts) const -> void;
+    auto main_track_users(unsigned int sd, unsigned int t, unsigned int train, const bv<visit>& removed, const bv<visit>& added, unsigned int& non_sa) const -> bool;
+};
+
+#endif
@@ -17,6 +17,19 @@ mows::mows(const ptree& pt, unsigned int ni, unsigned int ns, const segments& se
         assert(end_time.back() - start_time.back() >= 0u);
     }
     
+    // Frozen occupations are not part of the JSON data files, but only of the data built in memory
+    if(auto frozen = pt.get_child_optional("frozen")) {
+        BOOST_FOREACH(const ptree::value_type& frozen_child, *frozen) {
+            frozen_seg.push_back(frozen_child.second.get<unsigned int>("segment"));
+            frozen_start_time.push_back(frozen_child.second.get<unsigned int>("start_time"));
+            frozen_end_time.push_back(frozen_child.second.get<unsigned int>("end_time"));
+            
+            assert(frozen_seg.back() >= 1u && frozen_seg.back() <= ns);
+            assert(frozen_end_time.back() < ni);
+            assert(frozen_start_time.back() <= frozen_end_time.back());
+        }
+    }
+    
     is_mow = bool_matrix_2d(ns + 2, bool_vector(ni + 2, false));
     calculate_is_mow(ns, seg);
 }
@@ -31,4 +44,10 @@ auto mows::calculate_is_mow(unsigned int ns, const segments& seg) -> void {
             }
         }
     }
+    
+    for(auto m = 0u; m < frozen_seg.size(); m++) {
+        for(auto t = frozen_start_time.at(m); t <= frozen_end_time.at(m); t++) {
+            is_mow.at(frozen_seg.at(m)).at(t) = true;
+        }
+    }
 }
\ No newline at end of file
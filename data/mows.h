@@ -18,7 +18,18 @@ struct mows {
     /*! End time of the MOWs */
     uint_vector end_time;
     
-    /*! Is true for (s,t) iff segment s is interested by a MOW at time t */
+    /*! Segments occupied by trains whose paths are already fixed, e.g. before a window of the rolling-horizon solver: the
+     *  segment is blocked as if it was under MOW, but the other segments with the same extremes are not
+     */
+    uint_vector frozen_seg;
+    
+    /*! Start time of the frozen occupations */
+    uint_vector frozen_start_time;
+    
+    /*! End time of the frozen occupations */
+    uint_vector frozen_end_time;
+    
+    /*! Is true for (s,t) iff segment s is interested by a MOW, or by a frozen occupation, at time t */
     bool_matrix_2d is_mow;
     
     /*! Empty constructor */
@@ -1,13 +1,37 @@
 #include <data/network.h>
+#include <profiler/profiler.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
+#include <map>
+#include <set>
 
-network::network(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg) {
+namespace {
+    auto trivial_chains(unsigned int ns) -> uint_matrix_2d {
+        auto chain = uint_matrix_2d(ns + 2);
+        
+        for(auto s = 0u; s <= ns + 1; s++) {
+            chain.at(s).push_back(s);
+        }
+        
+        return chain;
+    }
+}
+
+network::network(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg) : network(nt, ns, trn, spd, seg, seg, trivial_chains(ns)) {}
+
+network::network(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg, const segments& original_seg, const uint_matrix_2d& chain) : chain{chain} {
+    profiler::span phase("network/build");
+    
     auto large_default = std::numeric_limits<unsigned int>::max();
     
+    assert(chain.size() == ns + 2);
+    
     min_time_to_arrive = uint_matrix_2d(nt, uint_vector(ns + 2, large_default));
     min_travel_time = uint_matrix_2d(nt, uint_vector(ns + 2, large_default));
+    chain_travel_time = uint_matrix_3d(nt, uint_matrix_2d(ns + 2));
     main_tracks = uint_matrix_2d(ns + 2);
     unpreferred = bool_matrix_2d(nt, bool_vector(ns + 2, false));
     connected = bool_matrix_2d(ns + 2, bool_vector(ns + 2, false));
@@ -36,7 +60,7 @@ network::network(unsigned int nt, unsigned int ns, const trains& trn, const spee
         }
     }
     
-    calculate_times(nt, ns, trn, spd, seg);
+    calculate_times(nt, ns, trn, spd, seg, original_seg);
     calculate_main_tracks(ns, seg);
     
     for(auto s1 = 0u; s1 <= ns + 1; s1++) {
@@ -48,44 +72,86 @@ network::network(unsigned int nt, unsigned int ns, const trains& trn, const spee
     }
 }
 
-auto network::calculate_times(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg) -> void {
+auto network::calculate_times(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg, const segments& original_seg) -> void {
+    profiler::span phase("network/calculate_times");
+    
     for(auto i = 0u; i < nt; i++) {
+        update_arrival_times(i, ns, trn, seg);
+        
         for(auto s = 1u; s <= ns; s++) {
-            auto time_from_w = static_cast<unsigned int>(std::ceil(seg.w_min_dist.at(s) / trn.speed_max.at(i)));
-            auto time_from_e = static_cast<unsigned int>(std::ceil(seg.e_min_dist.at(s) / trn.speed_max.at(i)));
+            min_travel_time.at(i).at(s) = 0u;
             
-            min_time_to_arrive.at(i).at(s) = (trn.is_westbound.at(i) ? time_from_e : time_from_w) + trn.entry_time.at(i);
-            
-            auto speed = 0.0;
-            auto speed_aux = 0.0;
-            
-            if(seg.type.at(s) == '0' || seg.type.at(s) == '1' || seg.type.at(s) == '2') {
-                if(trn.is_westbound.at(i)) {
-                    speed = spd.ew;
-                } else {
-                    speed = spd.we;
-                }
-            } else if(seg.type.at(s) == 'S') {
-                speed = spd.siding;
-                speed_aux = spd.swi;
-            } else if(seg.type.at(s) == 'X') {
-                speed = spd.xover;
-            }
-            
-            speed *= trn.speed_multi.at(i);
-            speed_aux *= trn.speed_multi.at(i);
-            
-            if(seg.type.at(s) != 'S') {
-                min_travel_time.at(i).at(s) = std::ceil(seg.length.at(s) / speed);
-            } else {
-                min_travel_time.at(i).at(s) =   std::ceil(seg.original_length.at(s) / speed) +
-                                                std::ceil((seg.length.at(s) - seg.original_length.at(s)) / speed_aux);
+            // For a contracted chain, rounding up is done segment by segment, exactly as if it had not been contracted
+            for(auto o : chain.at(s)) {
+                auto time = travel_time(i, o, trn, spd, original_seg);
+                
+                chain_travel_time.at(i).at(s).push_back(time);
+                min_travel_time.at(i).at(s) += time;
             }
         }
     }
 }
 
+auto network::update_arrival_times(unsigned int tr, unsigned int ns, const trains& trn, const segments& seg) -> void {
+    // Distance of the train's origin from the terminal it runs away from: this is 0 unless the train starts mid-route
+    auto origin_dist = std::numeric_limits<double>::max();
+    
+    for(auto s : trn.orig_segs.at(tr)) {
+        if(s >= 1u && s <= ns) {
+            origin_dist = std::min(origin_dist, trn.is_westbound.at(tr) ? seg.e_min_dist.at(s) : seg.w_min_dist.at(s));
+        }
+    }
+    
+    if(origin_dist == std::numeric_limits<double>::max()) {
+        origin_dist = 0.0;
+    }
+    
+    for(auto s = 1u; s <= ns; s++) {
+        auto time_from_w = static_cast<unsigned int>(std::ceil(std::max(seg.w_min_dist.at(s) - origin_dist, 0.0) / trn.speed_max.at(tr)));
+        auto time_from_e = static_cast<unsigned int>(std::ceil(std::max(seg.e_min_dist.at(s) - origin_dist, 0.0) / trn.speed_max.at(tr)));
+        
+        min_time_to_arrive.at(tr).at(s) = (trn.is_westbound.at(tr) ? time_from_e : time_from_w) + trn.entry_time.at(tr);
+    }
+}
+
+auto network::travel_time(unsigned int i, unsigned int s, const trains& trn, const speeds& spd, const segments& seg) const -> unsigned int {
+    auto speed = 0.0;
+    auto speed_aux = 0.0;
+    
+    if(seg.type.at(s) == '0' || seg.type.at(s) == '1' || seg.type.at(s) == '2') {
+        if(trn.is_westbound.at(i)) {
+            speed = spd.ew;
+        } else {
+            speed = spd.we;
+        }
+    } else if(seg.type.at(s) == 'S') {
+        speed = spd.siding;
+        speed_aux = spd.swi;
+    } else if(seg.type.at(s) == 'X') {
+        speed = spd.xover;
+    }
+    
+    speed *= trn.speed_multi.at(i);
+    speed_aux *= trn.speed_multi.at(i);
+    
+    if(seg.type.at(s) != 'S') {
+        return static_cast<unsigned int>(std::ceil(seg.length.at(s) / speed));
+    } else {
+        return  static_cast<unsigned int>(std::ceil(seg.original_length.at(s) / speed)) +
+                static_cast<unsigned int>(std::ceil((seg.length.at(s) - seg.original_length.at(s)) / speed_aux));
+    }
+}
+
+auto network::min_time_to_arrive_at_chain_end(unsigned int tr, unsigned int s, const trains& trn) const -> unsigned int {
+    const auto& times = chain_travel_time.at(tr).at(s);
+    auto last_time = trn.is_eastbound.at(tr) ? times.back() : times.front();
+    
+    return min_time_to_arrive.at(tr).at(s) + min_travel_time.at(tr).at(s) - last_time;
+}
+
 auto network::calculate_main_tracks(unsigned int ns, const segments& seg) -> void {
+    profiler::span phase("network/calculate_main_tracks");
+    
     for(auto s = 1u; s <= ns; s++) {
         for(auto m = 1u; m <= ns; m++) {
             auto is_main = (
@@ -99,4 +165,133 @@ auto network::calculate_main_tracks(unsigned int ns, const segments& seg) -> voi
             }
         }
     }
+}
+
+auto network::contract_chains(unsigned int ns, const trains& trn, const mows& mnt, const segments& seg, uint_matrix_2d& chain) -> segments {
+    profiler::span phase("network/contract_chains");
+    
+    // Junctions where something happens: a chain can never run through them
+    auto protected_ext = std::set<unsigned int>();
+    protected_ext.insert(trn.orig_ext.begin(), trn.orig_ext.end());
+    protected_ext.insert(trn.dest_ext.begin(), trn.dest_ext.end());
+    protected_ext.insert(mnt.e_ext.begin(), mnt.e_ext.end());
+    protected_ext.insert(mnt.w_ext.begin(), mnt.w_ext.end());
+    for(const auto& sa : trn.sa_ext) {
+        protected_ext.insert(sa.begin(), sa.end());
+    }
+    
+    // Indexed over a junction, lists the segments having it as an extreme
+    auto touching = std::map<unsigned int, uint_vector>();
+    for(auto s = 1u; s <= ns; s++) {
+        touching[seg.w_ext.at(s)].push_back(s);
+        touching[seg.e_ext.at(s)].push_back(s);
+    }
+    
+    // Indexed over s, the trains running over the segment on their way from their origin to their destination
+    auto runs_over = uint_matrix_2d(ns + 2);
+    
+    for(auto i = 0u; i < trn.orig_segs.size(); i++) {
+        // Distance from the terminal the train runs away from
+        auto dist = [&] (unsigned int s) { return trn.is_westbound.at(i) ? seg.e_min_dist.at(s) : seg.w_min_dist.at(s); };
+        auto from = std::numeric_limits<double>::max();
+        auto to = 0.0;
+        
+        for(auto s : trn.orig_segs.at(i)) {
+            if(s >= 1u && s <= ns) {
+                from = std::min(from, dist(s));
+            }
+        }
+        
+        for(auto s : trn.dest_segs.at(i)) {
+            if(s >= 1u && s <= ns) {
+                to = std::max(to, dist(s) + seg.length.at(s));
+            }
+        }
+        
+        if(from == std::numeric_limits<double>::max()) {
+            from = 0.0;
+        }
+        
+        if(to == 0.0) {
+            to = std::numeric_limits<double>::max();
+        }
+        
+        for(auto s = 1u; s <= ns; s++) {
+            if(dist(s) < to && dist(s) + seg.length.at(s) > from) {
+                runs_over.at(s).push_back(i);
+            }
+        }
+    }
+    
+    // If the junction is an inner junction of a chain, returns the segment starting (westwards) at the junction; 0 otherwise.
+    // Two trains could be in different segments of a chain at the same time, while a super-segment only holds one train at a
+    // time: so that the contracted model is exactly the original one, at most one train can run over a chain
+    auto next_in_chain = [&] (unsigned int ext) -> unsigned int {
+        if(protected_ext.count(ext) > 0u || touching.at(ext).size() != 2u) {
+            return 0u;
+        }
+        
+        auto s1 = touching.at(ext).at(0);
+        auto s2 = touching.at(ext).at(1);
+        
+        if(seg.w_ext.at(s1) == ext) {
+            std::swap(s1, s2);
+        }
+        
+        if( seg.e_ext.at(s1) != ext || seg.w_ext.at(s2) != ext ||
+            seg.type.at(s1) != '0' || seg.type.at(s2) != '0' ||
+            seg.is_eastbound.at(s1) != seg.is_eastbound.at(s2) ||
+            seg.is_westbound.at(s1) != seg.is_westbound.at(s2) ||
+            runs_over.at(s1) != runs_over.at(s2) || runs_over.at(s1).size() > 1u
+        ) {
+            return 0u;
+        }
+        
+        return s2;
+    };
+    
+    auto contracted = segments();
+    
+    chain = uint_matrix_2d();
+    
+    auto copy_segment = [&] (unsigned int s) {
+        contracted.e_ext.push_back(seg.e_ext.at(s));
+        contracted.w_ext.push_back(seg.w_ext.at(s));
+        contracted.e_min_dist.push_back(seg.e_min_dist.at(s));
+        contracted.w_min_dist.push_back(seg.w_min_dist.at(s));
+        contracted.length.push_back(seg.length.at(s));
+        contracted.original_length.push_back(seg.original_length.at(s));
+        contracted.type.push_back(seg.type.at(s));
+        contracted.is_eastbound.push_back(seg.is_eastbound.at(s));
+        contracted.is_westbound.push_back(seg.is_westbound.at(s));
+        chain.push_back(uint_vector(1u, s));
+    };
+    
+    // Sigma
+    copy_segment(0u);
+    
+    for(auto s = 1u; s <= ns; s++) {
+        if(next_in_chain(seg.w_ext.at(s)) == s) {
+            // Inner segment of a chain: it is added together with the westernmost one
+            continue;
+        }
+        
+        copy_segment(s);
+        
+        auto current = s;
+        
+        while(auto next = next_in_chain(seg.e_ext.at(current))) {
+            contracted.e_ext.back() = seg.e_ext.at(next);
+            contracted.e_min_dist.back() = seg.e_min_dist.at(next);
+            contracted.length.back() += seg.length.at(next);
+            contracted.original_length.back() += seg.original_length.at(next);
+            chain.back().push_back(next);
+            current = next;
+        }
+    }
+    
+    // Tau
+    copy_segment(ns + 1);
+    
+    return contracted;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define NETWORK_H
 
 #include <data/array.h>
+#include <data/mows.h>
 #include <data/segments.h>
 #include <data/speeds.h>
 #include <data/trains.h>
@@ -29,15 +30,39 @@ struct network {
     /*! For (s1, s2) is true iff s1 and s2 are connected, i.e. share a junction */
     bool_matrix_2d connected;
     
+    /*! Indexed over s, contains the original segments (as numbered in the JSON data file) s is made of, from west to east.
+     *  This is just {s} unless s is a super-segment obtained by contracting a chain of main-track segments
+     */
+    uint_matrix_2d chain;
+    
+    /*! For (tr, s) contains the minimum time train tr needs to occupy each original segment in s's chain, from west to east */
+    uint_matrix_3d chain_travel_time;
+    
     /*! Empty constructor */
     network() {}
     
     /*! Construct from data already read from the JSON data file */
     network(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg);
     
+    /*! Construct from contracted segments, as produced by contract_chains() starting from original_seg */
+    network(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg, const segments& original_seg, const uint_matrix_2d& chain);
+    
+    /*! Minimum time at which train tr can arrive at the last original segment of s's chain, i.e. at s itself unless s is a contracted chain */
+    auto min_time_to_arrive_at_chain_end(unsigned int tr, unsigned int s, const trains& trn) const -> unsigned int;
+    
+    /*! Recomputes the minimum times at which train tr can arrive at each segment, e.g. after its entry time changed */
+    auto update_arrival_times(unsigned int tr, unsigned int ns, const trains& trn, const segments& seg) -> void;
+    
+    /*! Contracts maximal chains of type '0' segments whose inner junctions have no siding, cross-over, terminal, SA point or MOW
+     *  attached, and over which at most one train runs, into super-segments. Returns the contracted segments and fills chain with
+     *  the original segments making up each of them.
+     */
+    static auto contract_chains(unsigned int ns, const trains& trn, const mows& mnt, const segments& seg, uint_matrix_2d& chain) -> segments;
+    
 private:
     
-    auto calculate_times(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg) -> void;
+    auto calculate_times(unsigned int nt, unsigned int ns, const trains& trn, const speeds& spd, const segments& seg, const segments& original_seg) -> void;
+    auto travel_time(unsigned int i, unsigned int s, const trains& trn, const speeds& spd, const segments& seg) const -> unsigned int;
     auto calculate_main_tracks(unsigned int ns, const segments& seg) -> void;
 };
 
@@ -0,0 +1,61 @@
+#include <data/occupancy.h>
+
+#include <algorithm>
+
+constexpr unsigned int occupancy::no_train;
+
+occupancy::occupancy(const data& d) : d{&d} {
+    train_at = uint_matrix_2d(d.ns + 2, uint_vector(d.ni + 2, no_train));
+    heavy_entering = uint_matrix_2d(d.ns + 2, uint_vector(d.ni + 2, no_train));
+}
+
+auto occupancy::reserve(unsigned int train, const bv<path::node>& p) -> void {
+    mark(train, p, train);
+}
+
+auto occupancy::release(unsigned int train, const bv<path::node>& p) -> void {
+    mark(train, p, no_train);
+}
+
+auto occupancy::mark(unsigned int train, const bv<path::node>& p, unsigned int value) -> void {
+    // Skip sigma and tau: the train is in segment p[k].seg from time p[k].t to time p[k + 1].t - 1
+    for(auto k = 1u; k + 1 < p.size(); k++) {
+        auto s = p.at(k).seg;
+        
+        for(auto t = p.at(k).t; t < p.at(k + 1).t; t++) {
+            train_at.at(s).at(t) = value;
+        }
+        
+        if(d->trn.is_heavy.at(train) && d->seg.type.at(s) == 'S') {
+            heavy_entering.at(s).at(p.at(k).t) = value;
+        }
+    }
+}
+
+auto occupancy::occupied_by_others(unsigned int train, unsigned int s, unsigned int from, unsigned int to) const -> bool {
+    to = std::min(to, d->ni + 1);
+    
+    for(auto t = from; t <= to; t++) {
+        if(train_at.at(s).at(t) != no_train && train_at.at(s).at(t) != train) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+auto occupancy::on_main_tracks(unsigned int train, unsigned int sd, unsigned int from, unsigned int to, bool only_non_sa) const -> bool {
+    to = std::min(to, d->ni + 1);
+    
+    for(auto mm : d->net.main_tracks.at(sd)) {
+        for(auto t = from; t <= to; t++) {
+            auto j = train_at.at(mm).at(t);
+            
+            if(j != no_train && j != train && (!only_non_sa || !d->trn.is_sa.at(j))) {
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
@@ -0,0 +1,47 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+
+#include <limits>
+
+/*! \brief This class keeps track of which train occupies each segment at each time interval, so that trains can be scheduled
+ *  one at a time around the trains already scheduled
+ */
+struct occupancy {
+    /*! Value used when no train is occupying a segment */
+    static constexpr unsigned int no_train = std::numeric_limits<unsigned int>::max();
+    
+    /*! A pointer to the problem data */
+    const data* d;
+    
+    /*! Indexed over (s, t), is the train occupying segment s at time t, or no_train */
+    uint_matrix_2d train_at;
+    
+    /*! Indexed over (s, t), is the heavy train entering siding s at time t, or no_train */
+    uint_matrix_2d heavy_entering;
+    
+    /*! Basic constructor: no segment is occupied */
+    occupancy(const data& d);
+    
+    /*! Marks the segments visited by the train as occupied */
+    auto reserve(unsigned int train, const bv<path::node>& p) -> void;
+    
+    /*! Marks the segments visited by the train as free again */
+    auto release(unsigned int train, const bv<path::node>& p) -> void;
+    
+    /*! Tells wether some train other than the given one occupies segment s at some time in [from, to] */
+    auto occupied_by_others(unsigned int train, unsigned int s, unsigned int from, unsigned int to) const -> bool;
+    
+    /*! Tells wether some train other than the given one (and, if only_non_sa is true, not subject to schedule adherence) runs on
+     *  any main track of siding sd at some time in [from, to] */
+    auto on_main_tracks(unsigned int train, unsigned int sd, unsigned int from, unsigned int to, bool only_non_sa) const -> bool;
+
+private:
+    
+    auto mark(unsigned int train, const bv<path::node>& p, unsigned int value) -> void;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include <data/path.h>
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 
 path::path(const data& d, unsigned int train, uint_matrix_3d x, double cost) : d{&d}, train{train}, x{x}, cost{cost} {
@@ -47,9 +49,33 @@ path::path(const data& d, unsigned int train, uint_matrix_3d x, double cost) : d
         
             current_time++;
         }
+        
+        expand();
     }
 }
 
+path::path(const data& d, unsigned int train, bv<node> p, double cost) : d{&d}, train{train}, p{p}, cost{cost} {
+    assert(p.size() >= 2u);
+    assert(p.front().seg == 0u && p.back().seg == d.ns + 1);
+    
+    x = uint_matrix_3d(d.ns + 2, uint_matrix_2d(d.ni + 2, uint_vector(d.ns + 2, 0u)));
+    
+    for(auto k = 0u; k + 1 < p.size(); k++) {
+        auto s = p.at(k).seg;
+        
+        assert(p.at(k).t < p.at(k + 1).t);
+        
+        // The train stops in s until it moves to the next segment
+        for(auto t = p.at(k).t; t + 1 < p.at(k + 1).t; t++) {
+            x.at(s).at(t).at(s) = 1u;
+        }
+        
+        x.at(s).at(p.at(k + 1).t - 1).at(p.at(k + 1).seg) = 1u;
+    }
+    
+    expand();
+}
+
 path::path(const data& d, unsigned int train) : d{&d}, train{train}, cost{0.0} {
     make_dummy();
 }
@@ -61,12 +87,42 @@ auto path::make_dummy() -> void {
     p.push_back(node(0u, 0u));
     p.push_back(node(d->ns + 1, 1u));
     cost = 0.0;
+    expand();
 }
 
 auto path::make_empty() -> void {
     x = uint_matrix_3d(d->ns + 2, uint_matrix_2d(d->ni + 2, uint_vector(d->ns + 2, 0u)));
     p = bv<node>();
     cost = 0.0;
+    expand();
+}
+
+auto path::expand() -> void {
+    original_p = bv<node>();
+    
+    for(auto k = 0u; k < p.size(); k++) {
+        const auto& segs = d->net.chain.at(p.at(k).seg);
+        
+        if(segs.size() == 1u) {
+            original_p.push_back(node(segs.front(), p.at(k).t));
+            continue;
+        }
+        
+        // The train runs through the chain at maximum speed and any excess time is spent in the last original segment
+        assert(k + 1 < p.size());
+        
+        const auto& times = d->net.chain_travel_time.at(train).at(p.at(k).seg);
+        auto entry_time = p.at(k).t;
+        
+        for(auto j = 0u; j < segs.size(); j++) {
+            auto o = d->trn.is_eastbound.at(train) ? j : segs.size() - 1 - j;
+            
+            original_p.push_back(node(segs.at(o), entry_time));
+            entry_time += times.at(o);
+        }
+        
+        assert(entry_time <= p.at(k + 1).t);
+    }
 }
 
 auto path::is_dummy() const -> bool {
@@ -84,49 +140,119 @@ auto path::is_empty() const -> bool {
 auto path::print_summary(std::ostream& where) const -> void {
     where << "** Train: " << train << " **" << std::endl;
     
-    auto current_seg = 0u;
-    auto current_time = 0u;
-    auto current_entry_time = -1;
-
-    while(current_seg != d->ns + 1) {
-        auto next_seg = -1;
-                    
-        if(current_time >= d->ni + 1) {
-            std::cerr << "Could not find a valid path!" << std::endl;
-            break;
+    if(is_empty()) {
+        std::cerr << "Could not find a valid path!" << std::endl;
+        return;
+    }
+    
+    // Segments are the original ones: original_p visits the segments of a contracted chain in the order expand() gives them
+    auto n = 1u;
+    
+    for(auto k = 1u; k + 1 < p.size(); k++) {
+        const auto& times = d->net.chain_travel_time.at(train).at(p.at(k).seg);
+        
+        for(auto j = 0u; j < times.size(); j++, n++) {
+            auto o = d->trn.is_eastbound.at(train) ? j : times.size() - 1 - j;
+            auto leaving_time = original_p.at(n + 1).t - 1;
+            
+            where << "Segment " << original_p.at(n).seg << std::endl;
+            where << "\tEntering at time: " << original_p.at(n).t << std::endl;
+            where << "\tLeaving at time: " << leaving_time << std::endl;
+            where << "\tRunning time: " << (leaving_time - original_p.at(n).t + 1) << std::endl;
+            where << "\tMinimum running time: " << times.at(o) << std::endl;
         }
+    }
+}
+
+auto path::cost_breakdown::operator+=(const cost_breakdown& other) -> cost_breakdown& {
+    delay += other.delay;
+    terminal += other.terminal;
+    sa += other.sa;
+    unpreferred += other.unpreferred;
+    
+    return *this;
+}
+
+auto path::cost_breakdown::operator-=(const cost_breakdown& other) -> cost_breakdown& {
+    delay -= other.delay;
+    terminal -= other.terminal;
+    sa -= other.sa;
+    unpreferred -= other.unpreferred;
+    
+    return *this;
+}
+
+auto path::breakdown_of(const data& d, unsigned int train, const bv<node>& p) -> cost_breakdown {
+    auto cost = ends_cost_of(d, train, p);
+    
+    for(auto k = 1u; k + 1u < p.size(); k++) {
+        cost += visit_cost_of(d, train, p.at(k).seg, p.at(k).t, p.at(k + 1u).t - 1u);
+    }
+    
+    return cost;
+}
+
+auto path::ends_cost_of(const data& d, unsigned int train, const bv<node>& p) -> cost_breakdown {
+    const auto i = train;
+    const auto tau = d.ns + 1u;
+    auto cost = cost_breakdown();
+    
+    if(p.size() < 3u) {
+        return cost;
+    }
+    
+    if(p.at(1).t > d.trn.entry_time.at(i)) {
+        cost.delay += (p.at(1).t - d.trn.entry_time.at(i)) * d.pri.delay.at(d.trn.type.at(i));
+    }
+    
+    // Escaping at the end of the time horizon is not arriving
+    const auto& last = p.at(p.size() - 2u);
+    const auto& dest_segs = d.trn.dest_segs.at(i);
+    
+    if(p.back().seg == tau && std::find(dest_segs.begin(), dest_segs.end(), last.seg) != dest_segs.end()) {
+        auto arrival_time = p.back().t - 1u;
+        auto want_time = d.trn.want_time.at(i);
         
-        for(auto s : d->gr.delta.at(train).at(current_seg)) {
-            if(x.at(current_seg).at(current_time).at(s) > 0u) {
-                next_seg = static_cast<long>(s);
-                break;
-            }
+        if(arrival_time + d.tiw.wt_left < want_time) {
+            cost.terminal += (want_time - d.tiw.wt_left - arrival_time) * d.pri.wt;
         }
         
-        if(next_seg < 0 && current_time == d->ni) {
-            if(x.at(current_seg).at(d->ni).at(d->ns + 1) > 0u) {
-                next_seg = static_cast<long>(d->ns + 1);
-            }
+        if(arrival_time > want_time + d.tiw.wt_right + 1u) {
+            cost.terminal += (arrival_time - want_time - d.tiw.wt_right - 1u) * d.pri.wt;
         }
-            
-        if(next_seg >= 0) {
-            if(static_cast<unsigned int>(next_seg) != current_seg) {
-                if(current_entry_time >= 0l) {
-                    where << "\tLeaving at time: " << current_time << std::endl;
-                    where << "\tRunning time: " << (current_time - current_entry_time + 1) << std::endl;
-                    where << "\tMinimum running time: " << d->net.min_travel_time.at(train).at(current_seg) << std::endl;
-                }
-                
-                if(next_seg != static_cast<long>(d->ns + 1)) {
-                    where << "Segment " << next_seg << std::endl;
-                    where << "\tEntering at time: " << current_time + 1 << std::endl;
-                }
-                
-                current_entry_time = static_cast<long>(current_time + 1);
-            }
-            current_seg = next_seg;
+    }
+    
+    return cost;
+}
+
+auto path::visit_cost_of(const data& d, unsigned int train, unsigned int seg, unsigned int entry_time, unsigned int leaving_time) -> cost_breakdown {
+    const auto i = train;
+    const auto s = seg;
+    auto cost = cost_breakdown();
+    auto running_time = leaving_time - entry_time + 1u;
+    
+    // A path running faster than the minimum travel time is infeasible, but it is not paid for
+    if(running_time > d.net.min_travel_time.at(i).at(s)) {
+        cost.delay += (running_time - d.net.min_travel_time.at(i).at(s)) * d.pri.delay.at(d.trn.type.at(i));
+    }
+    
+    for(auto n = 0u; n < d.trn.sa_num.at(i); n++) {
+        const auto& sa_segs = d.trn.sa_segs.at(i).at(n);
+        auto latest = d.trn.sa_times.at(i).at(n) + d.tiw.sa_right + 1u;
+        
+        if(leaving_time > latest && std::find(sa_segs.begin(), sa_segs.end(), s) != sa_segs.end()) {
+            cost.sa += (leaving_time - latest) * d.pri.sa;
         }
+    }
+    
+    if(d.net.unpreferred.at(i).at(s)) {
+        auto from = std::max(entry_time, d.net.min_time_to_arrive.at(i).at(s));
+        auto to = std::min(leaving_time, d.ni - 1u);
         
-        current_time++;
+        if(from <= to) {
+            cost.unpreferred += (to - from + 1u) * d.pri.unpreferred;
+        }
     }
+    
+    return cost;
 }
\ No newline at end of file
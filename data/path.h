@@ -20,6 +20,33 @@ struct path {
         node(unsigned int seg, unsigned int t) : seg{seg}, t{t} {}
     };
     
+    /*! \brief The cost of a path split by the kind of penalty paid, in the same units as the arc costs */
+    struct cost_breakdown {
+        /*! Entering the network after the entry time, and spending more than the minimum travel time in the segments */
+        double delay;
+        
+        /*! Arriving at the destination terminal outside the time window */
+        double terminal;
+        
+        /*! Passing the SA points after the SA times */
+        double sa;
+        
+        /*! Running on unpreferred tracks */
+        double unpreferred;
+        
+        /*! Empty constructor: nothing is paid */
+        cost_breakdown() : delay{0.0}, terminal{0.0}, sa{0.0}, unpreferred{0.0} {}
+        
+        /*! Sum of all the penalties */
+        auto total() const -> double { return delay + terminal + sa + unpreferred; }
+        
+        /*! Adds the penalties of another path */
+        auto operator+=(const cost_breakdown& other) -> cost_breakdown&;
+        
+        /*! Subtracts the penalties of another path */
+        auto operator-=(const cost_breakdown& other) -> cost_breakdown&;
+    };
+    
     /*! A pointer to the problem data */
     const data* d;
     
@@ -32,12 +59,18 @@ struct path {
     /*! The succession of nodes visited by the train */
     bv<node> p;
     
+    /*! The succession of nodes visited by the train, in terms of the original segments, i.e. with contracted chains expanded */
+    bv<node> original_p;
+    
     /*! The cost of the path */
     double cost;
     
     /*! Constructs the path starting from the variables matrix */
     path(const data& d, unsigned int train, uint_matrix_3d x, double cost);
     
+    /*! Constructs the path from the succession of nodes visited by the train, which must start at sigma and end at tau */
+    path(const data& d, unsigned int train, bv<node> p, double cost);
+    
     /*! Makes a dummy path for the train - It goes from sigma to tau and costs nothing */
     path(const data& d, unsigned int train);
     
@@ -55,6 +88,24 @@ struct path {
     
     /*! Tells wether the path is empty or not */
     auto is_empty() const -> bool;
+    
+    /*! Splits the cost of the path by the kind of penalty */
+    auto breakdown() const -> cost_breakdown { return breakdown_of(*d, train, p); }
+    
+    /*! Splits the cost of a succession of nodes visited by the train, from sigma to tau, by the kind of penalty. This is the cost the
+     *  train's graph gives the path, and it takes time linear in the number of nodes. A dummy or empty path costs nothing.
+     */
+    static auto breakdown_of(const data& d, unsigned int train, const bv<node>& p) -> cost_breakdown;
+    
+    /*! The part of breakdown_of which depends on the ends of the path only: the delay entering the network and the terminal time window */
+    static auto ends_cost_of(const data& d, unsigned int train, const bv<node>& p) -> cost_breakdown;
+    
+    /*! The part of breakdown_of paid in one segment, which the train occupies from entry_time to leaving_time */
+    static auto visit_cost_of(const data& d, unsigned int train, unsigned int seg, unsigned int entry_time, unsigned int leaving_time) -> cost_breakdown;
+    
+private:
+    
+    auto expand() -> void;
 };
 
 #endif
@@ -2,24 +2,50 @@
 #include <data/trains.h>
 
 #include <cassert>
+#include <cmath>
 
 using namespace boost::property_tree;
 using namespace boost;
 
+#if USE_INTEGER_COSTS
+    const double prices::cost_unit = 100.0;
+#else
+    const double prices::cost_unit = 1.0;
+#endif
+
+namespace {
+    // Price read from the data file, in cost units
+    auto scaled(double price) -> double {
+        #if USE_INTEGER_COSTS
+            return std::round(price * prices::cost_unit);
+        #else
+            return price;
+        #endif
+    }
+}
+
 prices::prices(const ptree& pt) {
     for(char cl = trains::first_train_class; cl <= trains::last_train_class; cl++) {
-        auto price = pt.get_child("general_delay_price").get<double>(std::string(1,cl));
+        auto price = scaled(pt.get_child("general_delay_price").get<double>(std::string(1,cl)));
         
         assert(price > 0);
         
         delay.emplace(cl, price);
     }
     
-    wt = pt.get<double>("terminal_delay_price");
-    sa = pt.get<double>("schedule_delay_price");
-    unpreferred = pt.get<double>("unpreferred_price");
+    wt = scaled(pt.get<double>("terminal_delay_price"));
+    sa = scaled(pt.get<double>("schedule_delay_price"));
+    unpreferred = scaled(pt.get<double>("unpreferred_price"));
                     
     assert(wt > 0);
     assert(sa > 0);
     assert(unpreferred > 0);
+}
+
+auto prices::to_cost(double cost) -> cost_type {
+    #if USE_INTEGER_COSTS
+        return static_cast<cost_type>(std::lround(cost));
+    #else
+        return cost;
+    #endif
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef PRICES_H
 #define PRICES_H
 
+#include <data/array.h>
 #include <data/trains.h>
 
 #include <boost/property_tree/ptree.hpp>
@@ -23,11 +24,19 @@ struct prices {
     /* Cost of one time unit of delay on any segment, given for each train class */
     delay_price_map delay;
     
+    /*! Number of cost units in one unit of the prices of the JSON data file: when the project is configured with NEED_INTEGER_COSTS,
+     *  the prices are converted to whole cents when they are read, and all costs are in cents; otherwise this is 1
+     */
+    static const double cost_unit;
+    
     /*! Empty constructor */
     prices() {}
     
     /*! Construct from ptree representing the JSON data file */
     prices(const boost::property_tree::ptree& pt);
+    
+    /*! Converts a cost computed from the prices, e.g. a price times a number of time intervals, to the type of the arc costs */
+    static auto to_cost(double cost) -> cost_type;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include <data/schedule_evaluator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+schedule_evaluator::schedule_evaluator(const data& d) : d{d} {
+    mow_before = uint_matrix_2d(d.ns + 2, uint_vector(d.ni + 3, 0u));
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 0u; t <= d.ni + 1; t++) {
+            mow_before.at(s).at(t + 1) = mow_before.at(s).at(t) + (d.mnt.is_mow.at(s).at(t) ? 1u : 0u);
+        }
+    }
+}
+
+auto schedule_evaluator::evaluate(const bv<path>& paths) const -> evaluation {
+    auto nodes = bv<const bv<path::node>*>();
+    
+    for(const auto& p : paths) {
+        nodes.push_back(&p.p);
+    }
+    
+    return evaluate(nodes);
+}
+
+auto schedule_evaluator::evaluate(const bv<bv<path::node>>& nodes) const -> evaluation {
+    auto pointers = bv<const bv<path::node>*>();
+    
+    for(const auto& p : nodes) {
+        pointers.push_back(&p);
+    }
+    
+    return evaluate(pointers);
+}
+
+auto schedule_evaluator::evaluate(const bv<const bv<path::node>*>& nodes) const -> evaluation {
+    assert(nodes.size() == d.nt);
+    
+    auto e = evaluation();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        auto cost = path::breakdown_of(d, i, *nodes.at(i));
+        
+        e.objective += cost;
+        e.delay_by_class[d.trn.type.at(i)] += cost.delay;
+    }
+    
+    auto first = uint_vector();
+    auto visits = visits_by_segment(nodes, first);
+    
+    for(const auto& v : visits) {
+        check_visit(v, e.violations);
+        
+        if(d.seg.type.at(v.seg) == 'S') {
+            check_siding(v, visits, first, e);
+        }
+    }
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        check_segment(visits, first.at(s), first.at(s + 1), e);
+    }
+    
+    return e;
+}
+
+auto schedule_evaluator::visits_by_segment(const bv<const bv<path::node>*>& nodes, uint_vector& first) const -> bv<visit> {
+    auto visits = bv<visit>();
+    
+    // Skip sigma and tau: the train is in segment p[k].seg from time p[k].t to time p[k + 1].t - 1
+    for(auto i = 0u; i < d.nt; i++) {
+        const auto& p = *nodes.at(i);
+        
+        for(auto k = 1u; k + 1u < p.size(); k++) {
+            assert(p.at(k).t < p.at(k + 1u).t);
+            visits.push_back({i, p.at(k).seg, p.at(k).t, p.at(k + 1u).t - 1u});
+        }
+    }
+    
+    // Two counting sorts, by entry time and then by segment: the second one is stable, so the visits of each segment end up
+    // sorted by entry time, and there is no comparison sort
+    auto sorted = [&] (const bv<visit>& from, unsigned int n_keys, auto key, uint_vector& start) {
+        start = uint_vector(n_keys + 1u, 0u);
+        
+        for(const auto& v : from) {
+            start.at(key(v) + 1u)++;
+        }
+        
+        for(auto k = 0u; k < n_keys; k++) {
+            start.at(k + 1u) += start.at(k);
+        }
+        
+        auto next = start;
+        auto to = from;
+        
+        for(const auto& v : from) {
+            to.at(next.at(key(v))++) = v;
+        }
+        
+        return to;
+    };
+    
+    auto by_time = uint_vector();
+    
+    visits = sorted(visits, d.ni + 2u, [] (const visit& v) { return v.entry; }, by_time);
+    visits = sorted(visits, d.ns + 2u, [] (const visit& v) { return v.seg; }, first);
+    
+    return visits;
+}
+
+auto schedule_evaluator::check_visit(const visit& v, bv<violation>& violations) const -> void {
+    const auto i = v.train;
+    const auto s = v.seg;
+    const auto no_train = occupancy::no_train;
+    auto running_time = v.leave - v.entry + 1u;
+    
+    if(d.seg.type.at(s) == 'S' && d.trn.is_hazmat.at(i)) {
+        violations.push_back({constraint::hazmat, i, no_train, s, v.entry});
+    }
+    
+    if(d.seg.type.at(s) == 'S' && d.trn.length.at(i) > d.seg.original_length.at(s)) {
+        violations.push_back({constraint::length, i, no_train, s, v.entry});
+    }
+    
+    if(mow_before.at(s).at(v.leave + 1u) > mow_before.at(s).at(v.entry)) {
+        violations.push_back({constraint::mow, i, no_train, s, v.entry});
+    }
+    
+    if( running_time < d.net.min_travel_time.at(i).at(s) ||
+        (d.seg.type.at(s) == 'X' && running_time > d.net.min_travel_time.at(i).at(s)) ||
+        v.entry < d.net.min_time_to_arrive.at(i).at(s)
+    ) {
+        violations.push_back({constraint::travel_time, i, no_train, s, v.entry});
+    }
+}
+
+auto schedule_evaluator::check_segment(const bv<visit>& visits, unsigned int from, unsigned int to, evaluation& e) const -> void {
+    // The visits are sorted by entry time: each one is compared with the earlier visit leaving last, which may not be the previous
+    // one when a train stays in the segment while others go by
+    auto latest = from;
+    
+    for(auto k = from + 1u; k < to; k++) {
+        const auto& before = visits.at(latest);
+        const auto& after = visits.at(k);
+        
+        if(after.entry <= before.leave) {
+            e.violations.push_back({constraint::max_one_train, after.train, before.train, after.seg, after.entry});
+        } else if(after.entry - before.leave <= d.headway) {
+            e.violations.push_back({constraint::headway, after.train, before.train, after.seg, after.entry});
+        }
+        
+        if(after.leave > before.leave) {
+            latest = k;
+        }
+    }
+}
+
+auto schedule_evaluator::check_siding(const visit& v, const bv<visit>& visits, const uint_vector& first, evaluation& e) const -> void {
+    const auto i = v.train;
+    const auto no_train = occupancy::no_train;
+    auto from = (v.entry > d.headway ? std::max(1u, v.entry - d.headway) : 1u);
+    auto to = std::min(v.entry + d.headway, d.ni + 1u);
+    auto someone = false;
+    auto non_sa = no_train;
+    
+    for(auto mm : d.net.main_tracks.at(v.seg)) {
+        auto begin = visits.begin() + first.at(mm);
+        auto end = visits.begin() + first.at(mm + 1u);
+        
+        // The last visit entering the main track by the end of the window, and going backwards the ones leaving it after its start
+        auto k = std::upper_bound(begin, end, to, [] (unsigned int t, const visit& w) { return t < w.entry; });
+        
+        while(k != begin && std::prev(k)->leave >= from) {
+            --k;
+            
+            if(k->train != i) {
+                someone = true;
+                
+                if(!d.trn.is_sa.at(k->train)) {
+                    non_sa = k->train;
+                }
+            }
+        }
+    }
+    
+    if(!someone) {
+        e.violations.push_back({constraint::siding, i, no_train, v.seg, v.entry});
+    }
+    
+    if(d.trn.is_heavy.at(i) && non_sa != no_train) {
+        e.violations.push_back({constraint::heavy, i, non_sa, v.seg, v.entry});
+    }
+}
+
+auto schedule_evaluator::name_of(constraint kind) -> const char* {
+    switch(kind) {
+        case constraint::max_one_train: return "max one train";
+        case constraint::headway: return "headway";
+        case constraint::siding: return "siding";
+        case constraint::heavy: return "heavy";
+        case constraint::mow: return "MOW";
+        case constraint::hazmat: return "HAZMAT";
+        case constraint::length: return "siding length";
+        case constraint::travel_time: return "travel time";
+    }
+    
+    return "unknown";
+}
+
+auto schedule_evaluator::evaluation::print_summary(std::ostream& where) const -> void {
+    where << "Objective: " << objective.total() << std::endl;
+    where << "\tDelay: " << objective.delay << std::endl;
+    
+    for(const auto& cls : delay_by_class) {
+        where << "\t\tClass " << cls.first << ": " << cls.second << std::endl;
+    }
+    
+    where << "\tTerminal time windows: " << objective.terminal << std::endl;
+    where << "\tSA points: " << objective.sa << std::endl;
+    where << "\tUnpreferred tracks: " << objective.unpreferred << std::endl;
+    
+    if(is_feasible()) {
+        where << "All the hard constraints are satisfied" << std::endl;
+        return;
+    }
+    
+    where << violations.size() << " violated constraints:" << std::endl;
+    
+    for(const auto& v : violations) {
+        where << "\t" << name_of(v.kind) << ": train " << v.train << " entering segment " << v.seg << " at time " << v.t;
+        
+        if(v.other != occupancy::no_train) {
+            where << ", with train " << v.other;
+        }
+        
+        where << std::endl;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef SCHEDULE_EVALUATOR_H
+#define SCHEDULE_EVALUATOR_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/occupancy.h>
+#include <data/path.h>
+
+#include <map>
+#include <ostream>
+
+/*! \brief This class evaluates a complete schedule, given as one succession of nodes per train, independently of the graphs and of
+ *  the solver which produced it. It computes the objective function, split by kind of penalty and, for the delay, by train class,
+ *  and it checks the hard constraints of the model: one train per segment at a time, headways, sidings, heavy trains, MOWs and
+ *  HAZMAT trains, plus the minimum travel times. The time taken is linear in the total number of nodes of the paths, plus a binary
+ *  search for each time a train enters a siding, so it can be run after every move of a local search.
+ */
+struct schedule_evaluator {
+    /*! \brief The hard constraints a schedule can violate */
+    enum class constraint {
+        /*! Two trains occupy the same segment at the same time */
+        max_one_train,
+        
+        /*! A train enters a segment less than one headway after another train entered or left it */
+        headway,
+        
+        /*! A train enters a siding while no other train runs on its main tracks within one headway */
+        siding,
+        
+        /*! A heavy train enters a siding while a non-SA train runs on its main tracks within one headway */
+        heavy,
+        
+        /*! A train occupies a segment during a MOW */
+        mow,
+        
+        /*! A HAZMAT train enters a siding */
+        hazmat,
+        
+        /*! A train enters a siding shorter than itself */
+        length,
+        
+        /*! A train runs through a segment faster than its minimum travel time, stops on a cross-over or enters a segment before
+         *  it can reach it */
+        travel_time
+    };
+    
+    /*! \brief A violated constraint */
+    struct violation {
+        /*! Which constraint is violated */
+        constraint kind;
+        
+        /*! The train violating it */
+        unsigned int train;
+        
+        /*! The other train involved, or occupancy::no_train if there is none */
+        unsigned int other;
+        
+        /*! The segment where it happens */
+        unsigned int seg;
+        
+        /*! The time when the train enters the segment */
+        unsigned int t;
+    };
+    
+    /*! \brief The time a train spends in a segment of its path */
+    struct visit {
+        /*! The train */
+        unsigned int train;
+        
+        /*! The segment */
+        unsigned int seg;
+        
+        /*! The time the train enters the segment */
+        unsigned int entry;
+        
+        /*! The last time the train is in the segment */
+        unsigned int leave;
+    };
+    
+    /*! \brief The result of the evaluation of a schedule */
+    struct evaluation {
+        /*! The objective function, split by the kind of penalty */
+        path::cost_breakdown objective;
+        
+        /*! Indexed over the train classes, is the delay part of the objective paid by the trains of the class */
+        std::map<char, double> delay_by_class;
+        
+        /*! The constraints violated by the schedule, empty if it is feasible */
+        bv<violation> violations;
+        
+        /*! Tells wether the schedule respects all the hard constraints */
+        auto is_feasible() const -> bool { return violations.empty(); }
+        
+        /*! Prints the objective function and the violated constraints */
+        auto print_summary(std::ostream& where) const -> void;
+    };
+    
+    /*! The problem data */
+    const data& d;
+    
+    /*! Basic constructor */
+    schedule_evaluator(const data& d);
+    
+    /*! Evaluates a schedule given by one path per train. Empty and dummy paths pay nothing and violate nothing */
+    auto evaluate(const bv<path>& paths) const -> evaluation;
+    
+    /*! Evaluates a schedule given by one succession of nodes per train, each from sigma to tau */
+    auto evaluate(const bv<bv<path::node>>& nodes) const -> evaluation;
+    
+    /*! Checks the constraints which only depend on one visit, i.e. all but max one train, headway, siding and heavy, and adds
+     *  the ones it violates to the list
+     */
+    auto check_visit(const visit& v, bv<violation>& violations) const -> void;
+    
+    /*! Name of a constraint, as printed in the summaries */
+    static auto name_of(constraint kind) -> const char*;
+
+private:
+    
+    // Indexed over (s, t), number of time intervals before t during which s is interested by a MOW
+    uint_matrix_2d mow_before;
+    
+    auto evaluate(const bv<const bv<path::node>*>& nodes) const -> evaluation;
+    auto visits_by_segment(const bv<const bv<path::node>*>& nodes, uint_vector& first) const -> bv<visit>;
+    auto check_segment(const bv<visit>& visits, unsigned int from, unsigned int to, evaluation& e) const -> void;
+    auto check_siding(const visit& v, const bv<visit>& visits, const uint_vector& first, evaluation& e) const -> void;
+};
+
+#endif
@@ -29,6 +29,7 @@ trains::trains(const ptree& pt, unsigned int nt, unsigned int ns, unsigned int n
         is_eastbound.push_back(train_child.second.get<bool>("eastbound"));
         is_westbound.push_back(train_child.second.get<bool>("westbound"));
         is_hazmat.push_back(train_child.second.get<bool>("hazmat"));
+        has_fixed_entry.push_back(train_child.second.get<bool>("fixed_entry", false));
         orig_ext.push_back(train_child.second.get<unsigned int>("origin_node"));
         dest_ext.push_back(train_child.second.get<unsigned int>("destination_node"));
         
@@ -56,9 +57,9 @@ trains::trains(const ptree& pt, unsigned int nt, unsigned int ns, unsigned int n
         
         name.push_back("Train " + std::to_string(train_n++));
         
+        // A train can be wanted before it enters, when it is reported late: the terminal penalty prices its lateness
         assert(want_time.back() < ni);
         assert(entry_time.back() < ni);
-        assert(want_time.back() >= entry_time.back());
         assert(speed_multi.back() > 0);
         assert(length.back() > 0);
         assert(type.back() >= first_train_class && type.back() <= last_train_class);
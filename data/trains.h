@@ -59,6 +59,9 @@ struct trains {
     /*! True iff the train is HAZMAT (transporting HAZardous MATerial) */
     bool_vector is_hazmat;
     
+    /*! True iff the train must enter the network exactly at its entry time, e.g. because it is already running when the scenario starts */
+    bool_vector has_fixed_entry;
+    
     /*! List of trains' origin extremes */
     uint_vector orig_ext;
     
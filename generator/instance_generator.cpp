@@ -0,0 +1,356 @@
+#include <generator/instance_generator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace {
+    // Speeds, headway and prices are those of the competition instances
+    constexpr double speed_ew = 1.17;
+    constexpr double speed_we = 1.33;
+    constexpr double speed_siding = 0.33;
+    constexpr double speed_switch = 0.25;
+    constexpr double speed_xover = 0.25;
+    constexpr unsigned int headway = 5u;
+    
+    // Lengths, in tenths of a mile
+    constexpr unsigned int min_segment_length = 20u;
+    constexpr unsigned int max_segment_length = 60u;
+    constexpr unsigned int min_leg_length = 30u;
+    constexpr unsigned int max_leg_length = 50u;
+    constexpr unsigned int xover_length = 3u;
+    constexpr unsigned int switches_length = 6u;
+    
+    // Durations of the MOWs, in minutes
+    constexpr unsigned int min_mow_duration = 60u;
+    constexpr unsigned int max_mow_duration = 240u;
+    
+    auto tenths(unsigned int length) -> double {
+        return length / 10.0;
+    }
+}
+
+instance_generator::settings::settings(const std::string& file_name) {
+    using namespace boost::property_tree;
+    
+    auto pt = ptree();
+    read_json(file_name, pt);
+    
+    name = pt.get<std::string>("name");
+    seed = pt.get<unsigned int>("seed");
+    territory_length = pt.get<double>("territory_length");
+    siding_density = pt.get<double>("siding_density");
+    crossovers = pt.get<unsigned int>("crossovers");
+    trains = pt.get<unsigned int>("trains");
+    eastbound_share = pt.get<double>("eastbound_share");
+    heavy_share = pt.get<double>("heavy_share");
+    hazmat_share = pt.get<double>("hazmat_share");
+    horizon = pt.get<unsigned int>("horizon");
+    mows = pt.get<unsigned int>("mows");
+    sa_share = pt.get<double>("sa_share");
+    sa_points = pt.get<unsigned int>("sa_points");
+}
+
+auto instance_generator::generate(const std::string& file_name) -> bool {
+    position.clear();
+    segments.clear();
+    trains.clear();
+    mow_candidate.clear();
+    main_junctions.clear();
+    
+    if(!build_territory() || !build_trains()) {
+        return false;
+    }
+    
+    write(file_name);
+    
+    return true;
+}
+
+auto instance_generator::add_junction(unsigned int pos) -> unsigned int {
+    position.push_back(pos);
+    return position.size() - 1u;
+}
+
+auto instance_generator::add_segment(unsigned int w_ext, unsigned int e_ext, char type) -> void {
+    assert(position.at(e_ext) > position.at(w_ext));
+    
+    auto length = position.at(e_ext) - position.at(w_ext);
+    
+    segments.push_back(segment{w_ext, e_ext, type, length, length});
+    mow_candidate.push_back(type == '1' || type == '2');
+}
+
+auto instance_generator::uniform(unsigned int from, unsigned int to) -> unsigned int {
+    return std::uniform_int_distribution<unsigned int>(from, to)(mt);
+}
+
+auto instance_generator::chance(double p) -> bool {
+    return std::bernoulli_distribution(std::min(std::max(p, 0.0), 1.0))(mt);
+}
+
+auto instance_generator::build_territory() -> bool {
+    total_length = static_cast<unsigned int>(std::round(st.territory_length * 10));
+    
+    // Each double-track section has a cross-over at each end and, on average, two inside it
+    n_sections = (st.crossovers >= 2u ? std::max(1u, st.crossovers / 4u) : 0u);
+    
+    // Indexed over the sections, the lengths of the legs between two consecutive cross-overs
+    auto legs = uint_matrix_2d(n_sections, uint_vector(1u, 0u));
+    auto double_track_length = 0u;
+    
+    for(auto k = 0u; k + 2u * n_sections < st.crossovers && n_sections > 0u; k++) {
+        legs.at(k % n_sections).push_back(0u);
+    }
+    
+    for(auto& section : legs) {
+        for(auto& leg : section) {
+            leg = uniform(min_leg_length, max_leg_length);
+            double_track_length += leg;
+        }
+        
+        double_track_length += 2u * xover_length;
+    }
+    
+    if(double_track_length + min_segment_length * (n_sections + 1u) > total_length) {
+        std::cerr << "INSTANCE_GENERATOR >> The territory is too short for " << st.crossovers << " cross-overs" << std::endl;
+        return false;
+    }
+    
+    // The single-track stretches before, between and after the double-track sections have the same length
+    auto single_track_length = total_length - double_track_length;
+    auto junction = add_junction(0u);
+    
+    for(auto k = 0u; k <= n_sections; k++) {
+        auto end = position.at(junction) + single_track_length / (n_sections + 1u);
+        
+        if(k == n_sections) {
+            end = total_length;
+        }
+        
+        while(position.at(junction) < end) {
+            auto length = std::min(uniform(min_segment_length, max_segment_length), end - position.at(junction));
+            
+            // Never leave a stub shorter than a segment at the end of the stretch
+            if(end - position.at(junction) - length < min_segment_length) {
+                length = end - position.at(junction);
+            }
+            
+            auto next = add_junction(position.at(junction) + length);
+            
+            add_segment(junction, next, '0');
+            
+            if(length > switches_length && chance(st.siding_density)) {
+                segments.push_back(segment{junction, next, 'S', length, length - switches_length});
+                mow_candidate.push_back(false);
+            }
+            
+            if(position.at(next) < total_length) {
+                main_junctions.push_back(next);
+            }
+            
+            junction = next;
+        }
+        
+        if(k < n_sections) {
+            junction = build_double_track(junction, legs.at(k));
+            main_junctions.push_back(junction);
+        }
+    }
+    
+    east_terminal = junction;
+    
+    return true;
+}
+
+auto instance_generator::build_double_track(unsigned int from, const uint_vector& legs) -> unsigned int {
+    // The westbound track continues from the single-track line, while the eastbound track starts after a cross-over
+    auto westbound = from;
+    auto eastbound = add_junction(position.at(from) + xover_length);
+    
+    add_segment(from, eastbound, 'X');
+    
+    for(auto j = 0u; j < legs.size(); j++) {
+        auto pos = position.at(eastbound) + legs.at(j);
+        
+        if(j + 1u < legs.size()) {
+            // Inner cross-over from the eastbound to the westbound track
+            auto next_eastbound = add_junction(pos);
+            auto next_westbound = add_junction(pos + xover_length);
+            
+            add_segment(eastbound, next_eastbound, '1');
+            add_segment(westbound, next_westbound, '2');
+            add_segment(next_eastbound, next_westbound, 'X');
+            
+            eastbound = next_eastbound;
+            westbound = next_westbound;
+        } else {
+            // The single-track line starts again at the end of the eastbound track, after a cross-over from the westbound one
+            auto last_westbound = add_junction(pos);
+            auto to = add_junction(pos + xover_length);
+            
+            add_segment(eastbound, to, '1');
+            add_segment(westbound, last_westbound, '2');
+            add_segment(last_westbound, to, 'X');
+            
+            return to;
+        }
+    }
+    
+    return from;
+}
+
+auto instance_generator::run_time(double speed_multi, unsigned int distance) const -> unsigned int {
+    return static_cast<unsigned int>(std::ceil(tenths(distance) / (std::min(speed_ew, speed_we) * speed_multi)));
+}
+
+auto instance_generator::build_trains() -> bool {
+    for(auto i = 0u; i < st.trains; i++) {
+        auto tr = train();
+        
+        tr.cl = static_cast<char>('A' + uniform(0u, 5u));
+        tr.eastbound = chance(st.eastbound_share);
+        tr.speed_multi = uniform(50u, 100u) / 100.0;
+        tr.length = uniform(10u, 22u) / 10.0;
+        tr.tob = (chance(st.heavy_share) ? uniform(101u, 140u) : uniform(40u, 100u));
+        tr.hazmat = chance(st.hazmat_share);
+        
+        auto xover_time = static_cast<unsigned int>(std::ceil(tenths(xover_length) / (speed_xover * tr.speed_multi)));
+        auto min_run = run_time(tr.speed_multi, total_length) + 2u * n_sections * xover_time;
+        auto slack = uniform(0u, min_run / 4u);
+        
+        if(min_run + slack + 2u >= st.horizon) {
+            std::cerr << "INSTANCE_GENERATOR >> The horizon is too short for train " << i << " to cross the territory" << std::endl;
+            return false;
+        }
+        
+        tr.entry_time = uniform(1u, st.horizon - 2u - min_run - slack);
+        tr.want_time = tr.entry_time + min_run + slack;
+        
+        if(st.sa_points > 0u && !main_junctions.empty() && chance(st.sa_share)) {
+            auto points = main_junctions;
+            
+            std::shuffle(points.begin(), points.end(), mt);
+            points.resize(std::min<std::size_t>(st.sa_points, points.size()));
+            std::sort(points.begin(), points.end(), [&] (unsigned int a, unsigned int b) {
+                return (tr.eastbound ? position.at(a) < position.at(b) : position.at(a) > position.at(b));
+            });
+            
+            for(auto ext : points) {
+                auto distance = (tr.eastbound ? position.at(ext) : total_length - position.at(ext));
+                auto time = tr.entry_time + run_time(tr.speed_multi, distance) + slack * distance / total_length;
+                
+                tr.sa_ext.push_back(ext);
+                tr.sa_times.push_back(time);
+            }
+        }
+        
+        trains.push_back(tr);
+    }
+    
+    return true;
+}
+
+auto instance_generator::write(const std::string& file_name) -> void {
+    std::ofstream out(file_name, std::ios::out);
+    auto boolean = [] (bool b) { return (b ? "true" : "false"); };
+    
+    out << std::fixed << std::setprecision(2);
+    out << "{" << std::endl;
+    out << "    \"name\": \"" << st.name << "\"," << std::endl;
+    out << "    \"speed_ew\": " << speed_ew << "," << std::endl;
+    out << "    \"speed_we\": " << speed_we << "," << std::endl;
+    out << "    \"speed_siding\": " << speed_siding << "," << std::endl;
+    out << "    \"speed_switch\": " << speed_switch << "," << std::endl;
+    out << "    \"speed_xover\": " << speed_xover << "," << std::endl;
+    out << "    \"time_intervals\": " << st.horizon << "," << std::endl;
+    out << "    \"want_time_tw_start\": 60," << std::endl;
+    out << "    \"want_time_tw_end\": 180," << std::endl;
+    out << "    \"schedule_tw_end\": 120," << std::endl;
+    out << "    \"headway\": " << headway << "," << std::endl;
+    out << "    \"general_delay_price\": {\"A\": 10.00, \"B\": 8.33, \"C\": 6.67, \"D\": 5.00, \"E\": 2.50, \"F\": 1.67}," << std::endl;
+    out << "    \"terminal_delay_price\": 1.25," << std::endl;
+    out << "    \"schedule_delay_price\": 3.33," << std::endl;
+    out << "    \"unpreferred_price\": 0.83," << std::endl;
+    out << "    \"segments_number\": " << segments.size() << "," << std::endl;
+    out << "    \"segments\": [" << std::endl;
+    
+    out << std::setprecision(1);
+    
+    for(auto k = 0u; k < segments.size(); k++) {
+        const auto& sg = segments.at(k);
+        
+        out << "        {\"extreme_1\": " << sg.w_ext << ", \"extreme_2\": " << sg.e_ext << ", \"type\": \"" << sg.type << "\", ";
+        out << "\"length\": " << tenths(sg.length) << ", ";
+        
+        if(sg.type == 'S') {
+            out << "\"siding_length\": " << tenths(sg.siding_length) << ", ";
+        }
+        
+        out << "\"eastbound\": " << boolean(sg.type != '2') << ", \"westbound\": " << boolean(sg.type != '1') << ", ";
+        out << "\"min_distance_from_w\": " << tenths(position.at(sg.w_ext)) << ", ";
+        out << "\"min_distance_from_e\": " << tenths(total_length - position.at(sg.e_ext)) << "}";
+        out << (k + 1u < segments.size() ? "," : "") << std::endl;
+    }
+    
+    out << "    ]," << std::endl;
+    out << "    \"trains_number\": " << trains.size() << "," << std::endl;
+    out << "    \"trains\": [" << std::endl;
+    
+    out << std::setprecision(2);
+    
+    for(auto i = 0u; i < trains.size(); i++) {
+        const auto& tr = trains.at(i);
+        
+        out << "        {\"class\": \"" << tr.cl << "\", \"schedule_adherence\": " << boolean(!tr.sa_ext.empty()) << ", ";
+        out << "\"entry_time\": " << tr.entry_time << ", ";
+        out << "\"origin_node\": " << (tr.eastbound ? 0u : east_terminal) << ", \"destination_node\": " << (tr.eastbound ? east_terminal : 0u) << ", ";
+        out << "\"eastbound\": " << boolean(tr.eastbound) << ", \"westbound\": " << boolean(!tr.eastbound) << ", ";
+        out << "\"speed_multi\": " << tr.speed_multi << ", \"length\": " << tr.length << ", \"tob\": " << tr.tob << ", ";
+        out << "\"hazmat\": " << boolean(tr.hazmat) << ", \"terminal_wt\": " << tr.want_time << ", \"schedule\": [";
+        
+        for(auto n = 0u; n < tr.sa_ext.size(); n++) {
+            out << (n > 0u ? ", " : "") << "{\"node\": " << tr.sa_ext.at(n) << ", \"time\": " << tr.sa_times.at(n) << "}";
+        }
+        
+        out << "]}" << (i + 1u < trains.size() ? "," : "") << std::endl;
+    }
+    
+    out << "    ]," << std::endl;
+    out << "    \"mow\": [" << std::endl;
+    
+    auto candidates = uint_vector();
+    
+    for(auto k = 0u; k < segments.size(); k++) {
+        if(mow_candidate.at(k)) {
+            candidates.push_back(k);
+        }
+    }
+    
+    // Without double-track sections, MOWs close the single-track line
+    if(candidates.empty()) {
+        for(auto k = 0u; k < segments.size(); k++) {
+            if(segments.at(k).type == '0') {
+                candidates.push_back(k);
+            }
+        }
+    }
+    
+    for(auto m = 0u; m < st.mows; m++) {
+        const auto& sg = segments.at(candidates.at(uniform(0u, candidates.size() - 1u)));
+        auto start = uniform(1u, st.horizon - 2u);
+        auto end = std::min(start + uniform(min_mow_duration, max_mow_duration), st.horizon - 1u);
+        
+        out << "        {\"extreme_1\": " << sg.w_ext << ", \"extreme_2\": " << sg.e_ext << ", \"start_time\": " << start << ", \"end_time\": " << end << "}";
+        out << (m + 1u < st.mows ? "," : "") << std::endl;
+    }
+    
+    out << "    ]" << std::endl;
+    out << "}" << std::endl;
+}
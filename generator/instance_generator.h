@@ -0,0 +1,130 @@
+#ifndef INSTANCE_GENERATOR_H
+#define INSTANCE_GENERATOR_H
+
+#include <data/array.h>
+
+#include <random>
+#include <string>
+
+/*! \brief This class generates random instances in the same JSON format as the RAS competition ones, to study how the graphs and
+ *  the solvers scale. The territory is a single-track line from a west terminal to an east terminal, with sidings along it and
+ *  double-track sections joined to it by cross-overs, laid out like the competition territory. Trains run from one terminal to the
+ *  other, and MOWs are placed on the double-track sections when there are any. All distances are multiples of a tenth of a mile,
+ *  so that the written instance describes exactly the generated territory.
+ */
+struct instance_generator {
+    /*! \brief This class contains the settings of the generator, read from a JSON file */
+    struct settings {
+        /*! Name of the instance */
+        std::string name;
+        
+        /*! Seed of the random generator: the same settings always give the same instance */
+        unsigned int seed;
+        
+        /*! Distance between the two terminals, in miles */
+        double territory_length;
+        
+        /*! Probability that a single-track segment has a siding */
+        double siding_density;
+        
+        /*! Number of cross-overs: each double-track section has one at each end, and the others are spread inside the sections */
+        unsigned int crossovers;
+        
+        /*! Number of trains */
+        unsigned int trains;
+        
+        /*! Fraction of the trains running eastbound */
+        double eastbound_share;
+        
+        /*! Fraction of heavy trains */
+        double heavy_share;
+        
+        /*! Fraction of HAZMAT trains, which cannot enter the sidings */
+        double hazmat_share;
+        
+        /*! Number of minutes in the time horizon */
+        unsigned int horizon;
+        
+        /*! Number of MOWs */
+        unsigned int mows;
+        
+        /*! Fraction of the trains with schedule adherence */
+        double sa_share;
+        
+        /*! Number of SA points of a train with schedule adherence, out of the junctions of the single-track line */
+        unsigned int sa_points;
+        
+        /*! Empty constructor */
+        settings() {}
+        
+        /*! Reads the settings from a JSON file */
+        settings(const std::string& file_name);
+    };
+    
+    /*! Settings of the generator */
+    settings st;
+    
+    /*! Basic constructor */
+    instance_generator(settings st) : st{std::move(st)}, mt(this->st.seed) {}
+    
+    /*! Generates the instance and writes it to the given file. Returns false if the horizon is too short for the trains to cross the territory */
+    auto generate(const std::string& file_name) -> bool;
+
+private:
+    
+    struct segment {
+        unsigned int w_ext;
+        unsigned int e_ext;
+        char type;
+        unsigned int length;
+        unsigned int siding_length;
+    };
+    
+    struct train {
+        char cl;
+        bool eastbound;
+        unsigned int entry_time;
+        unsigned int want_time;
+        double speed_multi;
+        double length;
+        unsigned int tob;
+        bool hazmat;
+        uint_vector sa_ext;
+        uint_vector sa_times;
+    };
+    
+    std::mt19937 mt;
+    
+    /*! Indexed over the junctions, their distance from the west terminal in tenths of a mile */
+    uint_vector position;
+    
+    bv<segment> segments;
+    bv<train> trains;
+    
+    /*! Indexed over the segments, tells wether a MOW can be placed on it */
+    bool_vector mow_candidate;
+    
+    /*! Number of double-track sections */
+    unsigned int n_sections;
+    
+    /*! Distance between the terminals, in tenths of a mile */
+    unsigned int total_length;
+    
+    /*! Junction of the east terminal; the west terminal is junction 0 */
+    unsigned int east_terminal;
+    
+    /*! Junctions of the single-track line, from west to east, where both eastbound and westbound trains pass */
+    uint_vector main_junctions;
+    
+    auto add_junction(unsigned int pos) -> unsigned int;
+    auto add_segment(unsigned int w_ext, unsigned int e_ext, char type) -> void;
+    auto uniform(unsigned int from, unsigned int to) -> unsigned int;
+    auto chance(double p) -> bool;
+    auto build_territory() -> bool;
+    auto build_double_track(unsigned int from, const uint_vector& legs) -> unsigned int;
+    auto run_time(double speed_multi, unsigned int distance) const -> unsigned int;
+    auto build_trains() -> bool;
+    auto write(const std::string& file_name) -> void;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#include <generator/instance_generator.h>
+
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if(argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <generator settings file> <instance file>" << std::endl;
+        return 1;
+    }
+    
+    auto gen = instance_generator(instance_generator::settings(argv[1]));
+    
+    return gen.generate(argv[2]) ? 0 : 1;
+}
@@ -1,111 +1,274 @@
 #include <grapher/grapher.h>
-#include <grapher/gnuplot-iostream.h>
 
-auto grapher::generate_points() -> grapher::points_data {
-    auto points = points_data(d.nt);
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    // Size of the drawing area and of the margins around it, in pixels
+    constexpr double plot_width = 1600.0;
+    constexpr double plot_height = 800.0;
+    constexpr double margin_left = 70.0;
+    constexpr double margin_right = 180.0;
+    constexpr double margin_top = 20.0;
+    constexpr double margin_bottom = 50.0;
+    
+    // Size of a legend entry: the legend wraps into a new column, as wide as the right margin, when it reaches the bottom of the plot
+    constexpr double legend_row_height = 18.0;
+    constexpr double legend_column_width = 160.0;
+    
+    // Time intervals between two ticks of the time axis, and number of ticks of the distance axis
+    constexpr unsigned int time_tick = 60u;
+    constexpr unsigned int n_distance_ticks = 5u;
+    
+    // Colours of the trains' lines, used in turn
+    const char* const train_colours[] = {
+        "#1f77b4", "#ff7f0e", "#2ca02c", "#9467bd", "#8c564b", "#e377c2", "#7f7f7f", "#bcbd22", "#17becf", "#393b79"
+    };
+    
+    constexpr unsigned int n_train_colours = sizeof(train_colours) / sizeof(train_colours[0]);
+    
+    auto xml_escape(const std::string& text) -> std::string {
+        auto escaped = std::string();
+        
+        for(auto c : text) {
+            switch(c) {
+                case '&': escaped += "&amp;"; break;
+                case '<': escaped += "&lt;"; break;
+                case '>': escaped += "&gt;"; break;
+                case '"': escaped += "&quot;"; break;
+                default: escaped += c;
+            }
+        }
+        
+        return escaped;
+    }
+}
+
+auto grapher::points_of(unsigned int i) const -> grapher::series_data {
+    // Points are drawn along the original segments, so that contracted chains show where the train actually is
+    const auto& nodes = paths.at(i).original_p;
+    const auto& seg = d.original_seg;
+    const auto tau = static_cast<unsigned int>(seg.type.size() - 1u);
+    const auto eastbound = d.trn.is_eastbound.at(i);
+    auto points = series_data();
+    
+    // A dummy path never enters the network
+    if(nodes.size() < 3u) {
+        return points;
+    }
+    
+    const auto& p = paths.at(i).p;
+    const auto& dest = d.trn.dest_segs.at(i);
+    const auto arrives = (std::find(dest.begin(), dest.end(), p.at(p.size() - 2u).seg) != dest.end());
+    
+    points.reserve(nodes.size() - 1u);
+    
+    // One point each time the train changes segment, at the time it leaves the previous one
+    for(auto k = 0u; k + 1 < nodes.size(); k++) {
+        auto current_seg = nodes.at(k).seg;
+        auto next_seg = nodes.at(k + 1).seg;
+        auto time = static_cast<double>(nodes.at(k + 1).t - 1);
+        auto distance = 0.0;
+        
+        if(current_seg == 0u) {
+            // If just starting its journey
+            distance = (eastbound ? 0 : seg.w_min_dist.at(next_seg) + seg.length.at(next_seg));
+        } else if(next_seg == tau) {
+            if(!arrives) {
+                // If escaping at the end of the time horizon
+                distance = (eastbound ? seg.w_min_dist.at(current_seg) + seg.length.at(current_seg) : seg.w_min_dist.at(current_seg));
+            } else {
+                // If concluding the journey
+                distance = (eastbound ? seg.w_min_dist.at(current_seg) + seg.length.at(current_seg) : 0);
+            }
+        } else {
+            // If arriving at a normal segment
+            distance = (eastbound ? seg.w_min_dist.at(next_seg) : seg.w_min_dist.at(current_seg));
+        }
+        
+        points.push_back(std::make_pair(time, distance));
+    }
+    
+    return points;
+}
+
+auto grapher::corridor_length() const -> double {
+    auto length = 0.0;
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        length = std::max(length, d.seg.w_min_dist.at(s) + d.seg.length.at(s));
+    }
+    
+    return length;
+}
+
+auto grapher::write_graph() -> void {
+    std::ofstream svg("graph.svg", std::ios::out);
+    std::ofstream csv("graph.csv", std::ios::out);
+    
+    if(!svg || !csv) {
+        std::cerr << "GRAPHER >> Cannot write graph.svg or graph.csv" << std::endl;
+        return;
+    }
+    
+    write_svg(svg);
+    write_csv(csv);
+}
+
+auto grapher::write_csv(std::ostream& out) -> void {
+    out << "train,time,distance" << std::endl;
     
     for(auto i = 0u; i < d.nt; i++) {
-        auto current_seg = 0u;
-        auto current_time = 0u;
-        auto current_entry_time = -1;
-        points.at(i) = series_data();
-    
-        while(current_seg != d.ns + 1) {
-            auto next_seg = -1;
-            auto escaping = false;
-            
-            for(auto s : d.gr.delta[i][current_seg]) {
-                if(paths.at(i).x.at(current_seg).at(current_time).at(s) > 0u) {
-                    next_seg = static_cast<long>(s);
-                }
+        for(const auto& pt : points_of(i)) {
+            out << i << "," << pt.first << "," << pt.second << "\n";
+        }
+    }
+    
+    out.flush();
+}
+
+auto grapher::write_svg(std::ostream& out) -> void {
+    auto length = std::max(corridor_length(), 1.0);
+    auto n_times = static_cast<double>(d.ni + 1);
+    auto legend_rows = std::max(static_cast<unsigned int>(plot_height / legend_row_height), 1u);
+    auto legend_columns = std::max((d.nt + legend_rows - 1u) / legend_rows, 1u);
+    auto width = margin_left + plot_width + margin_right + (legend_columns - 1u) * legend_column_width;
+    auto height = margin_top + plot_height + margin_bottom;
+    
+    auto x_of = [&] (double time) { return margin_left + time * plot_width / n_times; };
+    auto y_of = [&] (double distance) { return margin_top + plot_height - distance * plot_height / length; };
+    auto colour_of = [&] (unsigned int i) { return train_colours[i % n_train_colours]; };
+    
+    out << std::fixed << std::setprecision(1);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\" ";
+    out << "viewBox=\"0 0 " << width << " " << height << "\" font-family=\"sans-serif\" font-size=\"12\">\n";
+    out << "<rect width=\"" << width << "\" height=\"" << height << "\" fill=\"white\"/>\n";
+    
+    // Sidings: a band over the whole horizon
+    out << "<g id=\"sidings\" fill=\"#e0e0e0\">\n";
+    
+    for(auto sd : d.net.sidings) {
+        auto top = y_of(d.seg.w_min_dist.at(sd) + d.seg.length.at(sd));
+        auto bottom = y_of(d.seg.w_min_dist.at(sd));
+        
+        out << "<rect x=\"" << margin_left << "\" y=\"" << top << "\" width=\"" << plot_width << "\" height=\"" << std::max(bottom - top, 1.0) << "\"/>\n";
+    }
+    
+    out << "</g>\n";
+    
+    // MOWs: a block for each maximal time span in which a segment is closed
+    out << "<g id=\"mows\" fill=\"#d62728\" fill-opacity=\"0.3\">\n";
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        auto top = y_of(d.seg.w_min_dist.at(s) + d.seg.length.at(s));
+        auto bottom = y_of(d.seg.w_min_dist.at(s));
+        auto t = 0u;
+        
+        while(t <= d.ni) {
+            if(!d.mnt.is_mow.at(s).at(t)) {
+                t++;
+                continue;
             }
             
-            if(next_seg < 0 && current_time == d.ni) {
-                if(paths.at(i).x.at(current_seg).at(d.ni).at(d.ns + 1) > 0u) {
-                    next_seg = static_cast<long>(d.ns + 1);
-                    escaping = true;
-                }
+            auto from = t;
+            
+            while(t <= d.ni && d.mnt.is_mow.at(s).at(t)) {
+                t++;
             }
             
-            if(current_time >= d.ni + 1) {
-                std::cerr << "Could not find a valid path!" << std::endl;
-                break;
+            out << "<rect x=\"" << x_of(from) << "\" y=\"" << top << "\" width=\"" << x_of(t) - x_of(from) << "\" height=\"" << std::max(bottom - top, 1.0) << "\"/>\n";
+        }
+    }
+    
+    out << "</g>\n";
+    
+    // Axes, with a tick every hour and a few evenly spaced distances
+    out << "<g id=\"axes\" stroke=\"black\">\n";
+    out << "<line x1=\"" << margin_left << "\" y1=\"" << margin_top + plot_height << "\" x2=\"" << margin_left + plot_width << "\" y2=\"" << margin_top + plot_height << "\"/>\n";
+    out << "<line x1=\"" << margin_left << "\" y1=\"" << margin_top << "\" x2=\"" << margin_left << "\" y2=\"" << margin_top + plot_height << "\"/>\n";
+    
+    for(auto t = 0u; t <= d.ni + 1; t += time_tick) {
+        out << "<line x1=\"" << x_of(t) << "\" y1=\"" << margin_top + plot_height << "\" x2=\"" << x_of(t) << "\" y2=\"" << margin_top + plot_height + 5.0 << "\"/>\n";
+        out << "<text x=\"" << x_of(t) << "\" y=\"" << margin_top + plot_height + 20.0 << "\" stroke=\"none\" text-anchor=\"middle\">" << t << "</text>\n";
+    }
+    
+    for(auto k = 0u; k <= n_distance_ticks; k++) {
+        auto distance = length * k / n_distance_ticks;
+        
+        out << "<line x1=\"" << margin_left - 5.0 << "\" y1=\"" << y_of(distance) << "\" x2=\"" << margin_left << "\" y2=\"" << y_of(distance) << "\"/>\n";
+        out << "<text x=\"" << margin_left - 8.0 << "\" y=\"" << y_of(distance) + 4.0 << "\" stroke=\"none\" text-anchor=\"end\">" << distance << "</text>\n";
+    }
+    
+    out << "<text x=\"" << margin_left + plot_width / 2 << "\" y=\"" << height - 10.0 << "\" stroke=\"none\" text-anchor=\"middle\">Time</text>\n";
+    out << "<text transform=\"translate(15 " << margin_top + plot_height / 2 << ") rotate(-90)\" stroke=\"none\" text-anchor=\"middle\">Distance from the western terminal</text>\n";
+    out << "</g>\n";
+    
+    // Time windows: the arrival window at the destination terminal, and the SA deadlines over the SA points
+    out << "<g id=\"time_windows\" stroke-width=\"6\" stroke-opacity=\"0.35\" fill-opacity=\"0.2\">\n";
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        auto want = static_cast<double>(d.trn.want_time.at(i));
+        auto destination = (d.trn.is_eastbound.at(i) ? length : 0.0);
+        auto from = std::max(0.0, want - d.tiw.wt_left);
+        auto to = want + d.tiw.wt_right + 1;
+        
+        out << "<line x1=\"" << x_of(from) << "\" y1=\"" << y_of(destination) << "\" x2=\"" << x_of(to) << "\" y2=\"" << y_of(destination) << "\" stroke=\"" << colour_of(i) << "\"/>\n";
+        
+        for(auto n = 0u; n < d.trn.sa_num.at(i); n++) {
+            if(d.trn.sa_segs.at(i).at(n).empty()) {
+                continue;
             }
-                
-            if(next_seg >= 0) {
-                if(static_cast<unsigned int>(next_seg) != current_seg) {
-                    if(current_entry_time >= 0l) {
-                        // Coming from another segment
-                        
-                        if(next_seg == static_cast<long>(d.ns + 1)) {
-                            // If arriving in tau
-                            
-                            if(escaping) {
-                                // If escaping
-                                
-                                auto distance = (
-                                    d.trn.is_eastbound.at(i) ?
-                                    d.seg.w_min_dist.at(current_seg) + d.seg.length.at(current_seg) :
-                                    d.seg.w_min_dist.at(current_seg)
-                                );
-                                points.at(i).push_back(std::make_pair(current_time, distance));
-                            } else {
-                                // If concluding the journey
-                                
-                                auto distance = (
-                                    d.trn.is_eastbound.at(i) ?
-                                    d.seg.w_min_dist.at(current_seg) + d.seg.length.at(current_seg) : 
-                                    0
-                                );
-                                points.at(i).push_back(std::make_pair(current_time, distance));
-                            }
-                        } else {
-                            // If arriving at a normal segment
-                            
-                            auto distance = (
-                                d.trn.is_eastbound.at(i) ?
-                                d.seg.w_min_dist.at(next_seg) :
-                                d.seg.w_min_dist.at(current_seg)
-                            );
-                            points.at(i).push_back(std::make_pair(current_time, distance));
-                        }
-                    } else {
-                        // If just starting its journey
-                        
-                        auto distance = (
-                            d.trn.is_eastbound.at(i) ?
-                            0 :
-                            d.seg.w_min_dist.at(next_seg) + d.seg.length.at(next_seg)
-                        );
-                        points.at(i).push_back(std::make_pair(current_time, distance));
-                    }
-                    
-                    current_entry_time = static_cast<long>(current_time + 1);
-                }
-                current_seg = next_seg;
+            
+            auto low = length;
+            auto high = 0.0;
+            
+            for(auto s : d.trn.sa_segs.at(i).at(n)) {
+                low = std::min(low, d.seg.w_min_dist.at(s));
+                high = std::max(high, d.seg.w_min_dist.at(s) + d.seg.length.at(s));
             }
             
-            current_time++;
+            auto sa_time = static_cast<double>(d.trn.sa_times.at(i).at(n));
+            
+            out << "<rect x=\"" << x_of(sa_time) << "\" y=\"" << y_of(high) << "\" width=\"" << x_of(sa_time + d.tiw.sa_right + 1) - x_of(sa_time) << "\" ";
+            out << "height=\"" << std::max(y_of(low) - y_of(high), 1.0) << "\" fill=\"" << colour_of(i) << "\" stroke=\"none\"/>\n";
         }
     }
     
-    return points;
-}
-
-auto grapher::write_graph() -> void {
-    auto points = generate_points();
-    Gnuplot gp;
+    out << "</g>\n";
     
-    gp << "set terminal png size 2048" << std::endl;
-    gp << "set output \"graph.png\"" << std::endl;
-    gp << "plot ";
+    // Trains' lines and legend
+    out << "<g id=\"trains\" fill=\"none\" stroke-width=\"1.5\">\n";
     
     for(auto i = 0u; i < d.nt; i++) {
-        gp << gp.file1d(points.at(i)) << " title \"Train " << i << "\" with lines";
-        if(i != d.nt - 1) {
-            gp << ",";
+        auto points = points_of(i);
+        
+        if(points.empty()) {
+            continue;
+        }
+        
+        out << "<polyline stroke=\"" << colour_of(i) << "\" points=\"";
+        
+        for(const auto& pt : points) {
+            out << x_of(pt.first) << "," << y_of(pt.second) << " ";
         }
+        
+        out << "\"><title>" << xml_escape(d.trn.name.at(i)) << "</title></polyline>\n";
+    }
+    
+    out << "</g>\n";
+    out << "<g id=\"legend\">\n";
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        auto x = margin_left + plot_width + 20.0 + legend_column_width * (i / legend_rows);
+        auto y = margin_top + 10.0 + legend_row_height * (i % legend_rows);
+        
+        out << "<line x1=\"" << x << "\" y1=\"" << y << "\" x2=\"" << x + 20.0 << "\" y2=\"" << y << "\" stroke=\"" << colour_of(i) << "\" stroke-width=\"3\"/>\n";
+        out << "<text x=\"" << x + 26.0 << "\" y=\"" << y + 4.0 << "\">" << xml_escape(d.trn.name.at(i)) << "</text>\n";
     }
     
-    gp << std::endl;
+    out << "</g>\n";
+    out << "</svg>" << std::endl;
 }
\ No newline at end of file
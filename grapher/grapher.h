@@ -5,10 +5,16 @@
 #include <data/data.h>
 #include <data/path.h>
 
+#include <ostream>
+#include <string>
 #include <utility>
 #include <vector>
 
-/*! \brief This class takes care of outputting the results in a nice format, in order to create graphs */
+/*! \brief This class takes care of outputting the results in a nice format, in order to create graphs. It draws the time-distance
+ *  diagram of the trains in SVG, with the sidings, the MOWs and the trains' time windows as overlays, and writes the points of each
+ *  train's line in CSV. Everything is written by the process itself. The points of a train's line are the nodes of its path where
+ *  it changes segment, and they are generated and written one train at a time, so only one train's points are in memory at once.
+ */
 struct grapher {
     /*! The problem data */
     const data& d;
@@ -19,14 +25,20 @@ struct grapher {
     /*! Basic constructor */
     grapher(const data& d, const bv<path>& paths) : d{d}, paths{paths} {}
     
-    /*! Write data to file */
+    /*! Write the diagram to graph.svg and its points to graph.csv */
     auto write_graph() -> void;
     
+    /*! Write the time-distance diagram in SVG format */
+    auto write_svg(std::ostream& out) -> void;
+    
+    /*! Write the points of the trains' lines in CSV format: one line per point, with the train, the time and the distance from the western terminal */
+    auto write_csv(std::ostream& out) -> void;
+
 private:
     using series_data = std::vector<std::pair<double, double>>;
-    using points_data = std::vector<series_data>;
     
-    auto generate_points() -> points_data;
+    auto points_of(unsigned int i) const -> series_data;
+    auto corridor_length() const -> double;
 };
 
-#endif
\ No newline at end of file
+#endif
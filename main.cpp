@@ -1,24 +1,175 @@
 #include <data/data.h>
 #include <params/params.h>
+#include <profiler/memory.h>
+#include <profiler/profiler.h>
+#include <solver/anytime.h>
+#include <solver/cbs_solver.h>
+#include <solver/dispatch_simulator.h>
+#include <solver/lagrangian_solver.h>
+#include <solver/meet_pass_planner.h>
 
 #if USE_CPLEX
     #include <solver/solver.h>
     #include <solver/sequential_solver.h>
+    #include <solver/multi_resolution_solver.h>
+    #include <solver/rolling_horizon_solver.h>
+    #include <solver/lns_solver.h>
 #endif
 
 #include <iostream>
 
 int main(int argc, char* argv[]) {
     auto p = params(argv[2]);
-    auto d = data(argv[1], p);
+    
+    if(p.profiler.active) {
+        profiler::enable();
+    }
+    
+    if(p.memory.budget_mb > 0u && !memory::fit_budget(data::read_file(argv[1]), p)) {
+        memory::write(p.memory.report_file);
+        return 1;
+    }
+
+    anytime::start(p.anytime.time_budget);
+    anytime::on_incumbent([] (const bv<path>&, double cost, double elapsed) {
+        std::cout << "ANYTIME >> New incumbent of cost " << cost << " after " << elapsed << " seconds" << std::endl;
+    });
 
     #if USE_CPLEX
-        auto s = sequential_solver(d);
-        s.solve_sequentially();
+        if(p.cbs.active) {
+            auto d = data(argv[1], p);
+            auto s = cbs_solver(d);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else if(p.meet_pass.active) {
+            auto d = data(argv[1], p);
+            auto s = meet_pass_planner(d);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else if(p.dispatch_simulator.active) {
+            anytime::begin_phase(p.lns.active ? p.anytime.construction_share : 1.0);
+            
+            auto d = data(argv[1], p);
+            auto paths = dispatch_simulator(d).solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+            
+            if(paths && p.lns.active) {
+                anytime::begin_phase(1.0);
+                lns_solver(d).improve(*paths);
+            }
+        } else if(p.lagrangian.active) {
+            auto d = data(argv[1], p);
+            auto s = lagrangian_solver(d);
+            s.solve();
+        } else if(p.rolling_horizon.active) {
+            auto s = rolling_horizon_solver(argv[1], p);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else if(p.multi_resolution.active) {
+            anytime::begin_phase(p.lns.active ? p.anytime.construction_share : 1.0);
+            
+            auto s = multi_resolution_solver(argv[1], p);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+            
+            if(paths && p.lns.active) {
+                anytime::begin_phase(1.0);
+                lns_solver(*s.fine_d).improve(*paths);
+            }
+        } else {
+            anytime::begin_phase(p.lns.active ? p.anytime.construction_share : 1.0);
+            
+            auto d = data(argv[1], p);
+            auto s = sequential_solver(d);
+            auto paths = s.solve_sequentially();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+            
+            if(paths && p.lns.active) {
+                anytime::begin_phase(1.0);
+                lns_solver(d).improve(*paths);
+            }
+        }
     #else
-        auto s = sequential_solver_heuristic(d);
-        s.solve_sequentially();
-	#endif
+        auto d = data(argv[1], p);
+        
+        if(p.cbs.active) {
+            auto s = cbs_solver(d);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else if(p.meet_pass.active) {
+            auto s = meet_pass_planner(d);
+            auto paths = s.solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else if(p.dispatch_simulator.active) {
+            auto paths = dispatch_simulator(d).solve();
+            
+            if(paths) {
+                anytime::offer(*paths);
+            }
+        } else {
+            auto s = lagrangian_solver(d);
+            s.solve();
+        }
+    #endif
+    
+    if(anytime::is_limited()) {
+        std::cout << "ANYTIME >> Stopped after " << anytime::elapsed() << " of " << p.anytime.time_budget << " seconds" << std::endl;
+        
+        // A solver stopped by the deadline does not print its schedule: the best one found so far is the result of the run
+        if(anytime::expired()) {
+            if(auto best = anytime::incumbent()) {
+                std::cout << "ANYTIME >> Best schedule found within the time budget:" << std::endl;
+                
+                for(const auto& pa : *best) {
+                    if(!pa.is_scheduled()) {
+                        std::cout << "\tTrain " << pa.train << ": not scheduled" << std::endl;
+                        continue;
+                    }
+                    
+                    std::cout << "\tTrain " << pa.train << ", cost: " << pa.cost << ", segments:";
+                    
+                    for(auto k = 1u; k + 1u < pa.nodes.size(); k++) {
+                        std::cout << " " << pa.nodes.at(k).seg << "@" << pa.nodes.at(k).t;
+                    }
+                    
+                    std::cout << std::endl;
+                }
+            } else {
+                std::cout << "ANYTIME >> No schedule found within the time budget" << std::endl;
+            }
+        }
+    }
+    
+    memory::checkpoint("run", 0u);
+    memory::write(p.memory.report_file);
+    
+    if(p.profiler.active) {
+        profiler::write(p.profiler.trace_file);
+    }
 
     return 0;
 }
@@ -28,4 +28,84 @@ params::params(std::string file_name) {
             )
         )
     );
+    
+    preprocessing = preprocessing_params(
+        pt.get<bool>("preprocessing.contract_chains")
+    );
+    
+    multi_resolution = multi_resolution_params(
+        pt.get<bool>("multi_resolution.active"),
+        pt.get<unsigned int>("multi_resolution.time_step"),
+        pt.get<unsigned int>("multi_resolution.band")
+    );
+    
+    sequential = sequential_params(
+        sequential_params::portfolio_params(
+            pt.get<bool>("sequential.portfolio.active"),
+            pt.get<unsigned int>("sequential.portfolio.threads"),
+            pt.get<unsigned int>("sequential.portfolio.random_restarts"),
+            pt.get<unsigned int>("sequential.portfolio.seed")
+        )
+    );
+    
+    rolling_horizon = rolling_horizon_params(
+        pt.get<bool>("rolling_horizon.active"),
+        pt.get<unsigned int>("rolling_horizon.window"),
+        pt.get<unsigned int>("rolling_horizon.overlap")
+    );
+    
+    lns = lns_params(
+        pt.get<bool>("lns.active"),
+        pt.get<unsigned int>("lns.iterations"),
+        pt.get<unsigned int>("lns.neighbourhood_size"),
+        pt.get<unsigned int>("lns.time_slice"),
+        pt.get<unsigned int>("lns.threads"),
+        pt.get<unsigned int>("lns.seed")
+    );
+    
+    lagrangian = lagrangian_params(
+        pt.get<bool>("lagrangian.active"),
+        pt.get<unsigned int>("lagrangian.iterations"),
+        pt.get<unsigned int>("lagrangian.threads"),
+        pt.get<double>("lagrangian.step"),
+        pt.get<unsigned int>("lagrangian.repair_every")
+    );
+    
+    cbs = cbs_params(
+        pt.get<bool>("cbs.active"),
+        pt.get<double>("cbs.suboptimality"),
+        pt.get<unsigned int>("cbs.threads"),
+        pt.get<unsigned int>("cbs.max_nodes")
+    );
+    
+    meet_pass = meet_pass_params(
+        pt.get<bool>("meet_pass.active"),
+        pt.get<unsigned int>("meet_pass.lookahead")
+    );
+    
+    dispatch_simulator = dispatch_simulator_params(
+        pt.get<bool>("dispatch_simulator.active"),
+        pt.get<std::string>("dispatch_simulator.rule"),
+        pt.get<unsigned int>("dispatch_simulator.mow_lookahead")
+    );
+    
+    profiler = profiler_params(
+        pt.get<bool>("profiler.active"),
+        pt.get<std::string>("profiler.trace_file")
+    );
+    
+    memory = memory_params(
+        pt.get<unsigned int>("memory.budget_mb"),
+        pt.get<bool>("memory.low_memory_fallback"),
+        pt.get<std::string>("memory.report_file")
+    );
+    
+    anytime = anytime_params(
+        pt.get<double>("anytime.time_budget"),
+        pt.get<double>("anytime.construction_share")
+    );
+    
+    daemon = daemon_params(
+        pt.get<unsigned int>("daemon.improvement_passes")
+    );
 }
\ No newline at end of file
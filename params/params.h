@@ -83,7 +83,307 @@ struct params {
         heuristics_params(mip_constructive_params constructive) : constructive{std::move(constructive)} {}
     };
     
-    /*! Name of the file wehre to save the results */
+    /*! \brief This class contains params relative to the preprocessing of the network */
+    struct preprocessing_params {
+        /*! Wether we want to contract chains of plain main-track segments, over which at most one train runs, into super-segments */
+        bool contract_chains;
+        
+        /*! Empty constructor */
+        preprocessing_params() {}
+        
+        /*! Basic constructor */
+        preprocessing_params(bool contract_chains) : contract_chains{contract_chains} {}
+    };
+    
+    /*! \brief This class contains params relative to the sequential solver */
+    struct sequential_params {
+        /*! \brief This class contains params relative to the portfolio of train orderings */
+        struct portfolio_params {
+            /*! Wether we want to try several orders in which to schedule the trains, rather than just their index order */
+            bool active;
+            
+            /*! Number of orderings evaluated at the same time */
+            unsigned int threads;
+            
+            /*! Number of random orderings to try, besides the ones given by the other strategies */
+            unsigned int random_restarts;
+            
+            /*! Seed for the random orderings */
+            unsigned int seed;
+            
+            /*! Empty constructor */
+            portfolio_params() {}
+            
+            /*! Basic constructor */
+            portfolio_params(   bool active,
+                                unsigned int threads,
+                                unsigned int random_restarts,
+                                unsigned int seed
+            ) :                 active{active},
+                                threads{threads},
+                                random_restarts{random_restarts},
+                                seed{seed} {}
+        };
+        
+        /*! Portfolio params */
+        portfolio_params portfolio;
+        
+        /*! Empty constructor */
+        sequential_params() {}
+        
+        /*! Basic constructor */
+        sequential_params(portfolio_params portfolio) : portfolio{std::move(portfolio)} {}
+    };
+    
+    /*! \brief This class contains params relative to the coarse-to-fine solver */
+    struct multi_resolution_params {
+        /*! Wether we want to solve at a coarser time resolution first, and then only inside a band around the coarse solution */
+        bool active;
+        
+        /*! Number of minutes in a time interval of the coarse problem */
+        unsigned int time_step;
+        
+        /*! Number of minutes the fine corridor extends before and after the times of the coarse solution */
+        unsigned int band;
+        
+        /*! Empty constructor */
+        multi_resolution_params() {}
+        
+        /*! Basic constructor */
+        multi_resolution_params(bool active, unsigned int time_step, unsigned int band) : active{active}, time_step{time_step}, band{band} {}
+    };
+    
+    /*! \brief This class contains params relative to the rolling-horizon solver */
+    struct rolling_horizon_params {
+        /*! Wether we want to solve the problem one time window at a time, rather than over the whole time horizon at once */
+        bool active;
+        
+        /*! Number of time intervals in each window */
+        unsigned int window;
+        
+        /*! Number of time intervals at the end of each window which are solved again as part of the next window */
+        unsigned int overlap;
+        
+        /*! Empty constructor */
+        rolling_horizon_params() {}
+        
+        /*! Basic constructor */
+        rolling_horizon_params(bool active, unsigned int window, unsigned int overlap) : active{active}, window{window}, overlap{overlap} {}
+    };
+    
+    /*! \brief This class contains params relative to the large neighbourhood search */
+    struct lns_params {
+        /*! Wether we want to improve the initial solution by repeatedly rescheduling a few trains at a time */
+        bool active;
+        
+        /*! Number of neighbourhoods to destroy and repair */
+        unsigned int iterations;
+        
+        /*! Maximum number of trains in a neighbourhood */
+        unsigned int neighbourhood_size;
+        
+        /*! Number of time intervals in the time slices used to choose neighbourhoods */
+        unsigned int time_slice;
+        
+        /*! Number of neighbourhoods repaired at the same time */
+        unsigned int threads;
+        
+        /*! Seed for the random choice of the neighbourhoods */
+        unsigned int seed;
+        
+        /*! Empty constructor */
+        lns_params() {}
+        
+        /*! Basic constructor */
+        lns_params( bool active,
+                    unsigned int iterations,
+                    unsigned int neighbourhood_size,
+                    unsigned int time_slice,
+                    unsigned int threads,
+                    unsigned int seed
+        ) :         active{active},
+                    iterations{iterations},
+                    neighbourhood_size{neighbourhood_size},
+                    time_slice{time_slice},
+                    threads{threads},
+                    seed{seed} {}
+    };
+    
+    /*! \brief This class contains params relative to the lagrangian relaxation */
+    struct lagrangian_params {
+        /*! Wether we want to compute a lower bound and a solution by relaxing the constraints linking the trains */
+        bool active;
+        
+        /*! Number of subgradient iterations */
+        unsigned int iterations;
+        
+        /*! Number of trains' subproblems solved at the same time */
+        unsigned int threads;
+        
+        /*! Initial multiplier of the Polyak step size; it is halved when the lower bound stops improving */
+        double step;
+        
+        /*! Number of iterations between two runs of the primal repair heuristic */
+        unsigned int repair_every;
+        
+        /*! Empty constructor */
+        lagrangian_params() {}
+        
+        /*! Basic constructor */
+        lagrangian_params(  bool active,
+                            unsigned int iterations,
+                            unsigned int threads,
+                            double step,
+                            unsigned int repair_every
+        ) :                 active{active},
+                            iterations{iterations},
+                            threads{threads},
+                            step{step},
+                            repair_every{repair_every} {}
+    };
+    
+    /*! \brief This class contains params relative to the conflict-based search */
+    struct cbs_params {
+        /*! Wether we want to schedule the trains by conflict-based search */
+        bool active;
+        
+        /*! The schedule found costs at most this factor (at least 1) times the optimum: 1 asks for an optimal schedule */
+        double suboptimality;
+        
+        /*! Number of constraint tree nodes expanded at the same time */
+        unsigned int threads;
+        
+        /*! Maximum number of constraint tree nodes expanded */
+        unsigned int max_nodes;
+        
+        /*! Empty constructor */
+        cbs_params() {}
+        
+        /*! Basic constructor */
+        cbs_params( bool active,
+                    double suboptimality,
+                    unsigned int threads,
+                    unsigned int max_nodes
+        ) :         active{active},
+                    suboptimality{suboptimality},
+                    threads{threads},
+                    max_nodes{max_nodes} {}
+    };
+    
+    /*! \brief This class contains params relative to the meet-pass planner */
+    struct meet_pass_params {
+        /*! Wether we want to schedule the trains by planning their meets and passes */
+        bool active;
+        
+        /*! A siding is only considered for a conflict if the yielding train reaches it at most this many time intervals earlier */
+        unsigned int lookahead;
+        
+        /*! Empty constructor */
+        meet_pass_params() {}
+        
+        /*! Basic constructor */
+        meet_pass_params(   bool active,
+                            unsigned int lookahead
+        ) :                 active{active},
+                            lookahead{lookahead} {}
+    };
+    
+    /*! \brief This class contains params relative to the dispatch simulator */
+    struct dispatch_simulator_params {
+        /*! Wether we want to schedule the trains by simulating them with a dispatch rule */
+        bool active;
+        
+        /*! The dispatch rule: "priority", "first_come", "want_time", or "all" to try each of them and keep the best schedule */
+        std::string rule;
+        
+        /*! A train does not enter a segment of a loop, if a MOW starts there within this many time intervals after it would leave and it could not go on from there */
+        unsigned int mow_lookahead;
+        
+        /*! Empty constructor */
+        dispatch_simulator_params() {}
+        
+        /*! Basic constructor */
+        dispatch_simulator_params(  bool active,
+                                    std::string rule,
+                                    unsigned int mow_lookahead
+        ) :                         active{active},
+                                    rule{std::move(rule)},
+                                    mow_lookahead{mow_lookahead} {}
+    };
+    
+    /*! \brief This class contains params relative to the profiling of the run */
+    struct profiler_params {
+        /*! Wether we want to record the time spent in each phase of the run */
+        bool active;
+        
+        /*! Name of the file where to save the trace, in the Chrome trace event format */
+        std::string trace_file;
+        
+        /*! Empty constructor */
+        profiler_params() {}
+        
+        /*! Basic constructor */
+        profiler_params(    bool active,
+                            std::string trace_file
+        ) :                 active{active},
+                            trace_file{trace_file} {}
+    };
+    
+    /*! \brief This class contains params relative to the memory budget */
+    struct memory_params {
+        /*! Maximum number of megabytes the graphs and the MIP model are estimated to use; 0 means no limit */
+        unsigned int budget_mb;
+        
+        /*! When the graphs over the whole time horizon would not fit in the budget, switch to the rolling-horizon solver with a window
+         *  that fits, rather than refusing to solve the instance */
+        bool low_memory_fallback;
+        
+        /*! Name of the file where to save the high-water mark of each phase */
+        std::string report_file;
+        
+        /*! Empty constructor */
+        memory_params() {}
+        
+        /*! Basic constructor */
+        memory_params(  unsigned int budget_mb,
+                        bool low_memory_fallback,
+                        std::string report_file
+        ) :             budget_mb{budget_mb},
+                        low_memory_fallback{low_memory_fallback},
+                        report_file{report_file} {}
+    };
+    
+    /*! \brief This class contains params relative to the wall-clock budget of the whole run */
+    struct anytime_params {
+        /*! Number of seconds all the phases of the run may take together; 0 means no budget */
+        double time_budget;
+        
+        /*! Share of the budget given to building the first schedule, when it is then improved by the large neighbourhood search */
+        double construction_share;
+        
+        /*! Empty constructor */
+        anytime_params() {}
+        
+        /*! Basic constructor */
+        anytime_params( double time_budget,
+                        double construction_share
+        ) :             time_budget{time_budget},
+                        construction_share{construction_share} {}
+    };
+    
+    /*! \brief This class contains params relative to the re-optimisation daemon */
+    struct daemon_params {
+        /*! Number of times the trains running close to the ones affected by an update are re-planned, keeping the cheaper paths */
+        unsigned int improvement_passes;
+        
+        /*! Empty constructor */
+        daemon_params() {}
+        
+        /*! Basic constructor */
+        daemon_params(unsigned int improvement_passes) : improvement_passes{improvement_passes} {}
+    };
+    
+    /*! Name of the file where to append the results: CSV if it ends in ".csv", JSON Lines otherwise; empty to write no results */
     std::string         results_file;
     
     /*! Params relative to CPLEX */
@@ -92,6 +392,45 @@ struct params {
     /*! Params relative to the heuristics */
     heuristics_params   heuristics;
     
+    /*! Params relative to the preprocessing */
+    preprocessing_params preprocessing;
+    
+    /*! Params relative to the coarse-to-fine solver */
+    multi_resolution_params multi_resolution;
+    
+    /*! Params relative to the sequential solver */
+    sequential_params sequential;
+    
+    /*! Params relative to the rolling-horizon solver */
+    rolling_horizon_params rolling_horizon;
+    
+    /*! Params relative to the large neighbourhood search */
+    lns_params lns;
+    
+    /*! Params relative to the lagrangian relaxation */
+    lagrangian_params lagrangian;
+    
+    /*! Params relative to the conflict-based search */
+    cbs_params cbs;
+    
+    /*! Params relative to the meet-pass planner */
+    meet_pass_params meet_pass;
+    
+    /*! Params relative to the dispatch simulator */
+    dispatch_simulator_params dispatch_simulator;
+    
+    /*! Params relative to the profiling */
+    profiler_params profiler;
+    
+    /*! Params relative to the memory budget */
+    memory_params memory;
+    
+    /*! Params relative to the wall-clock budget */
+    anytime_params anytime;
+    
+    /*! Params relative to the re-optimisation daemon */
+    daemon_params daemon;
+    
     /*! Construct the params from the given params file */
     params(std::string file_name);
 };
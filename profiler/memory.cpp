@@ -0,0 +1,216 @@
+#include <profiler/memory.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+#include <sys/resource.h>
+
+std::mutex memory::records_mutex;
+bv<memory::phase_record> memory::records;
+
+namespace {
+    // Rough figures for Concert and CPLEX, including the names given to variables and constraints
+    constexpr std::size_t bytes_per_column = 160u;
+    constexpr std::size_t bytes_per_row = 160u;
+    constexpr std::size_t bytes_per_nonzero = 48u;
+    constexpr std::size_t bytes_per_handle_array = 32u;
+    
+    // Bytes allocated by the vector, not counting the vector object itself
+    template<typename T>
+    auto heap_bytes(const bv<T>& v) -> std::size_t {
+        return v.capacity() * sizeof(T);
+    }
+    
+    template<typename T>
+    auto heap_bytes(const bv<bv<T>>& v) -> std::size_t {
+        return std::accumulate(v.begin(), v.end(), v.capacity() * sizeof(bv<T>), [] (std::size_t bytes, const bv<T>& w) {
+            return bytes + heap_bytes(w);
+        });
+    }
+    
+    template<typename T>
+    auto bytes_of(const bv<T>& v) -> std::size_t {
+        return sizeof(v) + heap_bytes(v);
+    }
+    
+    // Bytes allocated by a (nt, ns + 2, ni + 2, width) matrix of T, with width = 1 for the three-dimensional ones
+    template<typename T>
+    auto matrix_estimate(std::size_t nt, std::size_t ns, std::size_t ni, std::size_t width) -> std::size_t {
+        auto header = sizeof(bv<T>);
+        auto nodes = nt * (ns + 2) * (ni + 2);
+        
+        if(width == 1u) {
+            return header + nt * header + nt * (ns + 2) * header + nodes * sizeof(T);
+        }
+        
+        return header + nt * header + nt * (ns + 2) * header + nodes * header + nodes * width * sizeof(T);
+    }
+}
+
+auto memory::graph_estimate(unsigned int nt, unsigned int ns, unsigned int ni) -> std::size_t {
+    return  matrix_estimate<bool>(nt, ns, ni, 1u) +             // v
+            matrix_estimate<bool>(nt, ns, ni, ns + 2) +         // adj
+            2 * matrix_estimate<unsigned int>(nt, ns, ni, 1u) + // n_in and n_out
+            matrix_estimate<cost_type>(nt, ns, ni, ns + 2);     // costs
+}
+
+auto memory::graph_bytes(const graph& gr) -> std::size_t {
+    return  bytes_of(gr.n_nodes) + bytes_of(gr.n_arcs) + bytes_of(gr.v_for_someone) +
+            bytes_of(gr.delta) + bytes_of(gr.inverse_delta) + bytes_of(gr.bar_delta) + bytes_of(gr.bar_inverse_delta) +
+            bytes_of(gr.trains_for) + bytes_of(gr.v) + bytes_of(gr.adj) + bytes_of(gr.n_out) + bytes_of(gr.n_in) +
+            bytes_of(gr.costs) + bytes_of(gr.first_time_we_need_tau);
+}
+
+auto memory::network_bytes(const network& net) -> std::size_t {
+    return  bytes_of(net.sidings) + bytes_of(net.xovers) + bytes_of(net.min_time_to_arrive) + bytes_of(net.min_travel_time) +
+            bytes_of(net.main_tracks) + bytes_of(net.unpreferred) + bytes_of(net.connected) + bytes_of(net.chain) +
+            bytes_of(net.chain_travel_time);
+}
+
+auto memory::model_estimate(const data& d) -> model_size {
+    auto h = static_cast<std::size_t>(d.headway);
+    auto n_sidings = d.net.sidings.size();
+    auto n_heavy = static_cast<std::size_t>(std::count(d.trn.is_heavy.begin(), d.trn.is_heavy.end(), true));
+    auto arcs = static_cast<std::size_t>(std::accumulate(d.gr.n_arcs.begin(), d.gr.n_arcs.end(), 0ul));
+    auto flow_rows = 0ul;
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        for(auto s = 1u; s <= d.ns; s++) {
+            flow_rows += std::count(d.gr.v.at(i).at(s).begin() + 1, d.gr.v.at(i).at(s).end() - 1, true);
+        }
+    }
+    
+    auto sz = model_size();
+    auto siding_rows = (d.nt + n_heavy) * n_sidings * d.ni;
+    
+    sz.columns = arcs + d.nt * (d.ns + 2);
+    
+    sz.rows =   2 * d.nt +                  // exit_sigma and enter_tau
+                flow_rows +                 // flow
+                4 * d.ns * d.ni +           // max_one_train and headway 1, 2 and 3
+                d.nt * d.ns +               // set_excess_travel_time
+                siding_rows +               // siding and heavy
+                d.nt * d.net.xovers.size(); // cant_stop
+    
+    // Each arc appears in two flow constraints, max_one_train, set_excess_travel_time at both ends, and in about h + 1 rows of each
+    // headway family; a siding or heavy row looks at the arcs of every other train entering the main tracks within one headway
+    sz.nonzeros =   arcs * (5 + 3 * (h + 1)) +
+                    d.nt * d.ns +
+                    siding_rows * (1 + (d.nt - 1) * (2 * h + 1));
+    
+    // The solver also keeps a handle for each (tr, s1, t, s2), wether the arc exists or not
+    auto handles = static_cast<std::size_t>(d.nt) * (d.ns + 2) * (d.ni + 1);
+    
+    sz.bytes =  sz.columns * bytes_per_column +
+                sz.rows * bytes_per_row +
+                sz.nonzeros * bytes_per_nonzero +
+                handles * (bytes_per_handle_array + (d.ns + 2) * sizeof(void*));
+    
+    return sz;
+}
+
+auto memory::fit_budget(const boost::property_tree::ptree& pt, params& p) -> bool {
+    auto nt = pt.get<unsigned int>("trains_number");
+    auto ns = pt.get<unsigned int>("segments_number");
+    auto ni = pt.get<unsigned int>("time_intervals");
+    auto budget = megabytes(p.memory.budget_mb);
+    auto estimate = graph_estimate(nt, ns, ni);
+    
+    std::cout << "MEMORY >> The graphs need an estimated " << estimate / (1024 * 1024) << " MB, the budget is " << p.memory.budget_mb << " MB" << std::endl;
+    
+    if(estimate <= budget) {
+        return true;
+    }
+    
+    #if USE_CPLEX
+        if(p.memory.low_memory_fallback) {
+            auto window = std::min(p.rolling_horizon.window, ni);
+            
+            while(window > 1u && graph_estimate(nt, ns, window) > budget) {
+                window--;
+            }
+            
+            if(graph_estimate(nt, ns, window) <= budget) {
+                std::cout << "MEMORY >> Switching to the rolling-horizon solver with a window of " << window << " time intervals" << std::endl;
+                
+                // The solvers main() would run before the rolling-horizon one are all turned off
+                p.cbs.active = false;
+                p.meet_pass.active = false;
+                p.dispatch_simulator.active = false;
+                p.lagrangian.active = false;
+                p.rolling_horizon.active = true;
+                p.rolling_horizon.window = window;
+                p.rolling_horizon.overlap = std::min(p.rolling_horizon.overlap, window / 4);
+                
+                return true;
+            }
+        }
+    #endif
+    
+    std::cerr << "MEMORY >> Not solving the instance: its graphs would not fit in the memory budget" << std::endl;
+    
+    return false;
+}
+
+auto memory::peak_rss() -> std::size_t {
+    // The high-water mark in /proc can be reset, unlike the one getrusage gives, which is only used where there is no /proc
+    std::ifstream status("/proc/self/status");
+    auto line = std::string();
+    
+    while(std::getline(status, line)) {
+        if(line.compare(0, 6, "VmHWM:") == 0) {
+            return static_cast<std::size_t>(std::stoul(line.substr(6))) * 1024u;
+        }
+    }
+    
+    auto usage = rusage();
+    
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0u;
+    }
+    
+    #if __APPLE__
+        return static_cast<std::size_t>(usage.ru_maxrss);
+    #else
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024u;
+    #endif
+}
+
+auto memory::reset_peak_rss() -> bool {
+    // Writing 5 resets the high-water mark of the resident set size to its current value
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    
+    clear_refs << "5";
+    clear_refs.flush();
+    
+    return static_cast<bool>(clear_refs);
+}
+
+auto memory::checkpoint(const std::string& phase, std::size_t accounted) -> void {
+    auto peak = peak_rss();
+    
+    std::lock_guard<std::mutex> lock(records_mutex);
+    
+    auto r = std::find_if(records.begin(), records.end(), [&] (const phase_record& rec) { return rec.phase == phase; });
+    
+    if(r == records.end()) {
+        records.push_back(phase_record{phase, 1u, peak, accounted});
+    } else {
+        r->count++;
+        r->peak = std::max(r->peak, peak);
+        r->accounted = std::max(r->accounted, accounted);
+    }
+}
+
+auto memory::write(const std::string& file_name) -> void {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    std::ofstream out(file_name, std::ios::out);
+    
+    out << "phase\tcount\tpeak_mb\taccounted_mb" << std::endl;
+    
+    for(const auto& r : records) {
+        out << r.phase << "\t" << r.count << "\t" << r.peak / (1024.0 * 1024.0) << "\t" << r.accounted / (1024.0 * 1024.0) << std::endl;
+    }
+}
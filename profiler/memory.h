@@ -0,0 +1,85 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/graph.h>
+#include <data/network.h>
+#include <params/params.h>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+/*! \brief This class estimates and accounts for the memory used by the largest structures of a run: the trains' graphs, the network
+ *  and the MIP model. The estimates only depend on the size of the instance, so that they can be checked against the memory budget
+ *  before anything big is allocated. At the end of each phase, the process' high-water mark is recorded, together with the bytes
+ *  accounted for by the structures alive at that point.
+ */
+struct memory {
+    /*! \brief Estimated size of the MIP model */
+    struct model_size {
+        /*! Number of columns: one for each arc of each train's graph, plus the excess travel time variables */
+        std::size_t columns;
+        
+        /*! Number of rows */
+        std::size_t rows;
+        
+        /*! Number of nonzero coefficients in the constraint matrix */
+        std::size_t nonzeros;
+        
+        /*! Estimated bytes allocated by Concert and CPLEX to hold the model */
+        std::size_t bytes;
+    };
+    
+    /*! Bytes the graph constructor will allocate for v, adj, n_in, n_out and costs for the given numbers of trains, segments and time intervals */
+    static auto graph_estimate(unsigned int nt, unsigned int ns, unsigned int ni) -> std::size_t;
+    
+    /*! Bytes actually allocated by the graph */
+    static auto graph_bytes(const graph& gr) -> std::size_t;
+    
+    /*! Bytes actually allocated by the network */
+    static auto network_bytes(const network& net) -> std::size_t;
+    
+    /*! Size of the MIP model the solver would build over the trains' graphs */
+    static auto model_estimate(const data& d) -> model_size;
+    
+    /*! Checks that the graphs of the instance read in pt fit in the memory budget of p. If they do not and the low-memory fallback is on,
+     *  switches p to the rolling-horizon solver with the longest window whose graphs fit. Returns false if the instance cannot be solved
+     *  within the budget.
+     */
+    static auto fit_budget(const boost::property_tree::ptree& pt, params& p) -> bool;
+    
+    /*! Largest resident set size the process has had so far, or since the last reset_peak_rss(), in bytes */
+    static auto peak_rss() -> std::size_t;
+    
+    /*! Starts measuring the peak resident set size afresh, from the current resident set size. Only Linux can do it: returns
+     *  false if the peak could not be reset
+     */
+    static auto reset_peak_rss() -> bool;
+    
+    /*! Records the high-water mark at the end of a phase, together with the bytes accounted for by the structures alive during it */
+    static auto checkpoint(const std::string& phase, std::size_t accounted) -> void;
+    
+    /*! Writes, for each phase, the number of times it ended and the largest high-water mark and accounted bytes recorded for it */
+    static auto write(const std::string& file_name) -> void;
+    
+    /*! Converts megabytes to bytes */
+    static auto megabytes(double mb) -> std::size_t { return static_cast<std::size_t>(mb * 1024 * 1024); }
+
+private:
+    
+    struct phase_record {
+        std::string phase;
+        unsigned int count;
+        std::size_t peak;
+        std::size_t accounted;
+    };
+    
+    static std::mutex records_mutex;
+    static bv<phase_record> records;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include <profiler/profiler.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+constexpr unsigned int profiler::no_train;
+
+std::atomic<bool> profiler::enabled(false);
+std::mutex profiler::events_mutex;
+bv<profiler::event> profiler::events;
+std::chrono::steady_clock::time_point profiler::origin;
+
+profiler::span::span(const char* name) : span(name, no_train) {}
+
+profiler::span::span(const char* name, unsigned int train) : name{name}, train{train}, active{profiler::is_enabled()} {
+    if(active) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+profiler::span::~span() {
+    using namespace std::chrono;
+    
+    if(!active) {
+        return;
+    }
+    
+    auto end = steady_clock::now();
+    auto e = event{name, train, thread_id(), duration<double, std::micro>(start - origin).count(), duration<double, std::micro>(end - start).count()};
+    
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(e);
+}
+
+auto profiler::enable() -> void {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    
+    if(!enabled) {
+        origin = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+}
+
+auto profiler::write(const std::string& file_name) -> void {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    std::ofstream out(file_name, std::ios::out);
+    
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\": [" << std::endl;
+    
+    for(auto k = 0u; k < events.size(); k++) {
+        const auto& e = events.at(k);
+        const auto* slash = std::strchr(e.name, '/');
+        auto category = (slash ? std::string(e.name, slash) : std::string(e.name));
+        
+        out << "    {\"name\": \"" << e.name << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", ";
+        out << "\"ts\": " << e.start << ", \"dur\": " << e.duration << ", \"pid\": 0, \"tid\": " << e.thread;
+        
+        if(e.train != no_train) {
+            out << ", \"args\": {\"train\": " << e.train << "}";
+        }
+        
+        out << "}" << (k + 1 < events.size() ? "," : "") << std::endl;
+    }
+    
+    out << "], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+auto profiler::totals() -> bv<std::pair<std::string, double>> {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    auto names = bv<std::string>();
+    auto intervals = bv<bv<std::pair<double, double>>>();
+    
+    for(const auto& e : events) {
+        auto it = std::find(names.begin(), names.end(), e.name);
+        
+        if(it == names.end()) {
+            names.push_back(e.name);
+            intervals.push_back(bv<std::pair<double, double>>());
+            it = names.end() - 1;
+        }
+        
+        intervals.at(it - names.begin()).push_back(std::make_pair(e.start, e.start + e.duration));
+    }
+    
+    auto result = bv<std::pair<std::string, double>>();
+    
+    // The wall time of a name is the length of the union of its spans
+    for(auto k = 0u; k < names.size(); k++) {
+        auto& spans = intervals.at(k);
+        auto total = 0.0;
+        auto covered_until = 0.0;
+        
+        std::sort(spans.begin(), spans.end());
+        
+        for(const auto& sp : spans) {
+            if(sp.second > covered_until) {
+                total += sp.second - std::max(sp.first, covered_until);
+                covered_until = sp.second;
+            }
+        }
+        
+        result.push_back(std::make_pair(names.at(k), total / 1000));
+    }
+    
+    return result;
+}
+
+auto profiler::clear() -> void {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.clear();
+}
+
+auto profiler::thread_id() -> unsigned int {
+    static std::atomic<unsigned int> n_threads(0u);
+    thread_local auto id = n_threads++;
+    
+    return id;
+}
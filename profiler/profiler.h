@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <data/array.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/*! \brief This class collects the time spent in the phases of a run and writes it in the Chrome trace event format, which can be
+ *  opened with chrome://tracing or ui.perfetto.dev. It is disabled by default: then, opening and closing a span costs reading a flag.
+ */
+struct profiler {
+    /*! \brief A phase of the run: it starts when the object is constructed and it ends when the object is destroyed.
+     *  Spans opened, in the same thread, while another span is open are shown nested in it.
+     */
+    struct span {
+        /*! Opens a span with the given name: names are given as "category/phase", e.g. "graph/cleanup" */
+        span(const char* name);
+        
+        /*! Opens a span relative to a train, e.g. the iteration of the sequential solver scheduling it */
+        span(const char* name, unsigned int train);
+        
+        /*! Closes the span */
+        ~span();
+        
+        span(const span&) = delete;
+        auto operator=(const span&) -> span& = delete;
+    
+    private:
+        
+        const char* name;
+        unsigned int train;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+    };
+    
+    /*! Value used for spans not relative to any train */
+    static constexpr unsigned int no_train = std::numeric_limits<unsigned int>::max();
+    
+    /*! Starts collecting spans */
+    static auto enable() -> void;
+    
+    /*! Tells wether spans are being collected */
+    static auto is_enabled() -> bool { return enabled.load(std::memory_order_relaxed); }
+    
+    /*! Writes all the spans closed so far to the given file */
+    static auto write(const std::string& file_name) -> void;
+    
+    /*! For each span name, in order of first appearance, milliseconds of wall time during which a span closed so far with that name
+     *  was open: spans open at the same time in different threads, as in the parallel phases, are not added up
+     */
+    static auto totals() -> bv<std::pair<std::string, double>>;
+    
+    /*! Forgets all the spans closed so far */
+    static auto clear() -> void;
+
+private:
+    
+    struct event {
+        const char* name;
+        unsigned int train;
+        unsigned int thread;
+        double start;
+        double duration;
+    };
+    
+    static std::atomic<bool> enabled;
+    static std::mutex events_mutex;
+    static bv<event> events;
+    static std::chrono::steady_clock::time_point origin;
+    
+    static auto thread_id() -> unsigned int;
+};
+
+#endif
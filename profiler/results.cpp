@@ -0,0 +1,212 @@
+#include <profiler/results.h>
+#include <data/prices.h>
+#include <profiler/profiler.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The header is written at build time by cmake/Revision.cmake
+#if HAVE_RAS_REVISION
+    #include <ras_revision.h>
+#endif
+
+#ifndef RAS_REVISION
+    #define RAS_REVISION "unknown"
+#endif
+
+const char* const results::revision = RAS_REVISION;
+
+namespace {
+    auto ends_with(const std::string& text, const std::string& suffix) -> bool {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+    
+    auto json_quoted(const std::string& text) -> std::string {
+        auto quoted = std::string("\"");
+        
+        for(auto c : text) {
+            if(c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if(static_cast<unsigned char>(c) < 0x20u) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+        
+        return quoted + "\"";
+    }
+    
+    auto csv_quoted(const std::string& text) -> std::string {
+        if(text.find_first_of(",\"\n\r") == std::string::npos) {
+            return text;
+        }
+        
+        auto quoted = std::string("\"");
+        
+        for(auto c : text) {
+            quoted += c;
+            
+            if(c == '"') {
+                quoted += '"';
+            }
+        }
+        
+        return quoted + "\"";
+    }
+    
+    // Current date and time, in UTC and ISO 8601 format
+    auto timestamp() -> std::string {
+        auto now = std::time(nullptr);
+        std::tm utc;
+        char text[32];
+        
+        gmtime_r(&now, &utc);
+        std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        
+        return text;
+    }
+}
+
+results::row::row(const std::string& solver, const data& d, unsigned int threads) {
+    add("solver", solver);
+    add("timestamp", timestamp());
+    add("revision", std::string(revision));
+    add("file", d.ins.file_name);
+    add("trains", d.nt);
+    add("segments", d.ns);
+    add("time_intervals", d.ni);
+    add("threads", threads);
+    add("graph_nodes", std::accumulate(d.gr.n_nodes.begin(), d.gr.n_nodes.end(), 0.0));
+    add("graph_arcs", std::accumulate(d.gr.n_arcs.begin(), d.gr.n_arcs.end(), 0.0));
+    add("cost_unit", prices::cost_unit);
+}
+
+auto results::row::add(const std::string& name, double value) -> row& {
+    auto text = std::ostringstream();
+    
+    if(std::isfinite(value)) {
+        text.precision(std::numeric_limits<double>::digits10);
+        text << value;
+    }
+    
+    columns.push_back({name, text.str(), false});
+    
+    return *this;
+}
+
+auto results::row::add(const std::string& name, const std::string& value) -> row& {
+    columns.push_back({name, value, true});
+    
+    return *this;
+}
+
+auto results::row::add(const path::cost_breakdown& objective) -> row& {
+    add("objective", objective.total());
+    add("objective_delay", objective.delay);
+    add("objective_terminal", objective.terminal);
+    add("objective_sa", objective.sa);
+    add("objective_unpreferred", objective.unpreferred);
+    
+    return *this;
+}
+
+auto results::row::add_profiler_totals() -> row& {
+    if(profiler::is_enabled()) {
+        for(const auto& phase : profiler::totals()) {
+            add("ms_" + phase.first, phase.second);
+        }
+    }
+    
+    return *this;
+}
+
+auto results::append(const std::string& file_name, const row& r) -> bool {
+    if(file_name.empty()) {
+        return true;
+    }
+    
+    auto csv = ends_with(file_name, ".csv");
+    auto fd = open(file_name.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    
+    if(fd < 0) {
+        std::cerr << "RESULTS >> Cannot open " << file_name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // The lock is held from checking whether the file is empty, i.e. needs a header, to writing the row
+    if(flock(fd, LOCK_EX) != 0) {
+        std::cerr << "RESULTS >> Cannot lock " << file_name << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    
+    struct stat info;
+    auto text = std::string();
+    
+    if(csv) {
+        if(fstat(fd, &info) == 0 && info.st_size == 0) {
+            for(auto k = 0u; k < r.columns.size(); k++) {
+                text += (k > 0u ? "," : "") + csv_quoted(r.columns.at(k).name);
+            }
+            
+            text += "\n";
+        }
+        
+        for(auto k = 0u; k < r.columns.size(); k++) {
+            const auto& col = r.columns.at(k);
+            
+            text += (k > 0u ? "," : "") + (col.is_text ? csv_quoted(col.value) : col.value);
+        }
+    } else {
+        text += "{";
+        
+        for(auto k = 0u; k < r.columns.size(); k++) {
+            const auto& col = r.columns.at(k);
+            auto value = (col.is_text ? json_quoted(col.value) : (col.value.empty() ? std::string("null") : col.value));
+            
+            text += (k > 0u ? ", " : "") + json_quoted(col.name) + ": " + value;
+        }
+        
+        text += "}";
+    }
+    
+    text += "\n";
+    
+    auto written = std::size_t{0u};
+    
+    while(written < text.size()) {
+        auto n = write(fd, text.data() + written, text.size() - written);
+        
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if(n <= 0) {
+            std::cerr << "RESULTS >> Cannot write " << file_name << ": " << std::strerror(errno) << std::endl;
+            break;
+        }
+        
+        written += static_cast<std::size_t>(n);
+    }
+    
+    flock(fd, LOCK_UN);
+    close(fd);
+    
+    return (written == text.size());
+}
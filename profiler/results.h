@@ -0,0 +1,59 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+
+#include <string>
+
+/*! \brief This class appends the results of a run to the results file, one row per run. If the file name ends in ".csv" the rows
+ *  are written in CSV, with a header line when the file is created; otherwise each row is a JSON object on its own line (JSON Lines).
+ *  A row is written with a single write while holding an exclusive lock on the file, so that the runs of a batch can share the
+ *  same results file without interleaving their rows. All the rows of a CSV file should come from the same solver, so that they
+ *  have the same columns.
+ */
+struct results {
+    /*! \brief A named value of a row */
+    struct column {
+        /*! Name of the column */
+        std::string name;
+        
+        /*! The value, already formatted: it is empty for numbers which are not finite, which are written as missing values */
+        std::string value;
+        
+        /*! True iff the value is text, to be quoted */
+        bool is_text;
+    };
+    
+    /*! \brief One row of the results file: an ordered list of named values */
+    struct row {
+        /*! The columns, in order */
+        bv<column> columns;
+        
+        /*! Starts a row with the columns describing the run: solver name, date, revision of the code, instance file and size,
+         *  number of threads and size of the trains' graphs (zero if the data has no graphs)
+         */
+        row(const std::string& solver, const data& d, unsigned int threads);
+        
+        /*! Adds a numeric column */
+        auto add(const std::string& name, double value) -> row&;
+        
+        /*! Adds a text column */
+        auto add(const std::string& name, const std::string& value) -> row&;
+        
+        /*! Adds a column for each kind of penalty of the objective function, named objective_delay, objective_terminal, and so on */
+        auto add(const path::cost_breakdown& objective) -> row&;
+        
+        /*! Adds a column for each phase timed by the profiler, with its total milliseconds, if the profiler is enabled */
+        auto add_profiler_totals() -> row&;
+    };
+    
+    /*! Revision of the code the program was built from, or "unknown" */
+    static const char* const revision;
+    
+    /*! Appends the row to the given file, or does nothing if the file name is empty. Returns false if the file could not be written */
+    static auto append(const std::string& file_name, const row& r) -> bool;
+};
+
+#endif
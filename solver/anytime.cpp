@@ -0,0 +1,122 @@
+#include <solver/anytime.h>
+
+#include <algorithm>
+#include <limits>
+
+std::mutex anytime::state_mutex;
+anytime::clock::time_point anytime::origin = anytime::clock::now();
+anytime::clock::time_point anytime::phase_end = anytime::clock::time_point::max();
+bool anytime::limited = false;
+double anytime::budget = 0.0;
+bv<anytime::incumbent_callback> anytime::callbacks;
+boost::optional<bv<anytime::train_path>> anytime::best;
+unsigned int anytime::best_scheduled = 0u;
+double anytime::best_cost = 0.0;
+
+namespace {
+    auto seconds_between(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) -> double {
+        return std::chrono::duration<double>(to - from).count();
+    }
+}
+
+auto anytime::start(double budget) -> void {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    
+    anytime::budget = budget;
+    origin = clock::now();
+    limited = (budget > 0.0);
+    phase_end = limited ? origin + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget)) : clock::time_point::max();
+    best = boost::none;
+}
+
+auto anytime::begin_phase(double share) -> void {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    
+    if(!limited) {
+        return;
+    }
+    
+    auto now = clock::now();
+    auto deadline = origin + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget));
+    auto left = std::max(seconds_between(now, deadline), 0.0);
+    
+    phase_end = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(std::min(std::max(share, 0.0), 1.0) * left));
+}
+
+auto anytime::is_limited() -> bool {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return limited;
+}
+
+auto anytime::elapsed() -> double {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return seconds_between(origin, clock::now());
+}
+
+auto anytime::time_left() -> double {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    
+    if(!limited) {
+        return std::numeric_limits<double>::max();
+    }
+    
+    return std::max(seconds_between(clock::now(), phase_end), 0.0);
+}
+
+auto anytime::expired() -> bool {
+    return time_left() <= 0.0;
+}
+
+auto anytime::step_time(double cap, double weight, double remaining_weight) -> double {
+    if(remaining_weight <= 0.0) {
+        return std::min(cap, time_left());
+    }
+    
+    return std::min(cap, time_left() * weight / remaining_weight);
+}
+
+auto anytime::on_incumbent(incumbent_callback callback) -> void {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    callbacks.push_back(std::move(callback));
+}
+
+auto anytime::offer(const bv<path>& paths) -> bool {
+    auto scheduled = 0u;
+    auto cost = 0.0;
+    
+    for(const auto& p : paths) {
+        if(!p.is_empty() && !p.is_dummy()) {
+            scheduled++;
+            cost += p.cost;
+        }
+    }
+    
+    // The callbacks are called with the lock held, so that they see the incumbents in order
+    std::lock_guard<std::mutex> lock(state_mutex);
+    
+    if(best && (scheduled < best_scheduled || (scheduled == best_scheduled && cost >= best_cost - 1e-6))) {
+        return false;
+    }
+    
+    best = bv<train_path>();
+    
+    for(const auto& p : paths) {
+        best->push_back({p.train, (p.is_empty() || p.is_dummy()) ? bv<path::node>() : p.original_p, p.cost});
+    }
+    
+    best_scheduled = scheduled;
+    best_cost = cost;
+    
+    auto elapsed = seconds_between(origin, clock::now());
+    
+    for(const auto& callback : callbacks) {
+        callback(paths, cost, elapsed);
+    }
+    
+    return true;
+}
+
+auto anytime::incumbent() -> boost::optional<bv<train_path>> {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return best;
+}
@@ -0,0 +1,88 @@
+#ifndef ANYTIME_H
+#define ANYTIME_H
+
+#include <data/array.h>
+#include <data/path.h>
+
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+/*! \brief This class enforces a wall-clock budget shared by all the phases of a run, and keeps the best schedule found so far.
+ *  The budget is split into phases, e.g. building a schedule and then improving it: each phase may use a share of the time still
+ *  left when it begins. Within a phase, the solvers ask how much time they can give to their next step, so that the time left over
+ *  by fast steps goes to the slower ones. Whenever a solver finds a schedule better than the incumbent, the callbacks registered
+ *  by the user receive it together with its cost and the seconds elapsed since the start of the run. Until start() is called,
+ *  there is no budget: no phase ever runs out of time.
+ */
+struct anytime {
+    /*! \brief A train's path in the incumbent, kept on its own: the data the proposed paths point to may be gone by the time
+     *  the incumbent is read
+     */
+    struct train_path {
+        /*! The train's id */
+        unsigned int train;
+        
+        /*! The succession of nodes visited by the train, in terms of the original segments, or empty if the train is not scheduled */
+        bv<path::node> nodes;
+        
+        /*! The cost of the path */
+        double cost;
+        
+        /*! Tells wether the train is scheduled */
+        auto is_scheduled() const -> bool { return !nodes.empty(); }
+    };
+    
+    /*! Function receiving a new incumbent, its cost and the seconds elapsed since the start of the run */
+    using incumbent_callback = std::function<void(const bv<path>&, double, double)>;
+    
+    /*! Starts the clock with a budget of the given number of seconds (0 means no budget) and forgets the incumbent */
+    static auto start(double budget) -> void;
+    
+    /*! Begins a phase, which may use the given share (between 0 and 1) of the time left */
+    static auto begin_phase(double share) -> void;
+    
+    /*! Tells wether a budget is being enforced */
+    static auto is_limited() -> bool;
+    
+    /*! Seconds elapsed since the clock was started */
+    static auto elapsed() -> double;
+    
+    /*! Seconds left in the current phase, or a very large number if there is no budget */
+    static auto time_left() -> double;
+    
+    /*! Tells wether the current phase has run out of time */
+    static auto expired() -> bool;
+    
+    /*! Seconds a step can use if it weighs weight out of the remaining_weight of the steps left in the phase, but at most cap */
+    static auto step_time(double cap, double weight, double remaining_weight) -> double;
+    
+    /*! Registers a callback, called with every new incumbent */
+    static auto on_incumbent(incumbent_callback callback) -> void;
+    
+    /*! Proposes a schedule, with one path for each train: it becomes the incumbent if it schedules more trains than the
+     *  incumbent or the same trains at a lower cost. Returns true in this case.
+     */
+    static auto offer(const bv<path>& paths) -> bool;
+    
+    /*! The best schedule proposed so far, if any, with one path for each train */
+    static auto incumbent() -> boost::optional<bv<train_path>>;
+
+private:
+    
+    using clock = std::chrono::steady_clock;
+    
+    static std::mutex state_mutex;
+    static clock::time_point origin;
+    static clock::time_point phase_end;
+    static bool limited;
+    static double budget;
+    static bv<incumbent_callback> callbacks;
+    static boost::optional<bv<train_path>> best;
+    static unsigned int best_scheduled;
+    static double best_cost;
+};
+
+#endif
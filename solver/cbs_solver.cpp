@@ -0,0 +1,315 @@
+#include <solver/cbs_solver.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+cbs_solver::cbs_solver(const data& d) : d{d}, evaluator{d} {
+    lower_bound = 0.0;
+    upper_bound = std::numeric_limits<double>::max();
+    n_expanded = 0u;
+}
+
+auto cbs_solver::solve() -> boost::optional<bv<path>> {
+    auto t_start = std::chrono::steady_clock::now();
+    auto factor = std::max(1.0, d.p.cbs.suboptimality);
+    auto best = std::shared_ptr<const node>();
+    
+    // Lowest cost of a node which was split cutting off some schedules: the optimum can be below the costs of the open nodes
+    auto cut_bound = std::numeric_limits<double>::max();
+    
+    {
+        profiler::span phase("cbs/layers");
+        
+        layers.clear();
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            layers.push_back(std::make_shared<const train_dp::layered_graph>(d, i));
+        }
+    }
+    
+    // Finds the paths of the new nodes in parallel: the root needs all the trains' paths, every other node only one train's
+    auto replan_all = [&] (bv<std::shared_ptr<node>>& nodes) {
+        profiler::span phase("cbs/low_level");
+        
+        auto ok = bool_vector(nodes.size(), false);
+        std::atomic<unsigned int> next(0u);
+        
+        auto worker = [&] () {
+            for(auto k = next++; k < nodes.size(); k = next++) {
+                ok.at(k) = replan(*nodes.at(k));
+            }
+        };
+        
+        auto n_threads = std::max(1u, std::min(d.p.cbs.threads, static_cast<unsigned int>(nodes.size())));
+        auto threads = std::vector<std::thread>();
+        
+        for(auto n = 0u; n < n_threads; n++) {
+            threads.emplace_back(worker);
+        }
+        
+        for(auto& t : threads) {
+            t.join();
+        }
+        
+        auto kept = bv<std::shared_ptr<node>>();
+        
+        for(auto k = 0u; k < nodes.size(); k++) {
+            if(ok.at(k)) {
+                kept.push_back(nodes.at(k));
+            }
+        }
+        
+        return kept;
+    };
+    
+    auto root = std::make_shared<node>();
+    
+    root->paths = bv<bv<path::node>>(d.nt);
+    root->costs = double_vector(d.nt, 0.0);
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        auto dp = train_dp(d, i, layers.at(i));
+        auto p = dp.solve();
+        
+        if(!p) {
+            std::cout << "CBS_SOLVER >> Train " << i << " has no feasible path!" << std::endl;
+            return boost::none;
+        }
+        
+        root->paths.at(i) = *p;
+        root->costs.at(i) = dp.priced_cost;
+    }
+    
+    root->cost = std::accumulate(root->costs.begin(), root->costs.end(), 0.0);
+    root->conflicts = evaluator.evaluate(root->paths).violations;
+    
+    auto open = bv<std::shared_ptr<const node>>({root});
+    
+    while(!open.empty()) {
+        if(n_expanded >= d.p.cbs.max_nodes) {
+            std::cout << "CBS_SOLVER >> Node limit reached" << std::endl;
+            break;
+        }
+        
+        if(anytime::expired()) {
+            std::cout << "CBS_SOLVER >> Out of time" << std::endl;
+            break;
+        }
+        
+        auto f_min = std::min_element(open.begin(), open.end(), [] (const auto& a, const auto& b) { return a->cost < b->cost; });
+        
+        lower_bound = std::min({(*f_min)->cost, cut_bound, upper_bound});
+        
+        if(best && upper_bound <= factor * lower_bound + 1e-6) {
+            break;
+        }
+        
+        // The focal list: the nodes within the suboptimality factor of the lower bound, fewest conflicts first; it is never empty,
+        // even when the lower bound comes from a cut-off node
+        auto threshold = std::max(factor * lower_bound, (*f_min)->cost) + 1e-6;
+        auto focal = bv<std::shared_ptr<const node>>();
+        auto rest = bv<std::shared_ptr<const node>>();
+        
+        for(auto& n : open) {
+            (n->cost <= threshold ? focal : rest).push_back(std::move(n));
+        }
+        
+        auto n_batch = std::min(static_cast<std::size_t>(std::max(1u, d.p.cbs.threads)), focal.size());
+        
+        std::partial_sort(focal.begin(), focal.begin() + n_batch, focal.end(), [] (const auto& a, const auto& b) {
+            return a->conflicts.size() < b->conflicts.size() || (a->conflicts.size() == b->conflicts.size() && a->cost < b->cost);
+        });
+        
+        if(focal.front()->conflicts.empty()) {
+            best = focal.front();
+            upper_bound = best->cost;
+            break;
+        }
+        
+        auto children = bv<std::shared_ptr<node>>();
+        
+        for(auto k = 0u; k < n_batch; k++) {
+            auto split = children_of(focal.at(k), cut_bound);
+            
+            children.insert(children.end(), split.begin(), split.end());
+        }
+        
+        n_expanded += static_cast<unsigned int>(n_batch);
+        open = std::move(rest);
+        open.insert(open.end(), focal.begin() + n_batch, focal.end());
+        
+        for(auto& child : replan_all(children)) {
+            if(child->conflicts.empty() && child->cost < upper_bound) {
+                best = child;
+                upper_bound = child->cost;
+                
+                std::cout << "CBS_SOLVER >> Schedule of cost " << upper_bound << " after " << n_expanded << " nodes" << std::endl;
+            }
+            
+            open.push_back(std::move(child));
+        }
+        
+        if(n_expanded % 100u < n_batch) {
+            std::cout << "CBS_SOLVER >> " << n_expanded << " nodes expanded, " << open.size() << " open: lower bound " << lower_bound << ", upper bound ";
+            
+            if(best) {
+                std::cout << upper_bound << std::endl;
+            } else {
+                std::cout << "none" << std::endl;
+            }
+        }
+    }
+    
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    
+    if(!best) {
+        std::cout << "CBS_SOLVER >> Lower bound: " << lower_bound << " - Could not find a schedule without conflicts" << std::endl;
+        print_results(boost::none, seconds);
+        return boost::none;
+    }
+    
+    std::cout << "CBS_SOLVER >> Lower bound: " << lower_bound << ", upper bound: " << upper_bound << ", nodes expanded: " << n_expanded << std::endl;
+    
+    auto paths = bv<path>();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        paths.push_back(path(d, i, best->paths.at(i), best->costs.at(i)));
+    }
+    
+    print_results(paths, seconds);
+    
+    return paths;
+}
+
+auto cbs_solver::children_of(const std::shared_ptr<const node>& n, double& cut_bound) const -> bv<std::shared_ptr<node>> {
+    using constraint = schedule_evaluator::constraint;
+    
+    const auto h = d.headway;
+    auto children = bv<std::shared_ptr<node>>();
+    
+    // Split on the earliest conflict the children can resolve
+    auto conflict = n->conflicts.end();
+    
+    for(auto it = n->conflicts.begin(); it != n->conflicts.end(); ++it) {
+        auto splittable = (it->kind == constraint::max_one_train || it->kind == constraint::headway || it->kind == constraint::siding || it->kind == constraint::heavy);
+        
+        if(splittable && (conflict == n->conflicts.end() || it->t < conflict->t)) {
+            conflict = it;
+        }
+    }
+    
+    if(conflict == n->conflicts.end()) {
+        // The paths violate constraints of a single train, which the graphs should never allow: give up the node, but not its bound
+        cut_bound = std::min(cut_bound, n->cost);
+        return children;
+    }
+    
+    auto child = [&] (bv<restriction> restrictions) {
+        auto c = std::make_shared<node>();
+        
+        c->parent = n;
+        c->restrictions = std::move(restrictions);
+        c->paths = n->paths;
+        c->costs = n->costs;
+        children.push_back(c);
+    };
+    
+    const auto& c = *conflict;
+    auto from = (c.t > h ? c.t - h : 0u);
+    
+    switch(c.kind) {
+        case constraint::max_one_train:
+        case constraint::headway:
+            // Train c.train enters c.seg at c.t while c.other is in it, or was less than one headway before
+            child({{c.train, c.seg, c.t, c.t, true}});
+            child({{c.other, c.seg, from, c.t, false}});
+            break;
+        
+        case constraint::heavy: {
+            auto main_tracks = bv<restriction>();
+            
+            for(auto mm : d.net.main_tracks.at(c.seg)) {
+                main_tracks.push_back({c.other, mm, std::max(1u, from), std::min(c.t + h, d.ni + 1u), false});
+            }
+            
+            child({{c.train, c.seg, c.t, c.t, true}});
+            child(main_tracks);
+            break;
+        }
+        
+        default:
+            // Nobody is on the main tracks: the schedules in which some other train goes there instead are cut off
+            cut_bound = std::min(cut_bound, n->cost);
+            child({{c.train, c.seg, c.t, c.t, true}});
+            break;
+    }
+    
+    return children;
+}
+
+auto cbs_solver::replan(node& n) const -> bool {
+    const auto i = n.restrictions.front().train;
+    auto dp = train_dp(d, i, layers.at(i));
+    
+    for(auto m = static_cast<const node*>(&n); m != nullptr; m = m->parent.get()) {
+        for(const auto& r : m->restrictions) {
+            if(r.train != i) {
+                continue;
+            }
+            
+            for(auto t = r.from; t <= std::min(r.to, d.ni + 1u); t++) {
+                (r.entry_only ? dp.can_enter : dp.can_be_at).at(r.seg).at(t) = false;
+            }
+        }
+    }
+    
+    auto p = dp.solve();
+    
+    if(!p) {
+        return false;
+    }
+    
+    n.paths.at(i) = *p;
+    n.costs.at(i) = dp.priced_cost;
+    n.cost = std::accumulate(n.costs.begin(), n.costs.end(), 0.0);
+    n.conflicts = evaluator.evaluate(n.paths).violations;
+    
+    return true;
+}
+
+auto cbs_solver::print_results(const boost::optional<bv<path>>& paths, double seconds) const -> void {
+    auto row = results::row("cbs", d, d.p.cbs.threads);
+    auto bound = [] (double value) { return (std::abs(value) < std::numeric_limits<double>::max() ? value : std::numeric_limits<double>::quiet_NaN()); };
+    
+    row.add("nodes_expanded", n_expanded)
+       .add("suboptimality", d.p.cbs.suboptimality)
+       .add("time_total", seconds)
+       .add("lower_bound", bound(lower_bound))
+       .add("upper_bound", bound(upper_bound));
+    
+    // Without a solution the objective columns are still written, as missing values, so that all the rows have the same columns
+    if(paths) {
+        auto evaluation = evaluator.evaluate(*paths);
+        
+        row.add(evaluation.objective).add("violations", evaluation.violations.size());
+    } else {
+        auto objective = path::cost_breakdown();
+        
+        objective.delay = objective.terminal = objective.sa = objective.unpreferred = std::numeric_limits<double>::quiet_NaN();
+        row.add(objective).add("violations", std::numeric_limits<double>::quiet_NaN());
+    }
+    
+    row.add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+}
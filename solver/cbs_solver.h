@@ -0,0 +1,98 @@
+#ifndef CBS_SOLVER_H
+#define CBS_SOLVER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <data/schedule_evaluator.h>
+#include <solver/train_dp.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+
+/*! \brief This class schedules all the trains by conflict-based search, without the MIP solver. Each node of the constraint tree
+ *  gives each train a list of restrictions, and the path of each train is the cheapest one in its own graph which respects them,
+ *  found with train_dp; the cost of a node is then a lower bound on the cost of any schedule respecting its restrictions. When the
+ *  paths of a node conflict, the node is split in two: if train j enters segment s at time t less than one headway after train i
+ *  was in s (this covers both max_one_train and the headways), either j cannot enter s at t, or i cannot be in s from t - headway
+ *  to t; if a heavy train i enters a siding at t while a non-SA train j is on its main tracks, either i cannot enter it at t, or j
+ *  cannot be on the main tracks from t - headway to t + headway.
+ *  A train entering a siding when no other train is on its main tracks is simply forbidden to enter it at that time, which may
+ *  cut off some schedules; the cost of the node split this way is kept as a lower bound, so that the bound stays valid.
+ *  Nodes are chosen by focal search: among the nodes whose cost is within the given suboptimality factor of the lower bound, the
+ *  one with the fewest conflicts is expanded first, so that, if no schedule was cut off, the schedule found costs at most the
+ *  factor times the optimum; either way the lower bound reported is valid, and so is the gap to it. Several
+ *  nodes are expanded at the same time, and their children's paths are found in parallel.
+ */
+struct cbs_solver {
+    /*! \brief A restriction on the path of one train */
+    struct restriction {
+        /*! The train */
+        unsigned int train;
+        
+        /*! The segment */
+        unsigned int seg;
+        
+        /*! First time interval restricted */
+        unsigned int from;
+        
+        /*! Last time interval restricted */
+        unsigned int to;
+        
+        /*! If true, the train cannot enter the segment during [from, to]; otherwise, it cannot be in the segment at all */
+        bool entry_only;
+    };
+    
+    /*! \brief A node of the constraint tree */
+    struct node {
+        /*! The node it was split from, which holds the older restrictions, or nullptr for the root */
+        std::shared_ptr<const node> parent;
+        
+        /*! The restrictions added by this node, all on the same train */
+        bv<restriction> restrictions;
+        
+        /*! Indexed over tr, succession of nodes visited by the train */
+        bv<bv<path::node>> paths;
+        
+        /*! Indexed over tr, cost of the train's path */
+        double_vector costs;
+        
+        /*! Sum of the costs of the trains' paths */
+        double cost;
+        
+        /*! The conflicts between the paths */
+        bv<schedule_evaluator::violation> conflicts;
+    };
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Best lower bound proven */
+    double lower_bound;
+    
+    /*! Cost of the best schedule without conflicts found */
+    double upper_bound;
+    
+    /*! Number of nodes expanded */
+    unsigned int n_expanded;
+    
+    /*! Basic constructor */
+    cbs_solver(const data& d);
+    
+    /*! Runs the search and returns the schedule found, or boost::none if none was found within the node and time limits */
+    auto solve() -> boost::optional<bv<path>>;
+
+private:
+    
+    /*! Indexed over tr, layers of the train's graph, built once and shared by all the nodes */
+    bv<std::shared_ptr<const train_dp::layered_graph>> layers;
+    
+    schedule_evaluator evaluator;
+    
+    auto children_of(const std::shared_ptr<const node>& n, double& cut_bound) const -> bv<std::shared_ptr<node>>;
+    auto replan(node& n) const -> bool;
+    auto print_results(const boost::optional<bv<path>>& paths, double seconds) const -> void;
+};
+
+#endif
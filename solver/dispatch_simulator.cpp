@@ -0,0 +1,761 @@
+#include <solver/dispatch_simulator.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+#include <data/occupancy.h>
+#include <data/schedule_evaluator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+auto dispatch_simulator::priority_class(const data& d) -> dispatch_rule {
+    return [&d] (const request& a, const request& b) {
+        return std::make_tuple(d.trn.type.at(a.train), a.ready, a.train) < std::make_tuple(d.trn.type.at(b.train), b.ready, b.train);
+    };
+}
+
+auto dispatch_simulator::first_come(const data&) -> dispatch_rule {
+    return [] (const request& a, const request& b) {
+        return std::make_pair(a.ready, a.train) < std::make_pair(b.ready, b.train);
+    };
+}
+
+auto dispatch_simulator::earliest_want_time(const data& d) -> dispatch_rule {
+    return [&d] (const request& a, const request& b) {
+        return std::make_tuple(d.trn.want_time.at(a.train), a.ready, a.train) < std::make_tuple(d.trn.want_time.at(b.train), b.ready, b.train);
+    };
+}
+
+auto dispatch_simulator::rule_named(const data& d, const std::string& name) -> boost::optional<dispatch_rule> {
+    if(name == "priority") {
+        return priority_class(d);
+    } else if(name == "first_come") {
+        return first_come(d);
+    } else if(name == "want_time") {
+        return earliest_want_time(d);
+    }
+    
+    return boost::none;
+}
+
+dispatch_simulator::dispatch_simulator(const data& d) : d{d} {
+    n_events = 0u;
+    next = uint_matrix_3d(2u, uint_matrix_2d(d.ns + 2));
+    sidings_of = uint_matrix_2d(d.ns + 2);
+    
+    for(auto s1 = 1u; s1 <= d.ns; s1++) {
+        for(auto s2 = 1u; s2 <= d.ns; s2++) {
+            if(d.seg.e_ext.at(s1) == d.seg.w_ext.at(s2)) {
+                next.at(0u).at(s1).push_back(s2);
+            }
+            
+            if(d.seg.w_ext.at(s1) == d.seg.e_ext.at(s2)) {
+                next.at(1u).at(s1).push_back(s2);
+            }
+        }
+    }
+    
+    for(auto sd : d.net.sidings) {
+        for(auto mm : d.net.main_tracks.at(sd)) {
+            sidings_of.at(mm).push_back(sd);
+        }
+    }
+    
+    // Sidings with their main tracks, and stretches of double track with their cross-overs, are loops: the places where trains
+    // can meet or pass. Each loop is named after its smallest segment.
+    auto double_track = [&] (unsigned int s) {
+        return d.seg.type.at(s) == '1' || d.seg.type.at(s) == '2' || d.seg.type.at(s) == 'X';
+    };
+    
+    auto same_loop = [&] (unsigned int s1, unsigned int s2) {
+        const auto& m1 = d.net.main_tracks.at(s1);
+        const auto& m2 = d.net.main_tracks.at(s2);
+        
+        return  std::find(m1.begin(), m1.end(), s2) != m1.end() ||
+                std::find(m2.begin(), m2.end(), s1) != m2.end() ||
+                (double_track(s1) && double_track(s2) && d.net.connected.at(s1).at(s2));
+    };
+    
+    loop_of = uint_vector(d.ns + 2, 0u);
+    loop_tracks = uint_vector(d.ns + 2, 0u);
+    loop_mains = uint_vector(d.ns + 2, 0u);
+    
+    for(auto s1 = 1u; s1 <= d.ns; s1++) {
+        for(auto s2 = 1u; s2 <= d.ns; s2++) {
+            if(same_loop(s1, s2)) {
+                loop_of.at(s1) = s1;
+            }
+        }
+    }
+    
+    for(auto changed = true; changed; ) {
+        changed = false;
+        
+        for(auto s1 = 1u; s1 <= d.ns; s1++) {
+            for(auto s2 = 1u; s2 <= d.ns; s2++) {
+                if(loop_of.at(s1) != loop_of.at(s2) && same_loop(s1, s2)) {
+                    loop_of.at(s1) = loop_of.at(s2) = std::min(loop_of.at(s1), loop_of.at(s2));
+                    changed = true;
+                }
+            }
+        }
+    }
+    
+    // A loop has a track for each siding and each main track next to it, and two main tracks if it is a stretch of double track
+    for(auto loop = 1u; loop <= d.ns; loop++) {
+        auto sidings = 0u;
+        auto mains = 0u;
+        auto has_track = std::set<char>();
+        
+        for(auto s = 1u; s <= d.ns; s++) {
+            if(loop_of.at(s) != loop) {
+                continue;
+            }
+            
+            if(d.seg.type.at(s) == 'S') {
+                sidings++;
+            } else if(d.seg.type.at(s) == '0') {
+                mains++;
+            } else if(d.seg.type.at(s) != 'X') {
+                has_track.insert(d.seg.type.at(s));
+            }
+        }
+        
+        loop_mains.at(loop) = mains + static_cast<unsigned int>(has_track.size());
+        loop_tracks.at(loop) = loop_mains.at(loop) + sidings;
+    }
+    
+    // Cross-overs alone are no place to wait in
+    for(auto s = 1u; s <= d.ns; s++) {
+        if(loop_of.at(s) != 0u && loop_tracks.at(loop_of.at(s)) == 0u) {
+            loop_of.at(s) = 0u;
+        }
+    }
+    
+    // Trains in loops right next to each other can only get out of each other's way as in the narrowest of them: they are one
+    // loop
+    for(auto changed = true; changed; ) {
+        changed = false;
+        
+        for(auto s1 = 1u; s1 <= d.ns; s1++) {
+            for(auto s2 = 1u; s2 <= d.ns; s2++) {
+                const auto l1 = loop_of.at(s1);
+                const auto l2 = loop_of.at(s2);
+                
+                if(l1 == 0u || l2 == 0u || l1 == l2 || !d.net.connected.at(s1).at(s2)) {
+                    continue;
+                }
+                
+                const auto loop = std::min(l1, l2);
+                
+                loop_tracks.at(loop) = std::min(loop_tracks.at(l1), loop_tracks.at(l2));
+                loop_mains.at(loop) = std::min(loop_mains.at(l1), loop_mains.at(l2));
+                
+                for(auto& l : loop_of) {
+                    if(l == l1 || l == l2) {
+                        l = loop;
+                    }
+                }
+                
+                changed = true;
+            }
+        }
+    }
+    
+    mow_from = uint_matrix_2d(d.ns + 2, uint_vector(d.ni + 2, d.ni + 2));
+    
+    for(auto s = 0u; s <= d.ns + 1; s++) {
+        for(auto t = d.ni + 2; t-- > 0u; ) {
+            if(d.mnt.is_mow.at(s).at(t)) {
+                mow_from.at(s).at(t) = t;
+            } else if(t <= d.ni) {
+                mow_from.at(s).at(t) = mow_from.at(s).at(t + 1u);
+            }
+        }
+    }
+}
+
+auto dispatch_simulator::solve() -> boost::optional<bv<path>> {
+    auto t_start = std::chrono::steady_clock::now();
+    auto names = bv<std::string>({d.p.dispatch_simulator.rule});
+    auto evaluator = schedule_evaluator(d);
+    auto best = boost::optional<bv<path>>();
+    auto best_cost = std::numeric_limits<double>::max();
+    auto best_rule = d.p.dispatch_simulator.rule;
+    
+    if(d.p.dispatch_simulator.rule == "all") {
+        names = {"priority", "first_come", "want_time"};
+    }
+    
+    for(const auto& name : names) {
+        // A simulation is fast, so the rules are only cut short once there is a schedule to return
+        if(best && anytime::expired()) {
+            std::cout << "DISPATCH_SIMULATOR >> Out of time: skipping rule " << name << std::endl;
+            continue;
+        }
+        
+        auto rule = rule_named(d, name);
+        
+        if(!rule) {
+            std::cerr << "DISPATCH_SIMULATOR >> Unknown dispatch rule: " << name << std::endl;
+            return boost::none;
+        }
+        
+        auto t_rule = std::chrono::steady_clock::now();
+        auto paths = simulate(*rule);
+        auto microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_rule).count();
+        
+        if(!paths) {
+            std::cout << "DISPATCH_SIMULATOR >> Rule " << name << ": no schedule" << std::endl;
+            continue;
+        }
+        
+        auto evaluation = evaluator.evaluate(*paths);
+        auto cost = evaluation.objective.total();
+        
+        std::cout << "DISPATCH_SIMULATOR >> Rule " << name << ": cost " << cost << ", " << n_events << " events in " << microseconds << " microseconds" << std::endl;
+        
+        if(!evaluation.is_feasible()) {
+            std::cout << "DISPATCH_SIMULATOR >> The schedule violates some constraints" << std::endl;
+            evaluation.print_summary(std::cout);
+            continue;
+        }
+        
+        if(cost < best_cost) {
+            best = paths;
+            best_cost = cost;
+            best_rule = name;
+        }
+    }
+    
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    
+    if(best) {
+        std::cout << "DISPATCH_SIMULATOR >> Best rule: " << best_rule << ", cost: " << best_cost << std::endl;
+    } else {
+        std::cout << "DISPATCH_SIMULATOR >> Could not find a schedule respecting all the constraints" << std::endl;
+    }
+    
+    print_results(best_rule, best, seconds);
+    
+    return best;
+}
+
+auto dispatch_simulator::simulate(const dispatch_rule& rule) -> boost::optional<bv<path>> {
+    profiler::span phase("dispatch/simulate");
+    
+    const auto no_train = occupancy::no_train;
+    const auto tau = d.ns + 1u;
+    
+    occupant = uint_vector(d.ns + 2, no_train);
+    last_time = uint_vector(d.ns + 2, 0u);
+    last_train = uint_vector(d.ns + 2, no_train);
+    reserved = uint_matrix_2d(d.ns + 2, uint_vector(2u, 0u));
+    held = uint_matrix_2d(d.nt);
+    heavy_time = uint_vector(d.ns + 2, 0u);
+    heavy_train = uint_vector(d.ns + 2, no_train);
+    heading = uint_vector(d.nt, 0u);
+    nodes = bv<bv<path::node>>(d.nt);
+    n_events = 0u;
+    
+    // Indexed over tr, the segment the train is in and the first time it was ready to leave it
+    auto seg_of = uint_vector(d.nt, 0u);
+    auto ready = uint_vector(d.nt, 0u);
+    
+    // Events are (time, train), earliest first
+    using event = std::pair<unsigned int, unsigned int>;
+    auto events = std::priority_queue<event, std::vector<event>, std::greater<event>>();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        ready.at(i) = std::max(1u, d.trn.entry_time.at(i));
+        events.push({ready.at(i), i});
+    }
+    
+    while(!events.empty()) {
+        const auto t = events.top().first;
+        auto batch = bv<request>();
+        
+        while(!events.empty() && events.top().first == t) {
+            auto i = events.top().second;
+            
+            events.pop();
+            batch.push_back({i, seg_of.at(i), ready.at(i)});
+        }
+        
+        n_events += static_cast<unsigned int>(batch.size());
+        
+        // Out of time: the trains in the network leave it, as through the escape arcs of their graphs
+        if(t > d.ni) {
+            for(const auto& r : batch) {
+                if(r.seg == 0u) {
+                    std::cout << "DISPATCH_SIMULATOR >> Train " << r.train << " could not enter the network" << std::endl;
+                    return boost::none;
+                }
+                
+                move(r.train, r.seg, tau, d.ni + 1u);
+            }
+            
+            continue;
+        }
+        
+        // Trains leaving the network free their segments for the others, so they go first
+        std::sort(batch.begin(), batch.end(), rule);
+        std::stable_partition(batch.begin(), batch.end(), [&] (const request& r) { return r.seg != 0u && is_destination(r.train, r.seg); });
+        
+        for(const auto& r : batch) {
+            const auto i = r.train;
+            
+            if(r.seg != 0u && is_destination(i, r.seg)) {
+                move(i, r.seg, tau, t);
+                continue;
+            }
+            
+            auto moved = false;
+            
+            // A train running straight into a MOW could be stuck in a segment when a MOW starts there, and so could a train which
+            // would have to wait in a loop where a MOW starts soon: it waits where it is instead
+            auto next_segs = candidates(i, r.seg);
+            
+            auto stuck_in = [&] (unsigned int s) {
+                if(mow_ahead(i, s, t)) {
+                    return true;
+                }
+                
+                if(!mow_soon(i, s, t)) {
+                    return false;
+                }
+                
+                auto after = candidates(i, s);
+                auto at = t + d.net.min_travel_time.at(i).at(s);
+                
+                return !is_destination(i, s) && std::none_of(after.begin(), after.end(), [&] (unsigned int s2) { return can_enter(i, s2, at); });
+            };
+            
+            next_segs.erase(std::remove_if(next_segs.begin(), next_segs.end(), stuck_in), next_segs.end());
+            
+            for(auto s : next_segs) {
+                if(!can_enter(i, s, t)) {
+                    continue;
+                }
+                
+                // A train cannot stop on a cross-over: it only enters one if it can go on as soon as it has run through it
+                auto to = s;
+                auto at = t;
+                
+                if(d.seg.type.at(s) == 'X') {
+                    auto beyond = candidates(i, s);
+                    
+                    at = t + d.net.min_travel_time.at(i).at(s);
+                    
+                    auto it = std::find_if(beyond.begin(), beyond.end(), [&] (unsigned int s2) { return d.seg.type.at(s2) != 'X' && can_enter(i, s2, at) && !mow_ahead(i, s2, at); });
+                    
+                    if(it == beyond.end()) {
+                        continue;
+                    }
+                    
+                    to = *it;
+                    move(i, r.seg, s, t);
+                }
+                
+                move(i, (to == s ? r.seg : s), to, at);
+                seg_of.at(i) = to;
+                ready.at(i) = at + d.net.min_travel_time.at(i).at(to);
+                events.push({ready.at(i), i});
+                moved = true;
+                break;
+            }
+            
+            if(!moved) {
+                if(r.seg == 0u && d.trn.has_fixed_entry.at(i)) {
+                    std::cout << "DISPATCH_SIMULATOR >> Train " << i << " could not enter the network at its entry time" << std::endl;
+                    return boost::none;
+                }
+                
+                events.push({t + 1u, i});
+            }
+        }
+    }
+    
+    auto paths = bv<path>();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        paths.push_back(path(d, i, nodes.at(i), path::breakdown_of(d, i, nodes.at(i)).total()));
+    }
+    
+    return paths;
+}
+
+auto dispatch_simulator::usable(unsigned int i, unsigned int s) const -> bool {
+    if(s == 0u || s > d.ns) {
+        return false;
+    }
+    
+    if(d.seg.type.at(s) == 'S' && (d.trn.is_hazmat.at(i) || d.trn.length.at(i) > d.seg.original_length.at(s))) {
+        return false;
+    }
+    
+    return d.net.min_time_to_arrive.at(i).at(s) != std::numeric_limits<unsigned int>::max();
+}
+
+auto dispatch_simulator::passing(unsigned int i, unsigned int s) const -> bool {
+    if(d.seg.type.at(s) == 'S') {
+        return usable(i, s);
+    }
+    
+    return std::any_of(sidings_of.at(s).begin(), sidings_of.at(s).end(), [&] (unsigned int sd) { return usable(i, sd); });
+}
+
+auto dispatch_simulator::is_destination(unsigned int i, unsigned int s) const -> bool {
+    const auto& dest = d.trn.dest_segs.at(i);
+    
+    return std::find(dest.begin(), dest.end(), s) != dest.end();
+}
+
+auto dispatch_simulator::candidates(unsigned int i, unsigned int s) const -> uint_vector {
+    auto list = uint_vector();
+    
+    for(auto s2 : (s == 0u ? d.trn.orig_segs.at(i) : next.at(direction(i)).at(s))) {
+        if(usable(i, s2)) {
+            list.push_back(s2);
+        }
+    }
+    
+    // Preferred tracks first, then main tracks before sidings and cross-overs
+    auto key = [&] (unsigned int s) {
+        return std::make_tuple(d.net.unpreferred.at(i).at(s), d.seg.type.at(s) == 'S', d.seg.type.at(s) == 'X');
+    };
+    
+    std::stable_sort(list.begin(), list.end(), [&] (unsigned int s1, unsigned int s2) { return key(s1) < key(s2); });
+    
+    return list;
+}
+
+auto dispatch_simulator::section_of(unsigned int i, unsigned int s) const -> uint_vector {
+    auto section = uint_vector();
+    
+    // A siding, or the main tracks next to a siding, are where trains can meet: the train reserves them all together
+    if(d.seg.type.at(s) == 'S') {
+        section.push_back(s);
+        return section;
+    }
+    
+    if(passing(i, s)) {
+        for(auto sd : sidings_of.at(s)) {
+            for(auto mm : d.net.main_tracks.at(sd)) {
+                if(std::find(section.begin(), section.end(), mm) == section.end()) {
+                    section.push_back(mm);
+                }
+            }
+        }
+        
+        return section;
+    }
+    
+    // Otherwise, the train reserves the track up to the first place where it could meet another train
+    for(auto x = s; std::find(section.begin(), section.end(), x) == section.end(); ) {
+        section.push_back(x);
+        
+        if(is_destination(i, x)) {
+            break;
+        }
+        
+        auto after = candidates(i, x);
+        
+        if(after.size() != 1u || passing(i, after.front())) {
+            break;
+        }
+        
+        x = after.front();
+    }
+    
+    return section;
+}
+
+auto dispatch_simulator::in_loop(unsigned int i, unsigned int loop) const -> bool {
+    return !nodes.at(i).empty() && loop_of.at(nodes.at(i).back().seg) == loop;
+}
+
+auto dispatch_simulator::target_loop(unsigned int i, unsigned int s) const -> unsigned int {
+    const auto own = loop_of.at(s);
+    const auto section = section_of(i, s);
+    auto single = (own == 0u);
+    
+    // A train in a loop, which did not reserve any single track out of it, can still wait there
+    if(own != 0u && std::all_of(section.begin(), section.end(), [&] (unsigned int x) { return loop_of.at(x) == own; })) {
+        return 0u;
+    }
+    
+    // Follows the track from s, within its own loop and along the single track after it, up to the next loop: a loop right
+    // next to the train's own one is no target, as the train does not have to run on a single track to get there
+    for(auto x = s, n = 0u; n <= d.ns && !is_destination(i, x); n++) {
+        auto after = candidates(i, x);
+        auto it = std::find_if(after.begin(), after.end(), [&] (unsigned int s2) { return loop_of.at(s2) != 0u && loop_of.at(s2) != own; });
+        
+        if(it != after.end()) {
+            return single ? loop_of.at(*it) : 0u;
+        }
+        
+        if(after.size() != 1u) {
+            return 0u;
+        }
+        
+        x = after.front();
+        
+        if(loop_of.at(x) == 0u) {
+            single = true;
+        }
+    }
+    
+    return 0u;
+}
+
+auto dispatch_simulator::needs_main(unsigned int i, unsigned int loop) const -> bool {
+    if(d.trn.is_heavy.at(i)) {
+        return true;
+    }
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        if(loop_of.at(s) == loop && d.seg.type.at(s) == 'S' && usable(i, s)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+auto dispatch_simulator::has_room(unsigned int i, unsigned int loop) const -> bool {
+    const auto tracks = loop_tracks.at(loop);
+    
+    // Heavy trains, and trains fitting in none of the sidings, can only wait on the main tracks
+    auto trains = 1u;
+    auto same_way = 1u;
+    auto on_mains = (needs_main(i, loop) ? 1u : 0u);
+    
+    for(auto j = 0u; j < d.nt; j++) {
+        if(j != i && (heading.at(j) == loop || in_loop(j, loop))) {
+            trains++;
+            
+            if(direction(j) == direction(i)) {
+                same_way++;
+            }
+            
+            if(needs_main(j, loop) || (in_loop(j, loop) && d.seg.type.at(nodes.at(j).back().seg) != 'S')) {
+                on_mains++;
+            }
+        }
+    }
+    
+    // Trains running the same way leave a track free for the trains coming the other way
+    return trains <= tracks && on_mains <= loop_mains.at(loop) && same_way <= std::max(1u, tracks - 1u);
+}
+
+auto dispatch_simulator::leaves_main_for(unsigned int i, unsigned int s) const -> bool {
+    const auto loop = loop_of.at(s);
+    
+    if(loop == 0u || d.seg.type.at(s) == 'S' || needs_main(i, loop)) {
+        return true;
+    }
+    
+    // A train which could wait in a siding must not take the last free main track from a train coming the other way, which can
+    // only wait there
+    auto free_mains = 0u;
+    auto waiting = 0u;
+    
+    for(auto x = 1u; x <= d.ns; x++) {
+        if(loop_of.at(x) == loop && d.seg.type.at(x) != 'S' && d.seg.type.at(x) != 'X' && occupant.at(x) == occupancy::no_train) {
+            free_mains++;
+        }
+    }
+    
+    for(auto j = 0u; j < d.nt; j++) {
+        if(direction(j) != direction(i) && heading.at(j) == loop && needs_main(j, loop) && !in_loop(j, loop)) {
+            waiting++;
+        }
+    }
+    
+    return waiting < free_mains;
+}
+
+auto dispatch_simulator::mow_ahead(unsigned int i, unsigned int s, unsigned int t) const -> bool {
+    auto at = t;
+    
+    // Follows the track from s as long as there is only one way to go on, running at minimum travel time
+    for(auto x = s, n = 0u; n <= d.ns; n++) {
+        auto leave = std::min(at + d.net.min_travel_time.at(i).at(x) - 1u, d.ni + 1u);
+        
+        for(auto tt = at; tt <= leave; tt++) {
+            if(d.mnt.is_mow.at(x).at(tt)) {
+                return true;
+            }
+        }
+        
+        auto after = candidates(i, x);
+        
+        if(is_destination(i, x) || after.size() != 1u || leave > d.ni) {
+            return false;
+        }
+        
+        at = leave + 1u;
+        x = after.front();
+    }
+    
+    return false;
+}
+
+auto dispatch_simulator::mow_soon(unsigned int i, unsigned int s, unsigned int t) const -> bool {
+    if(loop_of.at(s) == 0u) {
+        return false;
+    }
+    
+    const auto leave = t + d.net.min_travel_time.at(i).at(s) - 1u;
+    
+    return mow_from.at(s).at(t) <= std::min(leave + d.p.dispatch_simulator.mow_lookahead, d.ni + 1u);
+}
+
+auto dispatch_simulator::on_main_tracks(unsigned int i, unsigned int sd, unsigned int t, bool only_non_sa) const -> bool {
+    const auto no_train = occupancy::no_train;
+    
+    auto counts = [&] (unsigned int j) {
+        return j != no_train && j != i && !(only_non_sa && d.trn.is_sa.at(j));
+    };
+    
+    for(auto mm : d.net.main_tracks.at(sd)) {
+        if(counts(occupant.at(mm)) || (counts(last_train.at(mm)) && last_time.at(mm) + d.headway >= t)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+auto dispatch_simulator::can_enter(unsigned int i, unsigned int s, unsigned int t) const -> bool {
+    const auto no_train = occupancy::no_train;
+    const auto h = d.headway;
+    auto leave = t + d.net.min_travel_time.at(i).at(s) - 1u;
+    
+    if(t < d.net.min_time_to_arrive.at(i).at(s) || leave > d.ni) {
+        return false;
+    }
+    
+    // One train at a time, one headway apart
+    if(occupant.at(s) != no_train || (last_train.at(s) != no_train && t <= last_time.at(s) + h)) {
+        return false;
+    }
+    
+    for(auto tt = t; tt <= leave; tt++) {
+        if(d.mnt.is_mow.at(s).at(tt)) {
+            return false;
+        }
+    }
+    
+    const auto opposite = 1u - direction(i);
+    const auto section = section_of(i, s);
+    
+    if(std::any_of(section.begin(), section.end(), [&] (unsigned int x) { return reserved.at(x).at(opposite) > 0u; })) {
+        return false;
+    }
+    
+    // Nor can it enter, or head into, a loop which is already full: it could neither cross nor wait for the trains in there
+    for(auto loop : {loop_of.at(s), target_loop(i, s)}) {
+        if(loop != 0u && loop != heading.at(i) && !in_loop(i, loop) && !has_room(i, loop)) {
+            return false;
+        }
+    }
+    
+    if(!leaves_main_for(i, s)) {
+        return false;
+    }
+    
+    if(d.seg.type.at(s) == 'S') {
+        if(!on_main_tracks(i, s, t, false) || (d.trn.is_heavy.at(i) && on_main_tracks(i, s, t, true))) {
+            return false;
+        }
+    }
+    
+    // A non-SA train cannot run on the main tracks of a siding around the time a heavy train enters it
+    if(!d.trn.is_sa.at(i)) {
+        for(auto sd : sidings_of.at(s)) {
+            if(heavy_train.at(sd) != no_train && heavy_train.at(sd) != i && heavy_time.at(sd) + h >= t) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+auto dispatch_simulator::move(unsigned int i, unsigned int from, unsigned int s, unsigned int t) -> void {
+    const auto dir = direction(i);
+    const auto tau = d.ns + 1u;
+    auto section = (s == tau ? uint_vector() : section_of(i, s));
+    
+    if(from == 0u) {
+        nodes.at(i).push_back(path::node(0u, t - 1u));
+    } else {
+        occupant.at(from) = occupancy::no_train;
+        last_time.at(from) = t - 1u;
+        last_train.at(from) = i;
+    }
+    
+    for(auto x : held.at(i)) {
+        if(std::find(section.begin(), section.end(), x) == section.end()) {
+            reserved.at(x).at(dir)--;
+        }
+    }
+    
+    for(auto x : section) {
+        if(std::find(held.at(i).begin(), held.at(i).end(), x) == held.at(i).end()) {
+            reserved.at(x).at(dir)++;
+        }
+    }
+    
+    held.at(i) = section;
+    nodes.at(i).push_back(path::node(s, t));
+    
+    if(s == tau) {
+        heading.at(i) = 0u;
+        return;
+    }
+    
+    heading.at(i) = target_loop(i, s);
+    
+    occupant.at(s) = i;
+    
+    if(d.seg.type.at(s) == 'S' && d.trn.is_heavy.at(i)) {
+        heavy_train.at(s) = i;
+        heavy_time.at(s) = t;
+    }
+}
+
+auto dispatch_simulator::print_results(const std::string& rule, const boost::optional<bv<path>>& paths, double seconds) const -> void {
+    auto row = results::row("dispatch_simulator", d, 1u);
+    
+    row.add("rule", rule)
+       .add("events", n_events)
+       .add("time_total", seconds);
+    
+    // Without a solution the objective columns are still written, as missing values, so that all the rows have the same columns
+    if(paths) {
+        auto evaluation = schedule_evaluator(d).evaluate(*paths);
+        
+        row.add("upper_bound", evaluation.objective.total()).add(evaluation.objective).add("violations", evaluation.violations.size());
+    } else {
+        auto objective = path::cost_breakdown();
+        
+        objective.delay = objective.terminal = objective.sa = objective.unpreferred = std::numeric_limits<double>::quiet_NaN();
+        row.add("upper_bound", std::numeric_limits<double>::quiet_NaN()).add(objective).add("violations", std::numeric_limits<double>::quiet_NaN());
+    }
+    
+    row.add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+}
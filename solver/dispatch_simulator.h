@@ -0,0 +1,137 @@
+#ifndef DISPATCH_SIMULATOR_H
+#define DISPATCH_SIMULATOR_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+
+#include <boost/optional.hpp>
+
+#include <functional>
+#include <string>
+
+/*! \brief This class schedules the trains by simulating them, without the time-expanded graph: it is a discrete-event simulation
+ *  in which every event is a train ready to leave its segment. A train runs through each segment in its minimum travel time and
+ *  then moves to the next one in its running direction, preferring its preferred tracks and the main tracks over the sidings; if
+ *  it cannot, it waits and tries again one time interval later. When several trains are ready at the same time, a dispatch rule
+ *  decides which one moves first. A train can only be in a segment its graph would have a vertex for (no siding for HAZMAT trains
+ *  or trains longer than the siding, no MOW, not before its minimum arrival time), it respects the headway, it only enters a siding
+ *  while another train runs on its main tracks and, if heavy, while no non-SA train does; it never stops on a cross-over, so it
+ *  only enters one if it can go on right after it. To avoid deadlocks, a train entering a stretch of single track reserves it up
+ *  to the next place it could meet another train, and no train running the other way can enter a reserved segment. The sidings
+ *  with their main tracks, and the double tracks, form loops: a train only enters, or heads into, a loop with room for it, and
+ *  the trains running the same way leave a track free for those coming the other way. A train does not run into a MOW it could
+ *  not wait for, nor stop in a loop segment where a MOW starts soon if it could not go on from there.
+ */
+struct dispatch_simulator {
+    /*! \brief A train ready to leave its segment */
+    struct request {
+        /*! The train */
+        unsigned int train;
+        
+        /*! The segment it is in, 0 if it has not entered the network yet */
+        unsigned int seg;
+        
+        /*! The first time the train was ready to move on */
+        unsigned int ready;
+    };
+    
+    /*! A dispatch rule: tells wether the first request must be served before the second one */
+    using dispatch_rule = std::function<bool(const request&, const request&)>;
+    
+    /*! The train of the best class goes first; within the same class, the one waiting since longer */
+    static auto priority_class(const data& d) -> dispatch_rule;
+    
+    /*! The train waiting since longer goes first */
+    static auto first_come(const data& d) -> dispatch_rule;
+    
+    /*! The train with the earliest want time at its destination goes first */
+    static auto earliest_want_time(const data& d) -> dispatch_rule;
+    
+    /*! The rule with the given name: "priority", "first_come" or "want_time" */
+    static auto rule_named(const data& d, const std::string& name) -> boost::optional<dispatch_rule>;
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Number of events processed by the last simulation */
+    unsigned int n_events;
+    
+    /*! Basic constructor */
+    dispatch_simulator(const data& d);
+    
+    /*! Simulates the trains with the given dispatch rule and returns their paths, or boost::none if some train could not enter the
+     *  network in time */
+    auto simulate(const dispatch_rule& rule) -> boost::optional<bv<path>>;
+    
+    /*! Simulates the trains with the rule given in the params, or with each rule if it is "all", and returns the cheapest schedule
+     *  respecting all the constraints, or boost::none if there is none */
+    auto solve() -> boost::optional<bv<path>>;
+
+private:
+    
+    /*! Indexed over (dir, s), segments following s for trains running eastbound (dir 0) or westbound (dir 1); for sigma, empty */
+    uint_matrix_3d next;
+    
+    /*! Indexed over s, if s is a main track, is the list of sidings s is a main track of */
+    uint_matrix_2d sidings_of;
+    
+    /*! Indexed over s, the loop the segment belongs to (named after its smallest segment), 0 if it is on a single track */
+    uint_vector loop_of;
+    
+    /*! Indexed over loop, number of trains the loop can hold side by side */
+    uint_vector loop_tracks;
+    
+    /*! Indexed over loop, how many of them can be on the main tracks */
+    uint_vector loop_mains;
+    
+    /*! Indexed over s, the train in the segment, or occupancy::no_train */
+    uint_vector occupant;
+    
+    /*! Indexed over s, the last time a train which left the segment was in it */
+    uint_vector last_time;
+    
+    /*! Indexed over s, the last train which left the segment, or occupancy::no_train */
+    uint_vector last_train;
+    
+    /*! Indexed over (s, dir), number of trains running in the direction which reserved the segment */
+    uint_matrix_2d reserved;
+    
+    /*! Indexed over tr, the segments the train reserved */
+    uint_matrix_2d held;
+    
+    /*! Indexed over s, if s is a siding, the time the last heavy train entered it */
+    uint_vector heavy_time;
+    
+    /*! Indexed over s, if s is a siding, the last heavy train which entered it, or occupancy::no_train */
+    uint_vector heavy_train;
+    
+    /*! Indexed over (s, t), the first time interval from t on in which the segment is under MOW, or ni + 2 if there is none */
+    uint_matrix_2d mow_from;
+    
+    /*! Indexed over tr, the next loop the train runs towards, 0 if none */
+    uint_vector heading;
+    
+    /*! Indexed over tr, succession of nodes visited by the train so far */
+    bv<bv<path::node>> nodes;
+    
+    auto direction(unsigned int i) const -> unsigned int { return d.trn.is_eastbound.at(i) ? 0u : 1u; }
+    auto usable(unsigned int i, unsigned int s) const -> bool;
+    auto passing(unsigned int i, unsigned int s) const -> bool;
+    auto is_destination(unsigned int i, unsigned int s) const -> bool;
+    auto candidates(unsigned int i, unsigned int s) const -> uint_vector;
+    auto section_of(unsigned int i, unsigned int s) const -> uint_vector;
+    auto in_loop(unsigned int i, unsigned int loop) const -> bool;
+    auto target_loop(unsigned int i, unsigned int s) const -> unsigned int;
+    auto needs_main(unsigned int i, unsigned int loop) const -> bool;
+    auto has_room(unsigned int i, unsigned int loop) const -> bool;
+    auto leaves_main_for(unsigned int i, unsigned int s) const -> bool;
+    auto mow_ahead(unsigned int i, unsigned int s, unsigned int t) const -> bool;
+    auto mow_soon(unsigned int i, unsigned int s, unsigned int t) const -> bool;
+    auto on_main_tracks(unsigned int i, unsigned int sd, unsigned int t, bool only_non_sa) const -> bool;
+    auto can_enter(unsigned int i, unsigned int s, unsigned int t) const -> bool;
+    auto move(unsigned int i, unsigned int from, unsigned int s, unsigned int t) -> void;
+    auto print_results(const std::string& rule, const boost::optional<bv<path>>& paths, double seconds) const -> void;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include <solver/dp_kernel.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+    const bool dp_kernel::vectorised = true;
+#else
+    const bool dp_kernel::vectorised = false;
+#endif
+
+auto dp_kernel::gather_arcs(const double* from_cost, const int* from, const double* arc_cost, double* out, unsigned int n) -> void {
+    auto k = 0u;
+    
+    #if defined(__AVX2__)
+        // The masked gather, with all lanes enabled, does not read an undefined source register as the plain one does
+        const auto all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        
+        for(; k + 4u <= n; k += 4u) {
+            auto index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + k));
+            auto tail_cost = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), from_cost, index, all_lanes, 8);
+            auto cost = _mm256_add_pd(tail_cost, _mm256_loadu_pd(arc_cost + k));
+            
+            _mm256_storeu_pd(out + k, cost);
+        }
+    #endif
+    
+    for(; k < n; k++) {
+        out[k] = from_cost[from[k]] + arc_cost[k];
+    }
+}
+
+auto dp_kernel::relax_layer(const double* prev, const double* stay, const double* move, const unsigned int* move_pred, double* best, unsigned int* pred, unsigned int n) -> void {
+    auto s = 0u;
+    
+    #if defined(__AVX2__)
+        for(; s + 4u <= n; s += 4u) {
+            auto stop_cost = _mm256_add_pd(_mm256_loadu_pd(prev + s), _mm256_loadu_pd(stay + s));
+            auto move_cost = _mm256_loadu_pd(move + s);
+            auto mask = _mm256_movemask_pd(_mm256_cmp_pd(move_cost, stop_cost, _CMP_LT_OQ));
+            
+            _mm256_storeu_pd(best + s, _mm256_min_pd(move_cost, stop_cost));
+            
+            for(auto l = 0u; l < 4u; l++) {
+                pred[s + l] = ((mask >> l) & 1) ? move_pred[s + l] : s + l;
+            }
+        }
+    #endif
+    
+    for(; s < n; s++) {
+        auto stop_cost = prev[s] + stay[s];
+        
+        if(move[s] < stop_cost) {
+            best[s] = move[s];
+            pred[s] = move_pred[s];
+        } else {
+            best[s] = stop_cost;
+            pred[s] = s;
+        }
+    }
+}
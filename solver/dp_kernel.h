@@ -0,0 +1,23 @@
+#ifndef DP_KERNEL_H
+#define DP_KERNEL_H
+
+/*! \brief This class holds the inner loops of the single-train dynamic programming, which work on one time layer of the graph at a time.
+ *  A layer is a contiguous array of costs indexed over the segments, so the same operation is applied to all the segments at once.
+ *  When the compiler targets AVX2 (i.e. the project is configured with NEED_AVX2) four segments are processed per instruction;
+ *  otherwise the plain loops are used, and the compiler is free to vectorise them with whatever instruction set it targets.
+ *  Unreachable states cost +infinity, so that no loop needs to check for them.
+ */
+struct dp_kernel {
+    /*! True iff the AVX2 loops are compiled in */
+    static const bool vectorised;
+    
+    /*! For each k < n, out[k] = from_cost[from[k]] + arc_cost[k]: the cost of reaching the head of the k-th movement arc of a layer */
+    static auto gather_arcs(const double* from_cost, const int* from, const double* arc_cost, double* out, unsigned int n) -> void;
+    
+    /*! For each s < n, best[s] is the cheaper of staying in s, at cost prev[s] + stay[s], and of the movement ending in s, at cost
+     *  move[s]. pred[s] is s itself if staying is not more expensive, and move_pred[s] otherwise.
+     */
+    static auto relax_layer(const double* prev, const double* stay, const double* move, const unsigned int* move_pred, double* best, unsigned int* pred, unsigned int n) -> void;
+};
+
+#endif
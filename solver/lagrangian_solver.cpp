@@ -0,0 +1,471 @@
+#include <solver/lagrangian_solver.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+#include <solver/safe_interval_planner.h>
+#include <data/occupancy.h>
+#include <data/schedule_evaluator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Number of non-improving iterations after which the step size is halved
+    constexpr unsigned int max_not_improving = 10u;
+    
+    // Indexed over (s, t), is the sum of values[s][0], ..., values[s][t - 1]
+    auto prefix_sums(const double_matrix_2d& values) -> double_matrix_2d {
+        auto sums = double_matrix_2d(values.size());
+        
+        for(auto s = 0u; s < values.size(); s++) {
+            sums.at(s) = double_vector(values.at(s).size() + 1, 0.0);
+            
+            for(auto t = 0u; t < values.at(s).size(); t++) {
+                sums.at(s).at(t + 1) = sums.at(s).at(t) + values.at(s).at(t);
+            }
+        }
+        
+        return sums;
+    }
+    
+    // Sum of values[s][from], ..., values[s][to], given the prefix sums of values; the interval is clamped to the valid times
+    auto window_sum(const double_matrix_2d& sums, unsigned int s, int from, int to) -> double {
+        from = std::max(from, 0);
+        to = std::min(to, static_cast<int>(sums.at(s).size()) - 2);
+        
+        return (from <= to ? sums.at(s).at(to + 1) - sums.at(s).at(from) : 0.0);
+    }
+    
+    // Sum of all the entries of the matrix
+    auto total(const double_matrix_2d& values) -> double {
+        auto sum = 0.0;
+        
+        for(const auto& row : values) {
+            sum += std::accumulate(row.begin(), row.end(), 0.0);
+        }
+        
+        return sum;
+    }
+}
+
+lagrangian_solver::multipliers::multipliers(const data& d) {
+    max_one_train = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    headway_1 = max_one_train;
+    headway_2 = max_one_train;
+    headway_3 = max_one_train;
+    siding = double_matrix_3d(d.nt, double_matrix_2d(d.ns + 2));
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        for(auto s : d.net.sidings) {
+            siding.at(i).at(s) = double_vector(d.ni + 2, 0.0);
+        }
+    }
+}
+
+lagrangian_solver::lagrangian_solver(const data& d) : d{d} {
+    lower_bound = -std::numeric_limits<double>::max();
+    upper_bound = std::numeric_limits<double>::max();
+    sidings_of = uint_matrix_2d(d.ns + 2);
+    
+    for(auto sd : d.net.sidings) {
+        for(auto mm : d.net.main_tracks.at(sd)) {
+            sidings_of.at(mm).push_back(sd);
+        }
+    }
+}
+
+auto lagrangian_solver::solve() -> boost::optional<bv<path>> {
+    auto mu = multipliers(d);
+    auto step = d.p.lagrangian.step;
+    auto n_not_improving = 0u;
+    auto best = boost::optional<schedule>();
+    auto n_iterations = 0u;
+    auto t_start = std::chrono::steady_clock::now();
+    
+    {
+        profiler::span phase("lagrangian/layers");
+        
+        layers.clear();
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            layers.push_back(std::make_shared<const train_dp::layered_graph>(d, i));
+        }
+    }
+    
+    for(auto it = 0u; it < d.p.lagrangian.iterations; it++) {
+        profiler::span iteration("lagrangian/iteration");
+        
+        n_iterations = it + 1u;
+        
+        auto relaxed = solve_subproblems(mu);
+        
+        if(!relaxed) {
+            std::cout << "LAGRANGIAN_SOLVER >> Some train has no feasible path!" << std::endl;
+            return boost::none;
+        }
+        
+        // The max_one_train and headway constraints have right-hand side 1, the siding ones 0
+        auto bound = std::accumulate(relaxed->priced_costs.begin(), relaxed->priced_costs.end(), 0.0) -
+            total(mu.max_one_train) - total(mu.headway_1) - total(mu.headway_2) - total(mu.headway_3);
+        
+        if(bound > lower_bound + 1e-9) {
+            lower_bound = bound;
+            n_not_improving = 0u;
+        } else if(++n_not_improving >= max_not_improving) {
+            step /= 2;
+            n_not_improving = 0u;
+        }
+        
+        // When the time is over, a last repair is attempted if there is no solution yet
+        auto out_of_time = anytime::expired();
+        
+        if(d.p.lagrangian.repair_every > 0u && (it % d.p.lagrangian.repair_every == 0u || (out_of_time && !best))) {
+            // Trains paying the highest prices for their conflicts are scheduled first
+            auto order = uint_vector(d.nt);
+            std::iota(order.begin(), order.end(), 0u);
+            std::stable_sort(order.begin(), order.end(), [&] (unsigned int i, unsigned int j) {
+                return relaxed->priced_costs.at(i) - relaxed->costs.at(i) > relaxed->priced_costs.at(j) - relaxed->costs.at(j);
+            });
+            
+            auto repaired = repair(order);
+            
+            if(repaired) {
+                auto cost = std::accumulate(repaired->costs.begin(), repaired->costs.end(), 0.0);
+                
+                if(cost < upper_bound) {
+                    upper_bound = cost;
+                    best = repaired;
+                    anytime::offer(make_paths(*best));
+                }
+            }
+        }
+        
+        std::cout << "LAGRANGIAN_SOLVER >> Iteration " << it << ": lower bound " << lower_bound << ", upper bound ";
+        if(best) {
+            std::cout << upper_bound << ", gap " << 100 * (upper_bound - lower_bound) / std::max(1.0, std::abs(upper_bound)) << "%" << std::endl;
+        } else {
+            std::cout << "none" << std::endl;
+        }
+        
+        if(best && upper_bound - lower_bound <= 1e-6 * std::max(1.0, std::abs(upper_bound))) {
+            break;
+        }
+        
+        if(out_of_time) {
+            std::cout << "LAGRANGIAN_SOLVER >> Out of time" << std::endl;
+            break;
+        }
+        
+        auto g = subgradient(*relaxed);
+        auto norm = 0.0;
+        
+        // Components which would be projected back to zero do not contribute to the step
+        auto add_to_norm = [&] (const double_matrix_2d& lambda, const double_matrix_2d& gamma) {
+            for(auto s = 0u; s < lambda.size(); s++) {
+                for(auto t = 0u; t < lambda.at(s).size(); t++) {
+                    if(lambda.at(s).at(t) > 0 || gamma.at(s).at(t) > 0) {
+                        norm += gamma.at(s).at(t) * gamma.at(s).at(t);
+                    }
+                }
+            }
+        };
+        
+        add_to_norm(mu.max_one_train, g.max_one_train);
+        add_to_norm(mu.headway_1, g.headway_1);
+        add_to_norm(mu.headway_2, g.headway_2);
+        add_to_norm(mu.headway_3, g.headway_3);
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            add_to_norm(mu.siding.at(i), g.siding.at(i));
+        }
+        
+        if(norm < 1e-12) {
+            std::cout << "LAGRANGIAN_SOLVER >> The multipliers cannot be improved any further" << std::endl;
+            break;
+        }
+        
+        // Polyak step size, aiming at the best known solution or, if there is none, slightly above the current bound
+        auto target = (best ? upper_bound : bound + std::max(1.0, 0.1 * std::abs(bound)));
+        auto size = step * std::max(target - bound, 1e-6) / norm;
+        
+        auto update = [&] (double_matrix_2d& lambda, const double_matrix_2d& gamma) {
+            for(auto s = 0u; s < lambda.size(); s++) {
+                for(auto t = 0u; t < lambda.at(s).size(); t++) {
+                    lambda.at(s).at(t) = std::max(0.0, lambda.at(s).at(t) + size * gamma.at(s).at(t));
+                }
+            }
+        };
+        
+        update(mu.max_one_train, g.max_one_train);
+        update(mu.headway_1, g.headway_1);
+        update(mu.headway_2, g.headway_2);
+        update(mu.headway_3, g.headway_3);
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            update(mu.siding.at(i), g.siding.at(i));
+        }
+    }
+    
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    
+    if(!best) {
+        std::cout << "LAGRANGIAN_SOLVER >> Lower bound: " << lower_bound << " - Could not find a feasible solution" << std::endl;
+        print_results(boost::none, n_iterations, seconds);
+        return boost::none;
+    }
+    
+    std::cout << "LAGRANGIAN_SOLVER >> Lower bound: " << lower_bound << ", upper bound: " << upper_bound << std::endl;
+    
+    auto paths = make_paths(*best);
+    auto evaluation = schedule_evaluator(d).evaluate(paths);
+    
+    if(!evaluation.is_feasible()) {
+        std::cout << "LAGRANGIAN_SOLVER >> The repaired schedule violates some constraints!" << std::endl;
+        evaluation.print_summary(std::cout);
+    }
+    
+    print_results(paths, n_iterations, seconds);
+    
+    return paths;
+}
+
+auto lagrangian_solver::print_results(const boost::optional<bv<path>>& paths, unsigned int n_iterations, double seconds) const -> void {
+    auto row = results::row("lagrangian", d, d.p.lagrangian.threads);
+    auto bound = [] (double value) { return (std::abs(value) < std::numeric_limits<double>::max() ? value : std::numeric_limits<double>::quiet_NaN()); };
+    
+    row.add("iterations", n_iterations)
+       .add("time_total", seconds)
+       .add("lower_bound", bound(lower_bound))
+       .add("upper_bound", bound(upper_bound));
+    
+    // Without a solution the objective columns are still written, as missing values, so that all the rows have the same columns
+    if(paths) {
+        auto evaluation = schedule_evaluator(d).evaluate(*paths);
+        
+        row.add(evaluation.objective).add("violations", evaluation.violations.size());
+    } else {
+        auto objective = path::cost_breakdown();
+        
+        objective.delay = objective.terminal = objective.sa = objective.unpreferred = std::numeric_limits<double>::quiet_NaN();
+        row.add(objective).add("violations", std::numeric_limits<double>::quiet_NaN());
+    }
+    
+    row.add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+}
+
+auto lagrangian_solver::make_paths(const schedule& sol) const -> bv<path> {
+    auto paths = bv<path>();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        paths.push_back(path(d, i, sol.nodes.at(i), sol.costs.at(i)));
+    }
+    
+    return paths;
+}
+
+auto lagrangian_solver::solve_subproblems(const multipliers& mu) const -> boost::optional<schedule> {
+    profiler::span phase("lagrangian/subproblems");
+    
+    auto h = static_cast<int>(d.headway);
+    auto h1_sums = prefix_sums(mu.headway_1);
+    auto h2_sums = prefix_sums(mu.headway_2);
+    auto h3_sums = prefix_sums(mu.headway_3);
+    
+    // Prices which are the same for all the trains
+    auto entry_price = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    auto exit_price = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 1u; t <= d.ni; t++) {
+            auto it = static_cast<int>(t);
+            
+            entry_price.at(s).at(t) = window_sum(h1_sums, s, it, it + h) + mu.headway_2.at(s).at(t) + window_sum(h3_sums, s, it - h, it - 1);
+            exit_price.at(s).at(t) = mu.headway_3.at(s).at(t) + window_sum(h2_sums, s, it + 1, it + h);
+        }
+    }
+    
+    // Indexed over (s, t), if s is a siding, is the sum of the siding multipliers of all the trains at the times within one
+    // headway from t: a train on a main track of s at time t helps all of them, except its own
+    auto siding_total = double_matrix_2d(d.ns + 2);
+    
+    for(auto sd : d.net.sidings) {
+        siding_total.at(sd) = double_vector(d.ni + 2, 0.0);
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            for(auto t = 0u; t <= d.ni + 1; t++) {
+                siding_total.at(sd).at(t) += mu.siding.at(i).at(sd).at(t);
+            }
+        }
+    }
+    
+    auto siding_total_sums = prefix_sums(siding_total);
+    auto sol = schedule(d.nt);
+    std::atomic<unsigned int> next(0u);
+    std::atomic<bool> feasible(true);
+    
+    auto worker = [&] () {
+        for(auto i = next++; i < d.nt; i = next++) {
+            auto dp = train_dp(d, i, layers.at(i));
+            auto own_sums = prefix_sums(mu.siding.at(i));
+            
+            dp.occupancy_price = mu.max_one_train;
+            dp.entry_price = entry_price;
+            dp.exit_price = exit_price;
+            
+            for(auto mm = 1u; mm <= d.ns; mm++) {
+                for(auto sd : sidings_of.at(mm)) {
+                    for(auto t = 1u; t <= d.ni; t++) {
+                        auto it = static_cast<int>(t);
+                        
+                        dp.occupancy_price.at(mm).at(t) -= window_sum(siding_total_sums, sd, it - h, it + h) - window_sum(own_sums, sd, it - h, it + h);
+                    }
+                }
+            }
+            
+            for(auto sd : d.net.sidings) {
+                for(auto t = 1u; t <= d.ni; t++) {
+                    dp.entry_price.at(sd).at(t) += mu.siding.at(i).at(sd).at(t);
+                }
+            }
+            
+            auto p = dp.solve();
+            
+            if(!p) {
+                feasible = false;
+                continue;
+            }
+            
+            sol.nodes.at(i) = *p;
+            sol.costs.at(i) = dp.cost_of(*p);
+            sol.priced_costs.at(i) = dp.priced_cost;
+        }
+    };
+    
+    auto n_threads = std::max(1u, std::min(d.p.lagrangian.threads, d.nt));
+    auto threads = std::vector<std::thread>();
+    
+    for(auto n = 0u; n < n_threads; n++) {
+        threads.emplace_back(worker);
+    }
+    
+    for(auto& t : threads) {
+        t.join();
+    }
+    
+    if(!feasible) {
+        return boost::none;
+    }
+    
+    return sol;
+}
+
+auto lagrangian_solver::subgradient(const schedule& relaxed) const -> multipliers {
+    auto h = static_cast<int>(d.headway);
+    auto g = multipliers(d);
+    
+    // Indexed over (s, t), number of trains in s at time t, entering s at time t, and leaving s at time t
+    auto occupied = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    auto entering = occupied;
+    auto leaving = occupied;
+    
+    // Indexed over (tr, s, t), if s is a siding, number of time intervals train tr spends at time t on the main tracks of s
+    auto main_occupied = double_matrix_3d(d.nt, double_matrix_2d(d.ns + 2));
+    auto all_main_occupied = double_matrix_2d(d.ns + 2);
+    
+    for(auto sd : d.net.sidings) {
+        all_main_occupied.at(sd) = double_vector(d.ni + 2, 0.0);
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            main_occupied.at(i).at(sd) = double_vector(d.ni + 2, 0.0);
+        }
+    }
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        const auto& p = relaxed.nodes.at(i);
+        
+        for(auto k = 1u; k + 1 < p.size(); k++) {
+            auto s = p.at(k).seg;
+            
+            entering.at(s).at(p.at(k).t) += 1;
+            leaving.at(s).at(p.at(k + 1).t - 1) += 1;
+            
+            for(auto t = p.at(k).t; t < p.at(k + 1).t; t++) {
+                occupied.at(s).at(t) += 1;
+                
+                for(auto sd : sidings_of.at(s)) {
+                    main_occupied.at(i).at(sd).at(t) += 1;
+                    all_main_occupied.at(sd).at(t) += 1;
+                }
+            }
+        }
+    }
+    
+    auto entering_sums = prefix_sums(entering);
+    auto leaving_sums = prefix_sums(leaving);
+    auto all_main_sums = prefix_sums(all_main_occupied);
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 1u; t <= d.ni; t++) {
+            auto it = static_cast<int>(t);
+            
+            g.max_one_train.at(s).at(t) = occupied.at(s).at(t) - 1;
+            g.headway_1.at(s).at(t) = window_sum(entering_sums, s, it - h, it) - 1;
+            g.headway_2.at(s).at(t) = entering.at(s).at(t) + window_sum(leaving_sums, s, it - h, it - 1) - 1;
+            g.headway_3.at(s).at(t) = leaving.at(s).at(t) + window_sum(entering_sums, s, it + 1, it + h) - 1;
+        }
+    }
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        auto own_sums = prefix_sums(main_occupied.at(i));
+        const auto& p = relaxed.nodes.at(i);
+        
+        for(auto sd : d.net.sidings) {
+            for(auto t = 1u; t <= d.ni; t++) {
+                auto it = static_cast<int>(t);
+                
+                g.siding.at(i).at(sd).at(t) = window_sum(own_sums, sd, it - h, it + h) - window_sum(all_main_sums, sd, it - h, it + h);
+            }
+        }
+        
+        for(auto k = 1u; k + 1 < p.size(); k++) {
+            if(d.seg.type.at(p.at(k).seg) == 'S') {
+                g.siding.at(i).at(p.at(k).seg).at(p.at(k).t) += 1;
+            }
+        }
+    }
+    
+    return g;
+}
+
+auto lagrangian_solver::repair(const uint_vector& order) const -> boost::optional<schedule> {
+    profiler::span phase("lagrangian/repair");
+    
+    auto occ = occupancy(d);
+    auto sol = schedule(d.nt);
+    
+    for(auto i : order) {
+        auto planner = safe_interval_planner(d, i, occ);
+        auto p = planner.plan();
+        
+        if(!p) {
+            std::cout << "LAGRANGIAN_SOLVER >> Repair heuristic: could not schedule train " << i << std::endl;
+            return boost::none;
+        }
+        
+        occ.reserve(i, *p);
+        sol.nodes.at(i) = *p;
+        sol.costs.at(i) = planner.cost;
+        sol.priced_costs.at(i) = planner.cost;
+    }
+    
+    return sol;
+}
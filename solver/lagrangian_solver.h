@@ -0,0 +1,89 @@
+#ifndef LAGRANGIAN_SOLVER_H
+#define LAGRANGIAN_SOLVER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <solver/train_dp.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+
+/*! \brief This class solves the lagrangian relaxation of the constraints linking the trains in the MIP model (max_one_train,
+ *  headway 1, 2 and 3, and siding) with subgradient optimisation. Once they are relaxed, each train's subproblem is a shortest path
+ *  in its own graph, and the subproblems are solved in parallel. The heavy constraints are simply dropped, which keeps the bound
+ *  valid. Every few iterations, a repair heuristic schedules the trains one at a time, in the order suggested by the multipliers,
+ *  without conflicts with the trains already scheduled.
+ */
+struct lagrangian_solver {
+    /*! \brief This class contains the lagrangian multipliers, one for each relaxed constraint */
+    struct multipliers {
+        /*! Indexed over (s, t), multipliers of the max_one_train constraints */
+        double_matrix_2d max_one_train;
+        
+        /*! Indexed over (s, t), multipliers of the headway_1 constraints */
+        double_matrix_2d headway_1;
+        
+        /*! Indexed over (s, t), multipliers of the headway_2 constraints */
+        double_matrix_2d headway_2;
+        
+        /*! Indexed over (s, t), multipliers of the headway_3 constraints */
+        double_matrix_2d headway_3;
+        
+        /*! Indexed over (tr, s, t), multipliers of the siding constraints: the vector over t is empty when s is not a siding */
+        double_matrix_3d siding;
+        
+        /*! Empty constructor */
+        multipliers() {}
+        
+        /*! Basic constructor: all multipliers are 0 */
+        multipliers(const data& d);
+    };
+    
+    /*! \brief This class contains the paths of all the trains, and their costs */
+    struct schedule {
+        /*! Indexed over tr, succession of nodes visited by the train */
+        bv<bv<path::node>> nodes;
+        
+        /*! Indexed over tr, cost of the train's path */
+        double_vector costs;
+        
+        /*! Indexed over tr, cost of the train's path including the multipliers */
+        double_vector priced_costs;
+        
+        /*! Basic constructor */
+        schedule(unsigned int nt) : nodes(nt), costs(nt, 0.0), priced_costs(nt, 0.0) {}
+    };
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Best lower bound found */
+    double lower_bound;
+    
+    /*! Cost of the best solution found by the repair heuristic */
+    double upper_bound;
+    
+    /*! Indexed over s, if s is a main track, is the list of sidings s is a main track of */
+    uint_matrix_2d sidings_of;
+    
+    /*! Indexed over tr, layers of the train's graph, built once and shared by the subproblems of all iterations */
+    bv<std::shared_ptr<const train_dp::layered_graph>> layers;
+    
+    /*! Basic constructor */
+    lagrangian_solver(const data& d);
+    
+    /*! Run the subgradient optimisation and return the best paths found by the repair heuristic, or boost::none if it never succeeded */
+    auto solve() -> boost::optional<bv<path>>;
+
+private:
+    
+    auto solve_subproblems(const multipliers& mu) const -> boost::optional<schedule>;
+    auto subgradient(const schedule& relaxed) const -> multipliers;
+    auto repair(const uint_vector& order) const -> boost::optional<schedule>;
+    auto make_paths(const schedule& sol) const -> bv<path>;
+    auto print_results(const boost::optional<bv<path>>& paths, unsigned int n_iterations, double seconds) const -> void;
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include <solver/lns_solver.h>
+#include <data/incremental_evaluator.h>
+#include <data/schedule_evaluator.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+#include <solver/sequential_solver.h>
+#include <solver/solver.h>
+
+#if USE_GRAPHER
+    #include <grapher/grapher.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+auto lns_solver::improve(bv<path> paths) const -> bv<path> {
+    assert(paths.size() == d.nt);
+    
+    auto t_start = std::chrono::steady_clock::now();
+    auto busy = bool_vector(d.nt, false);
+    std::mutex incumbent_mutex;
+    std::atomic<unsigned int> next(0u);
+    
+    // Keeps the cost and the segment timelines of the incumbent, to price and check a repaired neighbourhood before accepting it
+    auto evaluator = incremental_evaluator(d, paths);
+    auto initial_cost = evaluator.cost();
+    
+    // Replaces the paths of the trains one at a time, after unscheduling all of them, and returns the conflicts it finds
+    auto replace = [&] (const uint_vector& trains, const bv<path>& source) {
+        auto conflicts = bv<incremental_evaluator::violation>();
+        
+        for(auto i : trains) {
+            evaluator.apply(evaluator.evaluate(i, bv<path::node>()));
+        }
+        
+        for(auto i : trains) {
+            auto change = evaluator.evaluate(i, source.at(i).p);
+            
+            conflicts.insert(conflicts.end(), change.conflicts.begin(), change.conflicts.end());
+            evaluator.apply(change);
+        }
+        
+        return conflicts;
+    };
+    
+    // Neighbourhoods repaired at the same time never share a train. The paths around a neighbourhood can change while it is
+    // repaired, so the repaired paths are checked against the current incumbent: they only replace it if they conflict with none
+    // of its paths, i.e. whenever the other workers changed trains they do not interfere with
+    auto worker = [&] () {
+        for(auto it = next++; it < d.p.lns.iterations && !anytime::expired(); it = next++) {
+            auto mt = std::mt19937(d.p.lns.seed + it);
+            auto trains = uint_vector();
+            auto snapshot = bv<path>();
+            
+            {
+                std::lock_guard<std::mutex> lock(incumbent_mutex);
+                
+                trains = choose_neighbourhood(it, mt, paths, busy);
+                
+                if(trains.empty()) {
+                    continue;
+                }
+                
+                for(auto i : trains) {
+                    busy.at(i) = true;
+                }
+                
+                snapshot = paths;
+            }
+            
+            auto repaired = repair(snapshot, trains);
+            
+            std::lock_guard<std::mutex> lock(incumbent_mutex);
+            
+            for(auto i : trains) {
+                busy.at(i) = false;
+            }
+            
+            if(!repaired) {
+                continue;
+            }
+            
+            auto old_scheduled = 0u;
+            auto new_scheduled = 0u;
+            auto old_cost = evaluator.cost();
+            
+            for(auto i : trains) {
+                old_scheduled += (paths.at(i).is_empty() || paths.at(i).is_dummy() ? 0u : 1u);
+                new_scheduled += (repaired->at(i).is_dummy() ? 0u : 1u);
+            }
+            
+            auto conflicts = replace(trains, *repaired);
+            auto new_cost = evaluator.cost();
+            
+            if(!conflicts.empty()) {
+                std::cout << "LNS_SOLVER >> Iteration " << it << ": the repaired paths violate " << conflicts.size() << " constraints" << std::endl;
+            }
+            
+            if(conflicts.empty() && (new_scheduled > old_scheduled || (new_scheduled == old_scheduled && new_cost < old_cost - 1e-6))) {
+                for(auto i : trains) {
+                    paths.at(i) = repaired->at(i);
+                }
+                
+                std::cout << "LNS_SOLVER >> Iteration " << it << ": rescheduling trains ";
+                std::copy(trains.begin(), trains.end(), std::ostream_iterator<unsigned int>(std::cout, " "));
+                std::cout << "improves the cost from " << old_cost << " to " << new_cost << std::endl;
+                
+                anytime::offer(paths);
+            } else {
+                replace(trains, paths);
+            }
+        }
+    };
+    
+    auto n_threads = std::max(1u, std::min(d.p.lns.threads, d.p.lns.iterations));
+    auto threads = std::vector<std::thread>();
+    
+    for(auto n = 0u; n < n_threads; n++) {
+        threads.emplace_back(worker);
+    }
+    
+    for(auto& t : threads) {
+        t.join();
+    }
+    
+    std::cout << "LNS_SOLVER >> Cost improved from " << initial_cost << " to " << evaluator.cost() << std::endl;
+    
+    auto evaluation = schedule_evaluator(d).evaluate(paths);
+    
+    if(!evaluation.is_feasible()) {
+        std::cout << "LNS_SOLVER >> The improved schedule violates some constraints!" << std::endl;
+        evaluation.print_summary(std::cout);
+    }
+    
+    print_results(paths, initial_cost, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    
+    return paths;
+}
+
+auto lns_solver::choose_neighbourhood(unsigned int iteration, std::mt19937& mt, const bv<path>& paths, const bool_vector& busy) const -> uint_vector {
+    auto candidates = uint_vector();
+    
+    // Alternate between the three kinds of neighbourhood: any trains, trains running at the same time, trains running in the same area
+    if(iteration % 3u == 1u) {
+        candidates = trains_in_time_slice(mt, paths);
+    } else if(iteration % 3u == 2u) {
+        candidates = trains_around_siding(mt, paths);
+    }
+    
+    if(candidates.empty()) {
+        candidates = uint_vector(d.nt);
+        std::iota(candidates.begin(), candidates.end(), 0u);
+    }
+    
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&] (unsigned int i) { return busy.at(i); }), candidates.end());
+    std::shuffle(candidates.begin(), candidates.end(), mt);
+    
+    if(candidates.size() > d.p.lns.neighbourhood_size) {
+        candidates.resize(d.p.lns.neighbourhood_size);
+    }
+    
+    std::sort(candidates.begin(), candidates.end());
+    
+    return candidates;
+}
+
+auto lns_solver::trains_in_time_slice(std::mt19937& mt, const bv<path>& paths) const -> uint_vector {
+    auto length = std::min(d.p.lns.time_slice, d.ni);
+    auto slice_start = std::uniform_int_distribution<unsigned int>(1u, d.ni - length + 1u)(mt);
+    auto slice_end = slice_start + length - 1u;
+    auto trains = uint_vector();
+    
+    for(const auto& p : paths) {
+        if(p.is_empty() || p.is_dummy()) {
+            continue;
+        }
+        
+        // The train is in the network from when it enters its first segment to when it reaches tau
+        if(p.p.at(1).t <= slice_end && p.p.back().t - 1u >= slice_start) {
+            trains.push_back(p.train);
+        }
+    }
+    
+    return trains;
+}
+
+auto lns_solver::trains_around_siding(std::mt19937& mt, const bv<path>& paths) const -> uint_vector {
+    if(d.net.sidings.empty()) {
+        return uint_vector();
+    }
+    
+    auto siding = d.net.sidings.at(std::uniform_int_distribution<std::size_t>(0u, d.net.sidings.size() - 1u)(mt));
+    
+    // The area is made of the siding, its main tracks, and any segment connected to them
+    auto area = bool_vector(d.ns + 2, false);
+    area.at(siding) = true;
+    
+    for(auto m : d.net.main_tracks.at(siding)) {
+        area.at(m) = true;
+    }
+    
+    auto core = area;
+    
+    for(auto s1 = 1u; s1 <= d.ns; s1++) {
+        for(auto s2 = 1u; s2 <= d.ns; s2++) {
+            if(core.at(s2) && d.net.connected.at(s1).at(s2)) {
+                area.at(s1) = true;
+            }
+        }
+    }
+    
+    auto trains = uint_vector();
+    
+    for(const auto& p : paths) {
+        if(p.is_empty() || p.is_dummy()) {
+            continue;
+        }
+        
+        if(std::any_of(p.p.begin(), p.p.end(), [&] (const path::node& n) { return area.at(n.seg); })) {
+            trains.push_back(p.train);
+        }
+    }
+    
+    return trains;
+}
+
+auto lns_solver::repair(const bv<path>& paths, const uint_vector& trains) const -> boost::optional<bv<path>> {
+    profiler::span phase("lns/repair");
+    
+    auto local_d = d;
+    auto partial = paths;
+    auto in_model = uint_vector();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        if(std::find(trains.begin(), trains.end(), i) != trains.end()) {
+            partial.at(i).make_empty();
+            in_model.push_back(i);
+        } else if(partial.at(i).is_empty()) {
+            partial.at(i).make_dummy();
+        } else if(!partial.at(i).is_dummy()) {
+            in_model.push_back(i);
+        }
+    }
+    
+    // Unscheduled trains outside the neighbourhood keep their dummy path, all other trains outside it keep their path
+    local_d.gr.only_trains(in_model, d.nt, d.ns, d.ni);
+    
+    auto seq = sequential_solver(d);
+    seq.constrain_graph_by_paths(local_d.gr, partial);
+    
+    // The repairs only return their paths: the results and the graph are written once, for the improved schedule
+    auto s = solver(local_d);
+    
+    s.quiet = true;
+    
+    auto repaired = s.solve();
+    
+    if(repaired) {
+        // The paths have a pointer to the dead local_d object, we replace it with a pointer to d
+        for(auto& p : *repaired) {
+            p.d = &d;
+        }
+    }
+    
+    return repaired;
+}
+
+auto lns_solver::print_results(const bv<path>& paths, double initial_cost, double seconds) const -> void {
+    auto evaluation = schedule_evaluator(d).evaluate(paths);
+    auto row = results::row("lns", d, d.p.lns.threads);
+    
+    row.add("time_total", seconds)
+       .add("initial_cost", initial_cost)
+       .add("upper_bound", evaluation.objective.total())
+       .add(evaluation.objective)
+       .add("violations", evaluation.violations.size())
+       .add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+    
+    #if USE_GRAPHER
+        profiler::span phase("grapher/write_graph");
+        
+        auto ger = grapher(d, paths);
+        ger.write_graph();
+    #endif
+}
@@ -0,0 +1,34 @@
+#ifndef LNS_SOLVER_H
+#define LNS_SOLVER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+
+#include <boost/optional.hpp>
+
+#include <random>
+
+/*! \brief This class improves a solution by large neighbourhood search: a few trains at a time are unscheduled and then rescheduled
+ *  with the MIP solver, while all the other trains keep their paths.
+ */
+struct lns_solver {
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Basic constructor */
+    lns_solver(const data& d) : d{d} {}
+    
+    /*! Improve the given paths, one for each train, and return the best paths found */
+    auto improve(bv<path> paths) const -> bv<path>;
+
+private:
+    
+    auto choose_neighbourhood(unsigned int iteration, std::mt19937& mt, const bv<path>& paths, const bool_vector& busy) const -> uint_vector;
+    auto trains_in_time_slice(std::mt19937& mt, const bv<path>& paths) const -> uint_vector;
+    auto trains_around_siding(std::mt19937& mt, const bv<path>& paths) const -> uint_vector;
+    auto repair(const bv<path>& paths, const uint_vector& trains) const -> boost::optional<bv<path>>;
+    auto print_results(const bv<path>& paths, double initial_cost, double seconds) const -> void;
+};
+
+#endif
@@ -0,0 +1,486 @@
+#include <solver/meet_pass_planner.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+#include <data/occupancy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+meet_pass_planner::meet_pass_planner(const data& d) : d{d} {
+    free_run_cost = 0.0;
+}
+
+auto meet_pass_planner::solve() -> boost::optional<bv<path>> {
+    auto t_start = std::chrono::steady_clock::now();
+    
+    {
+        profiler::span phase("meet_pass/free_runs");
+        
+        layers.clear();
+        free_runs = bv<bv<path::node>>(d.nt);
+        free_visits = bv<bv<visit>>(d.nt);
+        free_run_cost = 0.0;
+        
+        for(auto i = 0u; i < d.nt; i++) {
+            layers.push_back(std::make_shared<const train_dp::layered_graph>(d, i));
+            
+            auto dp = train_dp(d, i, layers.at(i));
+            auto p = dp.solve();
+            
+            if(!p) {
+                std::cout << "MEET_PASS_PLANNER >> Train " << i << " has no feasible path!" << std::endl;
+                return boost::none;
+            }
+            
+            // Skip sigma and tau: the train is in segment p[k].seg from time p[k].t to time p[k + 1].t - 1
+            for(auto k = 1u; k + 1u < p->size(); k++) {
+                free_visits.at(i).push_back({i, p->at(k).seg, p->at(k).t, p->at(k + 1u).t - 1u});
+            }
+            
+            free_runs.at(i) = *p;
+            free_run_cost += dp.priced_cost;
+        }
+    }
+    
+    auto windows = bv<conflict_window>();
+    
+    {
+        profiler::span phase("meet_pass/plan");
+        
+        windows = conflict_windows();
+        dispatch(windows);
+    }
+    
+    auto n_meets = std::count_if(plan.begin(), plan.end(), [] (const auto& a) { return a.is_meet; });
+    auto n_waits = std::count_if(plan.begin(), plan.end(), [] (const auto& a) { return a.siding == 0u; });
+    auto estimated_cost = std::accumulate(plan.begin(), plan.end(), 0.0, [] (double sum, const auto& a) { return sum + a.cost; });
+    
+    std::cout << "MEET_PASS_PLANNER >> " << windows.size() << " conflicts in the free runs: " << n_meets << " meets and " << (plan.size() - n_meets) << " passes planned, " << n_waits << " without a siding" << std::endl;
+    std::cout << "MEET_PASS_PLANNER >> Free runs cost " << free_run_cost << ", estimated cost of the plan " << free_run_cost + estimated_cost << std::endl;
+    
+    // Holding the trains in the planned sidings can cost more than letting them find their own way around the others, when the
+    // free runs are far from the polished paths: the cheaper of the two polishes is kept. A polish cut short by the deadline is
+    // only kept if no polish is complete
+    auto best = schedule(true, true);
+    auto free_best = schedule(false, false);
+    auto hold = true;
+    
+    auto better = [] (const polished& a, const polished& b) {
+        if(a.complete() != b.complete()) {
+            return a.complete();
+        }
+        
+        return a.n_placed > b.n_placed || (a.n_placed == b.n_placed && a.cost() < b.cost() - 1e-6);
+    };
+    
+    if(better(free_best, best)) {
+        if(free_best.complete()) {
+            std::cout << "MEET_PASS_PLANNER >> Polish: not holding the trains in the planned sidings is cheaper" << std::endl;
+        }
+        
+        best = free_best;
+        hold = false;
+    }
+    
+    // The dispatch rule decides on estimates from the free runs: the other train yields instead whenever that makes the polished
+    // schedule cheaper, one conflict at a time. The trains placed before both trains of the conflict keep their paths
+    if(best.complete()) {
+        profiler::span phase("meet_pass/flip");
+        
+        for(auto k = 0u; k < plan.size() && !anytime::expired(); k++) {
+            auto kept = plan.at(k);
+            
+            plan.at(k) = yield(kept.keeping, kept.yielding, windows.at(k));
+            
+            auto order = dispatch_order();
+            auto n_kept = 0u;
+            
+            while(n_kept < order.size() && order.at(n_kept) == best.order.at(n_kept) && order.at(n_kept) != kept.yielding && order.at(n_kept) != kept.keeping) {
+                n_kept++;
+            }
+            
+            auto flipped = polish(order, hold, best, n_kept);
+            
+            if(flipped.complete() && flipped.cost() < best.cost() - 1e-6) {
+                std::cout << "MEET_PASS_PLANNER >> Train " << kept.keeping << " yielding to train " << kept.yielding << " improves the cost from " << best.cost() << " to " << flipped.cost() << std::endl;
+                
+                best = flipped;
+            } else {
+                plan.at(k) = kept;
+            }
+        }
+    } else if(best.out_of_time) {
+        std::cout << "MEET_PASS_PLANNER >> Out of time: " << (d.nt - best.n_placed) << " trains not placed yet are not scheduled" << std::endl;
+    }
+    
+    auto paths = boost::optional<bv<path>>();
+    
+    if(best.complete() || best.out_of_time) {
+        paths = to_paths(best);
+    }
+    
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    
+    if(paths) {
+        std::cout << "MEET_PASS_PLANNER >> Lower bound: " << free_run_cost << ", upper bound: " << total_cost(*paths) << ", time: " << seconds << " seconds" << std::endl;
+    }
+    
+    print_results(paths, seconds);
+    
+    return paths;
+}
+
+auto meet_pass_planner::conflict_windows() const -> bv<conflict_window> {
+    using constraint = schedule_evaluator::constraint;
+    
+    // Indexed over the pairs of trains, smaller index first
+    auto by_pair = std::map<std::pair<unsigned int, unsigned int>, conflict_window>();
+    
+    for(const auto& v : schedule_evaluator(d).evaluate(free_runs).violations) {
+        if((v.kind != constraint::max_one_train && v.kind != constraint::headway) || v.other == occupancy::no_train) {
+            continue;
+        }
+        
+        auto key = std::make_pair(std::min(v.train, v.other), std::max(v.train, v.other));
+        auto it = by_pair.find(key);
+        
+        if(it == by_pair.end()) {
+            by_pair.emplace(key, conflict_window{v.train, v.other, v.seg, v.t, v.t, d.trn.is_eastbound.at(v.train) != d.trn.is_eastbound.at(v.other)});
+            continue;
+        }
+        
+        auto& w = it->second;
+        
+        if(v.t < w.from) {
+            w.train = v.train;
+            w.other = v.other;
+            w.seg = v.seg;
+            w.from = v.t;
+        }
+        
+        w.to = std::max(w.to, v.t);
+    }
+    
+    auto windows = bv<conflict_window>();
+    
+    for(const auto& pair : by_pair) {
+        windows.push_back(pair.second);
+    }
+    
+    std::sort(windows.begin(), windows.end(), [] (const auto& a, const auto& b) { return a.from < b.from; });
+    
+    return windows;
+}
+
+auto meet_pass_planner::best_siding(unsigned int yielding, unsigned int keeping, const conflict_window& w) const -> boost::optional<assignment> {
+    const auto h = d.headway;
+    const auto y = yielding;
+    auto best = boost::optional<assignment>();
+    
+    // A HAZMAT train never enters a siding, and a heavy train cannot enter one while a non-SA train runs on its main tracks
+    if(d.trn.is_hazmat.at(y) || (d.trn.is_heavy.at(y) && !d.trn.is_sa.at(keeping))) {
+        return best;
+    }
+    
+    // The visit of the train's free run to one of the main tracks of the siding
+    auto on_main_tracks = [&] (unsigned int train, unsigned int sd) {
+        const auto& visits = free_visits.at(train);
+        const auto& main_tracks = d.net.main_tracks.at(sd);
+        
+        return std::find_if(visits.begin(), visits.end(), [&] (const visit& v) {
+            return std::find(main_tracks.begin(), main_tracks.end(), v.seg) != main_tracks.end();
+        });
+    };
+    
+    for(auto sd : d.net.sidings) {
+        if(d.trn.length.at(y) > d.seg.original_length.at(sd) || d.net.min_time_to_arrive.at(y).at(sd) == std::numeric_limits<unsigned int>::max()) {
+            continue;
+        }
+        
+        auto yv = on_main_tracks(y, sd);
+        auto kv = on_main_tracks(keeping, sd);
+        
+        // Both free runs must go by the siding, and the yielding train must get there before the conflict, but not too long before
+        if(yv == free_visits.at(y).end() || kv == free_visits.at(keeping).end()) {
+            continue;
+        }
+        
+        if(yv->entry > w.from || w.from - yv->entry > d.p.meet_pass.lookahead || yv->entry > kv->entry) {
+            continue;
+        }
+        
+        // The train enters the siding when the other train is near enough to let it in, and leaves it one headway after the other
+        // train has left the main tracks
+        auto entry = std::max(yv->entry, kv->entry > h ? kv->entry - h : 0u);
+        auto leave = std::max(entry + d.net.min_travel_time.at(y).at(sd), kv->leave + h + 1u);
+        auto delay = (leave - 1u > yv->leave ? leave - 1u - yv->leave : 0u);
+        auto cost = delay * d.pri.delay.at(d.trn.type.at(y));
+        
+        if(!best || cost < best->cost) {
+            best = assignment{y, keeping, sd, leave - 1u, cost, w.is_meet};
+        }
+    }
+    
+    return best;
+}
+
+auto meet_pass_planner::dispatch(const bv<conflict_window>& windows) -> void {
+    plan.clear();
+    
+    for(const auto& w : windows) {
+        auto a = best_siding(w.train, w.other, w);
+        auto b = best_siding(w.other, w.train, w);
+        auto train_class = d.trn.type.at(w.train);
+        auto other_class = d.trn.type.at(w.other);
+        
+        // The train of the worse class yields, as long as it has a siding to wait in: 'A' is the best class
+        auto train_yields = true;
+        
+        if(a && b) {
+            train_yields = (train_class != other_class ? train_class > other_class : a->cost <= b->cost);
+        } else if(a || b) {
+            train_yields = static_cast<bool>(a);
+        } else if(train_class != other_class) {
+            train_yields = (train_class > other_class);
+        }
+        
+        plan.push_back(train_yields ? yield(w.train, w.other, w) : yield(w.other, w.train, w));
+    }
+}
+
+auto meet_pass_planner::yield(unsigned int yielding, unsigned int keeping, const conflict_window& w) const -> assignment {
+    if(auto a = best_siding(yielding, keeping, w)) {
+        return *a;
+    }
+    
+    // No siding: the yielding train waits until the other one has gone through the whole conflict window
+    auto cost = (w.to + d.headway + 1u - w.from) * d.pri.delay.at(d.trn.type.at(yielding));
+    
+    return {yielding, keeping, 0u, w.to + d.headway, cost, w.is_meet};
+}
+
+auto meet_pass_planner::dispatch_order() const -> uint_vector {
+    // Better class first, then earlier free-run entry
+    auto goes_before = [&] (unsigned int i, unsigned int j) {
+        auto ki = std::make_tuple(d.trn.type.at(i), free_runs.at(i).at(1).t, i);
+        auto kj = std::make_tuple(d.trn.type.at(j), free_runs.at(j).at(1).t, j);
+        
+        return ki < kj;
+    };
+    
+    // Indexed over tr, number of trains not yet ordered the train yields to
+    auto n_keeping = uint_vector(d.nt, 0u);
+    auto placed = bool_vector(d.nt, false);
+    auto order = uint_vector();
+    
+    for(const auto& a : plan) {
+        n_keeping.at(a.yielding)++;
+    }
+    
+    while(order.size() < d.nt) {
+        auto next = occupancy::no_train;
+        auto next_free = occupancy::no_train;
+        
+        // If the trains left yield to each other in a cycle, the best one goes first anyway
+        for(auto i = 0u; i < d.nt; i++) {
+            if(placed.at(i)) {
+                continue;
+            }
+            
+            if(next == occupancy::no_train || goes_before(i, next)) {
+                next = i;
+            }
+            
+            if(n_keeping.at(i) == 0u && (next_free == occupancy::no_train || goes_before(i, next_free))) {
+                next_free = i;
+            }
+        }
+        
+        if(next_free != occupancy::no_train) {
+            next = next_free;
+        }
+        
+        placed.at(next) = true;
+        order.push_back(next);
+        
+        for(const auto& a : plan) {
+            if(a.keeping == next && n_keeping.at(a.yielding) > 0u) {
+                n_keeping.at(a.yielding)--;
+            }
+        }
+    }
+    
+    return order;
+}
+
+auto meet_pass_planner::schedule(bool hold, bool verbose) const -> polished {
+    auto order = dispatch_order();
+    auto none = polished{uint_vector(), bv<bv<path::node>>(d.nt), double_vector(d.nt, 0.0), 0u, false};
+    auto result = polish(order, hold, none, 0u);
+    
+    // A train which cannot be placed around the trains before it goes first, and the polish starts over
+    for(auto attempt = 1u; attempt < d.nt && !result.complete() && !result.out_of_time; attempt++) {
+        auto stuck = order.at(result.n_placed);
+        
+        if(verbose) {
+            std::cout << "MEET_PASS_PLANNER >> Polish: could not place train " << stuck << " around the others, it goes first" << std::endl;
+        }
+        
+        order.erase(order.begin() + result.n_placed);
+        order.insert(order.begin(), stuck);
+        result = polish(order, hold, none, 0u);
+    }
+    
+    return result;
+}
+
+auto meet_pass_planner::polish(const uint_vector& order, bool hold, const polished& start, unsigned int n_kept) const -> polished {
+    profiler::span phase("meet_pass/polish");
+    
+    auto occ = occupancy(d);
+    auto result = polished{order, bv<bv<path::node>>(d.nt), double_vector(d.nt, 0.0), 0u, false};
+    
+    // The first n_kept trains of the order keep their paths from start
+    for(; result.n_placed < n_kept; result.n_placed++) {
+        auto i = order.at(result.n_placed);
+        
+        occ.reserve(i, start.nodes.at(i));
+        result.nodes.at(i) = start.nodes.at(i);
+        result.costs.at(i) = start.costs.at(i);
+    }
+    
+    for(; result.n_placed < order.size(); result.n_placed++) {
+        auto i = order.at(result.n_placed);
+        
+        if(anytime::expired()) {
+            result.out_of_time = true;
+            break;
+        }
+        
+        auto dp = train_dp(d, i, layers.at(i));
+        
+        dp.restrict_to(occ);
+        
+        auto can_be_at = dp.can_be_at;
+        
+        if(hold) {
+            hold_in_sidings(dp, result.nodes);
+        }
+        
+        auto p = dp.solve();
+        
+        if(!p && hold) {
+            // The trains it yields to do not run as their free runs: the train cannot wait where the plan says, but may still get by
+            dp.can_be_at = can_be_at;
+            p = dp.solve();
+        }
+        
+        if(!p) {
+            break;
+        }
+        
+        occ.reserve(i, *p);
+        result.nodes.at(i) = *p;
+        result.costs.at(i) = dp.priced_cost;
+    }
+    
+    for(auto k = result.n_placed; k < order.size(); k++) {
+        result.costs.at(order.at(k)) = dummy_cost(order.at(k));
+    }
+    
+    return result;
+}
+
+auto meet_pass_planner::hold_in_sidings(train_dp& dp, const bv<bv<path::node>>& nodes) const -> void {
+    for(const auto& a : plan) {
+        if(a.yielding != dp.train || a.siding == 0u || nodes.at(a.keeping).empty()) {
+            continue;
+        }
+        
+        const auto& main_tracks = d.net.main_tracks.at(a.siding);
+        const auto& kp = nodes.at(a.keeping);
+        auto from = std::numeric_limits<unsigned int>::max();
+        auto to = 0u;
+        
+        // The hold is taken from the polished path of the other train rather than from its free run: the siding is only chosen
+        // on the free runs, while the times the main tracks are busy are those of the path actually placed
+        for(auto k = 1u; k + 1u < kp.size(); k++) {
+            if(std::find(main_tracks.begin(), main_tracks.end(), kp.at(k).seg) != main_tracks.end()) {
+                from = std::min(from, kp.at(k).t);
+                to = std::max(to, kp.at(k + 1u).t - 1u);
+            }
+        }
+        
+        if(from > to) {
+            continue;
+        }
+        
+        // While the other train runs on the main tracks the yielding train is in the siding, or not in the network yet
+        for(auto t = from; t <= std::min(to, d.ni + 1u); t++) {
+            for(auto s = 1u; s <= d.ns; s++) {
+                if(s != a.siding) {
+                    dp.can_be_at.at(s).at(t) = false;
+                }
+            }
+        }
+    }
+}
+
+auto meet_pass_planner::dummy_cost(unsigned int train) const -> double {
+    // As if the train waited at sigma until the end of the time horizon and left through an escape arc
+    return d.pri.delay.at(d.trn.type.at(train)) * (d.ni + 1u - d.trn.entry_time.at(train));
+}
+
+auto meet_pass_planner::to_paths(const polished& schedule) const -> bv<path> {
+    auto paths = bv<path>();
+    
+    for(auto i = 0u; i < d.nt; i++) {
+        if(schedule.nodes.at(i).empty()) {
+            paths.push_back(path(d, i));
+            paths.back().cost = schedule.costs.at(i);
+        } else {
+            paths.push_back(path(d, i, schedule.nodes.at(i), schedule.costs.at(i)));
+        }
+    }
+    
+    return paths;
+}
+
+auto meet_pass_planner::total_cost(const bv<path>& paths) -> double {
+    return std::accumulate(paths.begin(), paths.end(), 0.0, [] (double sum, const path& p) { return sum + p.cost; });
+}
+
+auto meet_pass_planner::print_results(const boost::optional<bv<path>>& paths, double seconds) const -> void {
+    auto row = results::row("meet_pass", d, 1u);
+    auto n_meets = std::count_if(plan.begin(), plan.end(), [] (const auto& a) { return a.is_meet; });
+    auto n_waits = std::count_if(plan.begin(), plan.end(), [] (const auto& a) { return a.siding == 0u; });
+    
+    row.add("meets", n_meets)
+       .add("passes", plan.size() - n_meets)
+       .add("without_siding", n_waits)
+       .add("time_total", seconds)
+       .add("lower_bound", free_run_cost);
+    
+    // Without a solution the objective columns are still written, as missing values, so that all the rows have the same columns
+    if(paths) {
+        auto evaluation = schedule_evaluator(d).evaluate(*paths);
+        
+        row.add("upper_bound", total_cost(*paths)).add(evaluation.objective).add("violations", evaluation.violations.size());
+    } else {
+        auto objective = path::cost_breakdown();
+        
+        objective.delay = objective.terminal = objective.sa = objective.unpreferred = std::numeric_limits<double>::quiet_NaN();
+        row.add("upper_bound", std::numeric_limits<double>::quiet_NaN()).add(objective).add("violations", std::numeric_limits<double>::quiet_NaN());
+    }
+    
+    row.add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+}
@@ -0,0 +1,137 @@
+#ifndef MEET_PASS_PLANNER_H
+#define MEET_PASS_PLANNER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <data/schedule_evaluator.h>
+#include <solver/train_dp.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <numeric>
+
+/*! \brief This class schedules the trains the way a dispatcher plans meets and passes. Each train first gets its free-run path,
+ *  the cheapest one in its own graph ignoring the other trains. Two trains whose free runs conflict must either meet, if they run
+ *  in opposite directions, or one must pass the other: one of them keeps the main track and the other waits in a siding until it
+ *  has gone by. For each conflict, the sidings the yielding train can wait in are enumerated from the free runs and the minimum
+ *  travel times alone, and the delay of waiting in each of them is estimated; a dispatch rule then lets the train of the better
+ *  class keep the main track, or, within the same class, the train whose yielding would cost more. The trains are finally polished
+ *  in the time-expanded graph one at a time, each train after the ones it yields to, with the cheapest path around the trains
+ *  already placed, either waiting in the planned siding while the other train goes by or, if that turns out cheaper, wherever its
+ *  path takes it. Last, each conflict is given to the other train to yield, and the change is kept if the polished schedule is
+ *  cheaper: only the two trains and the ones placed after them are polished again. If the time runs out before every train is
+ *  placed, the trains left out get a dummy path, priced as if they waited at sigma until the end of the time horizon.
+ */
+struct meet_pass_planner {
+    /*! \brief Two trains whose free runs conflict */
+    struct conflict_window {
+        /*! The train entering the segment of the first conflict later */
+        unsigned int train;
+        
+        /*! The other train */
+        unsigned int other;
+        
+        /*! The segment of the first conflict */
+        unsigned int seg;
+        
+        /*! First time interval in which the free runs conflict */
+        unsigned int from;
+        
+        /*! Last time interval in which the free runs conflict */
+        unsigned int to;
+        
+        /*! True iff the trains run in opposite directions */
+        bool is_meet;
+    };
+    
+    /*! \brief The decision taken on a conflict: which train waits for the other, and where */
+    struct assignment {
+        /*! The train waiting in the siding */
+        unsigned int yielding;
+        
+        /*! The train keeping the main track */
+        unsigned int keeping;
+        
+        /*! The siding, or 0 if the yielding train has no siding to wait in and simply waits behind the other */
+        unsigned int siding;
+        
+        /*! Estimated last time interval the yielding train spends in the siding */
+        unsigned int hold_until;
+        
+        /*! Estimated cost of the delay of the yielding train */
+        double cost;
+        
+        /*! True iff the trains run in opposite directions */
+        bool is_meet;
+    };
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! The meets and passes planned, one for each conflict window of the free runs */
+    bv<assignment> plan;
+    
+    /*! Cost of the free runs: a lower bound on the cost of any schedule */
+    double free_run_cost;
+    
+    /*! Basic constructor */
+    meet_pass_planner(const data& d);
+    
+    /*! Plans the meets and passes, polishes the trains' paths in their graphs and returns them, or boost::none if some train
+     *  could not be placed around the others */
+    auto solve() -> boost::optional<bv<path>>;
+
+private:
+    
+    using visit = schedule_evaluator::visit;
+    
+    /*! \brief The trains' paths polished one at a time in a dispatch order */
+    struct polished {
+        /*! The dispatch order */
+        uint_vector order;
+        
+        /*! Indexed over tr, the train's polished path, or empty if the train has not been placed */
+        bv<bv<path::node>> nodes;
+        
+        /*! Indexed over tr, the cost of the train's polished path, or the price of its dummy path */
+        double_vector costs;
+        
+        /*! Number of trains placed, following the order */
+        unsigned int n_placed;
+        
+        /*! True iff the placing stopped because the time ran out */
+        bool out_of_time;
+        
+        /*! Tells wether every train has been placed */
+        auto complete() const -> bool { return n_placed == order.size(); }
+        
+        /*! Total cost of the schedule, including the price of the dummy paths */
+        auto cost() const -> double { return std::accumulate(costs.begin(), costs.end(), 0.0); }
+    };
+    
+    /*! Indexed over tr, layers of the train's graph, built once for the free run and the polish */
+    bv<std::shared_ptr<const train_dp::layered_graph>> layers;
+    
+    /*! Indexed over tr, the train's free-run path */
+    bv<bv<path::node>> free_runs;
+    
+    /*! Indexed over tr, the visits of the train's free-run path to the segments, in order */
+    bv<bv<visit>> free_visits;
+    
+    auto conflict_windows() const -> bv<conflict_window>;
+    auto best_siding(unsigned int yielding, unsigned int keeping, const conflict_window& w) const -> boost::optional<assignment>;
+    auto dispatch(const bv<conflict_window>& windows) -> void;
+    auto yield(unsigned int yielding, unsigned int keeping, const conflict_window& w) const -> assignment;
+    auto dispatch_order() const -> uint_vector;
+    auto schedule(bool hold, bool verbose) const -> polished;
+    auto polish(const uint_vector& order, bool hold, const polished& start, unsigned int n_kept) const -> polished;
+    auto hold_in_sidings(train_dp& dp, const bv<bv<path::node>>& nodes) const -> void;
+    auto dummy_cost(unsigned int train) const -> double;
+    auto to_paths(const polished& schedule) const -> bv<path>;
+    static auto total_cost(const bv<path>& paths) -> double;
+    auto print_results(const boost::optional<bv<path>>& paths, double seconds) const -> void;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include <solver/multi_resolution_solver.h>
+#include <profiler/profiler.h>
+#include <solver/anytime.h>
+#include <solver/sequential_solver.h>
+
+#include <iostream>
+
+auto multi_resolution_solver::solve() -> boost::optional<bv<path>> {
+    std::cout << "MULTI_RESOLUTION_SOLVER >> Solving with " << p.multi_resolution.time_step << " minutes per time interval" << std::endl;
+    
+    auto coarse_paths = boost::optional<bv<path>>();
+    auto cor = corridor();
+    auto coarse_d = std::unique_ptr<data>();
+    
+    if(anytime::expired()) {
+        // The sequential solver would only hand the coarse trains to the planner: its paths are not worth building the coarse graphs
+        std::cout << "MULTI_RESOLUTION_SOLVER >> Out of time: skipping the coarse problem" << std::endl;
+    } else {
+        profiler::span phase("multi_resolution/coarse");
+        
+        coarse_d = std::make_unique<data>(file_name, p, p.multi_resolution.time_step, corridor());
+        coarse_paths = sequential_solver(*coarse_d).solve_sequentially();
+    }
+    
+    if(coarse_paths) {
+        cor = make_corridor(*coarse_d, *coarse_paths);
+    } else if(!anytime::expired()) {
+        std::cout << "MULTI_RESOLUTION_SOLVER >> No coarse solution, the fine graphs will not be restricted" << std::endl;
+    }
+    
+    if(anytime::expired()) {
+        std::cout << "MULTI_RESOLUTION_SOLVER >> Out of time: the fine problem is scheduled by the safe-interval planner" << std::endl;
+    } else {
+        std::cout << "MULTI_RESOLUTION_SOLVER >> Solving with 1 minute per time interval" << std::endl;
+    }
+    
+    profiler::span phase("multi_resolution/fine");
+    
+    fine_d = std::make_unique<data>(file_name, p, 1u, std::move(cor));
+    
+    auto fine_s = sequential_solver(*fine_d);
+    
+    return fine_s.solve_sequentially();
+}
+
+auto multi_resolution_solver::make_corridor(const data& coarse_d, const bv<path>& coarse_paths) const -> corridor {
+    auto step = p.multi_resolution.time_step;
+    auto band = p.multi_resolution.band;
+    auto cor = corridor(coarse_d.nt, coarse_d.ns);
+    
+    for(const auto& cp : coarse_paths) {
+        if(cp.is_empty() || cp.is_dummy()) {
+            // We know nothing about this train: it can go anywhere
+            cor.open(cp.train);
+            continue;
+        }
+        
+        // Skip sigma and tau
+        for(auto k = 1u; k + 1 < cp.p.size(); k++) {
+            auto cs = cp.p.at(k).seg;
+            
+            // Coarse interval c spans minutes (c - 1) * step + 1 ... c * step
+            auto from = (cp.p.at(k).t - 1) * step + 1;
+            auto to = (cp.p.at(k + 1).t - 1) * step;
+            
+            from = (from > band ? from - band : 0u);
+            to = to + band;
+            
+            auto west = coarse_d.seg.w_min_dist.at(cs);
+            auto east = west + coarse_d.seg.length.at(cs);
+            
+            // Both problems come from the same data file, so they have the same segments: open all the
+            // segments running alongside cs, so that the fine solution can also use a different track
+            for(auto s = 1u; s <= coarse_d.ns; s++) {
+                auto s_west = coarse_d.seg.w_min_dist.at(s);
+                auto s_east = s_west + coarse_d.seg.length.at(s);
+                
+                if(s_west < east && west < s_east) {
+                    cor.widen(cp.train, s, from, to);
+                }
+            }
+        }
+    }
+    
+    return cor;
+}
@@ -0,0 +1,37 @@
+#ifndef MULTI_RESOLUTION_SOLVER_H
+#define MULTI_RESOLUTION_SOLVER_H
+
+#include <data/array.h>
+#include <data/corridor.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <params/params.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <string>
+
+/*! \brief This class solves the problem with coarse time intervals first, and then with the original ones only inside a band around the coarse solution */
+struct multi_resolution_solver {
+    /*! Name of the JSON data file */
+    std::string file_name;
+    
+    /*! Reference to program params */
+    const params& p;
+    
+    /*! Data at the original time resolution, restricted to the band around the coarse solution: the paths returned by solve() refer to it */
+    std::unique_ptr<data> fine_d;
+    
+    /*! Basic constructor */
+    multi_resolution_solver(std::string file_name, const params& p) : file_name{file_name}, p{p} {}
+    
+    /*! Solve the coarse and then the fine problem, and return the generated paths (if the problem is feasible) or boost::none */
+    auto solve() -> boost::optional<bv<path>>;
+    
+private:
+    
+    auto make_corridor(const data& coarse_d, const bv<path>& coarse_paths) const -> corridor;
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include <solver/rolling_horizon_solver.h>
+#include <profiler/profiler.h>
+#include <solver/solver.h>
+
+#include <boost/foreach.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+using boost::property_tree::ptree;
+
+rolling_horizon_solver::rolling_horizon_solver(std::string file_name, const params& p) : file_name{file_name}, p{p}, window_p{p} {
+    window_p.preprocessing.contract_chains = false;
+}
+
+auto rolling_horizon_solver::solve() -> boost::optional<bv<path>> {
+    auto pt = data::read_file(file_name);
+    
+    d = std::make_unique<data>(pt, file_name, window_p, 1u, corridor(), false);
+    
+    auto window = std::min(p.rolling_horizon.window, d->ni);
+    auto overlap = p.rolling_horizon.overlap;
+    
+    if(overlap >= window) {
+        std::cerr << "ROLLING_HORIZON_SOLVER >> The overlap must be shorter than the window" << std::endl;
+        return boost::none;
+    }
+    
+    // A train leaving its last frozen segment at the end of a window must be able to run through the next segment within the following window
+    auto step = window - overlap;
+    
+    for(auto i = 0u; i < d->nt; i++) {
+        for(auto s = 1u; s <= d->ns; s++) {
+            if(d->net.min_travel_time.at(i).at(s) > step && window < d->ni) {
+                std::cerr << "ROLLING_HORIZON_SOLVER >> Window minus overlap is shorter than the minimum travel time of train " << i << " on segment " << s << std::endl;
+                return boost::none;
+            }
+        }
+    }
+    
+    auto state = bv<train_state>();
+    
+    for(auto i = 0u; i < d->nt; i++) {
+        state.push_back(train_state(d->trn.orig_ext.at(i), d->trn.entry_time.at(i)));
+    }
+    
+    for(auto start = 1u; ; start += step) {
+        profiler::span phase("rolling_horizon/window");
+        
+        auto end = std::min(start + window - 1u, d->ni);
+        auto last = (end == d->ni);
+        auto freeze_before = last ? d->ni + 2u : start + step;
+        auto trains = uint_vector();
+        auto window_pt = make_window(pt, start, end, state, trains);
+        
+        std::cout << "ROLLING_HORIZON_SOLVER >> Window [" << start << ", " << end << "] with " << trains.size() << " trains" << std::endl;
+        
+        if(!trains.empty()) {
+            auto wd = data(window_pt, file_name, window_p, 1u, corridor(), true);
+            auto ws = solver(wd);
+            auto window_paths = ws.solve();
+            
+            if(!window_paths) {
+                std::cerr << "ROLLING_HORIZON_SOLVER >> Window [" << start << ", " << end << "] is infeasible" << std::endl;
+                return boost::none;
+            }
+            
+            for(const auto& wp : *window_paths) {
+                auto i = trains.at(wp.train);
+                
+                freeze(wp, i, start, end, freeze_before, state.at(i));
+            }
+        }
+        
+        if(last) {
+            break;
+        }
+    }
+    
+    auto paths = bv<path>();
+    auto total_cost = 0.0;
+    
+    for(auto i = 0u; i < d->nt; i++) {
+        if(!state.at(i).done) {
+            std::cerr << "ROLLING_HORIZON_SOLVER >> Train " << i << " could not be scheduled" << std::endl;
+            paths.push_back(path(*d, i));
+            continue;
+        }
+        
+        auto cost = cost_of(i, state.at(i).frozen);
+        
+        paths.push_back(path(*d, i, state.at(i).frozen, cost));
+        total_cost += cost;
+    }
+    
+    for(const auto& pa : paths) {
+        pa.print_summary(std::cerr);
+    }
+    
+    std::cout << "ROLLING_HORIZON_SOLVER >> Total cost: " << total_cost << std::endl;
+    
+    return paths;
+}
+
+auto rolling_horizon_solver::fits_in_window(unsigned int i, const train_state& st, unsigned int start, unsigned int end) const -> bool {
+    // The window's graph has a starting arc for the train only if it can run through its first segment before the end of the window
+    auto entry_time = std::max(st.entry_time, start);
+    
+    for(auto s = 1u; s <= d->ns; s++) {
+        auto starts_at_s = (d->trn.is_eastbound.at(i) ? d->seg.w_ext.at(s) : d->seg.e_ext.at(s)) == st.origin;
+        
+        if(starts_at_s && entry_time + d->net.min_travel_time.at(i).at(s) <= end) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+auto rolling_horizon_solver::make_window(const ptree& pt, unsigned int start, unsigned int end, const bv<train_state>& state, uint_vector& trains) const -> ptree {
+    // Times in the window are shifted so that start becomes 1
+    auto shift = [start] (unsigned int t) -> unsigned int { return t - start + 1u; };
+    auto ni = shift(end);
+    auto window_pt = pt;
+    auto trains_pt = ptree();
+    auto mows_pt = ptree();
+    auto add_mow = [&] (unsigned int w_ext, unsigned int e_ext, unsigned int from, unsigned int to) {
+        auto mow_pt = ptree();
+        
+        mow_pt.put("extreme_1", w_ext);
+        mow_pt.put("extreme_2", e_ext);
+        mow_pt.put("start_time", shift(std::max(from, start)));
+        mow_pt.put("end_time", shift(std::min(to, end - 1u)));
+        mows_pt.push_back(std::make_pair("", mow_pt));
+    };
+    
+    // Unlike a MOW, a frozen occupation only blocks its own segment: not the siding next to a main track, or vice versa
+    auto frozen_pt = ptree();
+    auto add_frozen = [&] (unsigned int s, unsigned int from, unsigned int to) {
+        auto occupation_pt = ptree();
+        
+        occupation_pt.put("segment", s);
+        occupation_pt.put("start_time", shift(std::max(from, start)));
+        occupation_pt.put("end_time", shift(std::min(to, end - 1u)));
+        frozen_pt.push_back(std::make_pair("", occupation_pt));
+    };
+    
+    BOOST_FOREACH(const ptree::value_type& mow_child, pt.get_child("mow")) {
+        auto from = mow_child.second.get<unsigned int>("start_time");
+        auto to = mow_child.second.get<unsigned int>("end_time");
+        
+        if(from < end && to >= start) {
+            add_mow(mow_child.second.get<unsigned int>("extreme_1"), mow_child.second.get<unsigned int>("extreme_2"), from, to);
+        }
+    }
+    
+    auto i = 0u;
+    BOOST_FOREACH(const ptree::value_type& train_child, pt.get_child("trains")) {
+        const auto& st = state.at(i);
+        
+        // Frozen segments stay blocked for the other trains until they are left, plus the headway
+        for(auto k = 1u; k < st.frozen.size(); k++) {
+            auto s = st.frozen.at(k).seg;
+            
+            if(s == d->ns + 1u) {
+                continue;
+            }
+            
+            auto leaving_time = (k + 1u < st.frozen.size() ? st.frozen.at(k + 1u).t : st.entry_time) - 1u;
+            
+            if(leaving_time + d->headway >= start) {
+                add_frozen(s, start, leaving_time + d->headway);
+            }
+        }
+        
+        if(!st.done && fits_in_window(i, st, start, end)) {
+            auto train_pt = train_child.second;
+            auto entry_time = shift(std::max(st.entry_time, start));
+            auto want_time = static_cast<int>(train_child.second.get<unsigned int>("terminal_wt")) - static_cast<int>(start) + 1;
+            
+            // Want times outside the window are moved inside it: for arrivals late (early) in the window, this only shifts the cost by a constant
+            want_time = std::max(want_time, static_cast<int>(entry_time));
+            want_time = std::min(want_time, static_cast<int>(ni) - 1);
+            
+            train_pt.put("entry_time", entry_time);
+            train_pt.put("origin_node", st.origin);
+            train_pt.put("terminal_wt", want_time);
+            train_pt.put("fixed_entry", st.running);
+            
+            auto schedule_pt = ptree();
+            BOOST_FOREACH(const ptree::value_type& schedule_child, train_child.second.get_child("schedule")) {
+                auto ti = schedule_child.second.get<unsigned int>("time");
+                
+                if(ti >= start && ti <= end) {
+                    auto point_pt = schedule_child.second;
+                    
+                    point_pt.put("time", shift(ti));
+                    schedule_pt.push_back(std::make_pair("", point_pt));
+                }
+            }
+            
+            // A SA train with no SA point in the window gets one at its destination at the end of the window, where it is never late
+            if(train_pt.get<bool>("schedule_adherence") && schedule_pt.empty()) {
+                auto point_pt = ptree();
+                
+                point_pt.put("node", train_pt.get<unsigned int>("destination_node"));
+                point_pt.put("time", ni);
+                schedule_pt.push_back(std::make_pair("", point_pt));
+            }
+            
+            train_pt.put_child("schedule", schedule_pt);
+            trains_pt.push_back(std::make_pair("", train_pt));
+            trains.push_back(i);
+        }
+        
+        i++;
+    }
+    
+    window_pt.put("time_intervals", ni);
+    window_pt.put("trains_number", trains.size());
+    window_pt.put_child("trains", trains_pt);
+    window_pt.put_child("mow", mows_pt);
+    window_pt.put_child("frozen", frozen_pt);
+    
+    return window_pt;
+}
+
+auto rolling_horizon_solver::freeze(const path& wp, unsigned int i, unsigned int start, unsigned int end, unsigned int freeze_before, train_state& st) const -> void {
+    if(wp.is_empty() || wp.is_dummy()) {
+        return;
+    }
+    
+    auto nodes = bv<path::node>();
+    
+    for(const auto& n : wp.p) {
+        nodes.push_back(path::node(n.seg, n.t + start - 1u));
+    }
+    
+    // The train does not move before the next window: nothing to freeze yet
+    if(nodes.at(1).t >= freeze_before) {
+        return;
+    }
+    
+    if(st.frozen.empty()) {
+        st.frozen.push_back(nodes.at(0));
+    }
+    
+    auto k = 1u;
+    while(k < nodes.size() && nodes.at(k).t < freeze_before) {
+        st.frozen.push_back(nodes.at(k++));
+    }
+    
+    if(st.frozen.back().seg == d->ns + 1u) {
+        st.done = true;
+        return;
+    }
+    
+    auto s = st.frozen.back().seg;
+    const auto& dest_segs = d->trn.dest_segs.at(i);
+    auto arrives = (std::find(dest_segs.begin(), dest_segs.end(), s) != dest_segs.end());
+    
+    if(nodes.at(k).seg == d->ns + 1u && arrives) {
+        // The train will arrive at its destination: there is nothing left to decide about it
+        st.frozen.push_back(nodes.at(k));
+        st.done = true;
+        return;
+    }
+    
+    st.origin = d->trn.is_eastbound.at(i) ? d->seg.e_ext.at(s) : d->seg.w_ext.at(s);
+    st.running = true;
+    
+    if(nodes.at(k).seg == d->ns + 1u) {
+        // The train escaped at the end of the window: it leaves its segment as soon as the next window starts
+        st.entry_time = std::max(end + 1u, st.frozen.back().t + d->net.min_travel_time.at(i).at(s));
+    } else {
+        st.entry_time = nodes.at(k).t;
+    }
+}
+
+auto rolling_horizon_solver::cost_of(unsigned int i, const bv<path::node>& nodes) const -> double {
+    assert(nodes.size() >= 3u);
+    
+    return path::breakdown_of(*d, i, nodes).total();
+}
@@ -0,0 +1,66 @@
+#ifndef ROLLING_HORIZON_SOLVER_H
+#define ROLLING_HORIZON_SOLVER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/path.h>
+#include <params/params.h>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <memory>
+#include <string>
+
+/*! \brief This class solves the problem one time window at a time: the decisions taken before the overlap with the next window are
+ *  frozen, and the trains still running at that point enter the next window from where they are.
+ */
+struct rolling_horizon_solver {
+    /*! \brief This class describes where a train is between two consecutive windows */
+    struct train_state {
+        /*! Nodes already visited by the train, with times relative to the whole time horizon: empty if the train has not started yet */
+        bv<path::node> frozen;
+        
+        /*! Junction from which the train enters the next window */
+        unsigned int origin;
+        
+        /*! Time, relative to the whole time horizon, at which the train enters the next window */
+        unsigned int entry_time;
+        
+        /*! True iff the train is already running, i.e. it is in the last frozen segment and will leave it exactly at entry_time */
+        bool running;
+        
+        /*! True iff the train's path is frozen up to tau */
+        bool done;
+        
+        /*! Basic constructor */
+        train_state(unsigned int origin, unsigned int entry_time) : origin{origin}, entry_time{entry_time}, running{false}, done{false} {}
+    };
+    
+    /*! Name of the JSON data file */
+    std::string file_name;
+    
+    /*! Reference to program params */
+    const params& p;
+    
+    /*! Params used for the whole problem and for each window: chains are never contracted, as the junctions they can run through depend on where the trains enter each window */
+    params window_p;
+    
+    /*! Data over the whole time horizon, without the trains' graphs: the paths returned by solve() refer to it */
+    std::unique_ptr<data> d;
+    
+    /*! Basic constructor */
+    rolling_horizon_solver(std::string file_name, const params& p);
+    
+    /*! Solve the problem window by window, and return the stitched paths (if every window is feasible) or boost::none */
+    auto solve() -> boost::optional<bv<path>>;
+
+private:
+    
+    auto make_window(const boost::property_tree::ptree& pt, unsigned int start, unsigned int end, const bv<train_state>& state, uint_vector& trains) const -> boost::property_tree::ptree;
+    auto fits_in_window(unsigned int i, const train_state& st, unsigned int start, unsigned int end) const -> bool;
+    auto freeze(const path& wp, unsigned int i, unsigned int start, unsigned int end, unsigned int freeze_before, train_state& st) const -> void;
+    auto cost_of(unsigned int i, const bv<path::node>& nodes) const -> double;
+};
+
+#endif
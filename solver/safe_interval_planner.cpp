@@ -0,0 +1,587 @@
+#include <solver/safe_interval_planner.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Parent of the labels which start from sigma
+    constexpr unsigned int no_parent = std::numeric_limits<unsigned int>::max();
+}
+
+safe_interval_planner::safe_interval_planner(const data& d, unsigned int train, const occupancy& occ) : d{d}, train{train}, occ{occ}, cost{0.0}, n_labels{0u} {
+    const auto i = train;
+    const auto tau = d.ns + 1;
+    const auto unreachable = std::numeric_limits<unsigned int>::max();
+    const auto& dest = d.trn.dest_segs.at(i);
+    
+    next = uint_matrix_2d(d.ns + 2);
+    min_time_to_go = uint_vector(d.ns + 2, unreachable);
+    max_time_to_go = uint_vector(d.ns + 2, 0u);
+    safe = bv<bv<interval>>(d.ns + 2);
+    safe_ready = bool_vector(d.ns + 2, false);
+    jit_entries = uint_matrix_2d(d.ns + 2);
+    jit_ready = bool_vector(d.ns + 2, false);
+    
+    for(auto s1 = 1u; s1 <= d.ns; s1++) {
+        if(!usable(s1)) {
+            continue;
+        }
+        
+        for(auto s2 = 1u; s2 <= d.ns; s2++) {
+            if(s2 != s1 && usable(s2) && (
+                (d.trn.is_eastbound.at(i) && d.seg.e_ext.at(s1) == d.seg.w_ext.at(s2)) ||
+                (d.trn.is_westbound.at(i) && d.seg.w_ext.at(s1) == d.seg.e_ext.at(s2))
+            )) {
+                next.at(s1).push_back(s2);
+            }
+        }
+        
+        if(std::find(dest.begin(), dest.end(), s1) != dest.end()) {
+            next.at(s1).push_back(tau);
+        }
+    }
+    
+    // The train never goes back to a segment, so this converges in at most ns passes
+    for(auto pass = 0u; pass <= d.ns; pass++) {
+        auto changed = false;
+        
+        for(auto s1 = 1u; s1 <= d.ns; s1++) {
+            if(!usable(s1)) {
+                continue;
+            }
+            
+            auto mtt = d.net.min_travel_time.at(i).at(s1);
+            
+            if(max_time_to_go.at(s1) < mtt) {
+                max_time_to_go.at(s1) = mtt;
+                changed = true;
+            }
+            
+            for(auto s2 : next.at(s1)) {
+                auto min_rest = (s2 == tau ? 0u : min_time_to_go.at(s2));
+                auto max_rest = (s2 == tau ? 0u : max_time_to_go.at(s2));
+                
+                if(min_rest != unreachable && mtt + min_rest < min_time_to_go.at(s1)) {
+                    min_time_to_go.at(s1) = mtt + min_rest;
+                    changed = true;
+                }
+                
+                if(mtt + max_rest > max_time_to_go.at(s1)) {
+                    max_time_to_go.at(s1) = mtt + max_rest;
+                    changed = true;
+                }
+            }
+        }
+        
+        if(!changed) {
+            break;
+        }
+    }
+}
+
+auto safe_interval_planner::plan() -> boost::optional<bv<path::node>> {
+    return plan_from(bv<path::node>(), 0u);
+}
+
+auto safe_interval_planner::plan_from(const bv<path::node>& old_p, unsigned int now) -> boost::optional<bv<path::node>> {
+    const auto i = train;
+    const auto tau = d.ns + 1;
+    const auto delay_price = d.pri.delay.at(d.trn.type.at(i));
+    const auto entry_time = d.trn.entry_time.at(i);
+    const auto& constructive = d.p.heuristics.constructive;
+    const auto& dest = d.trn.dest_segs.at(i);
+    
+    using queue_entry = std::pair<double, unsigned int>;
+    
+    auto labels = bv<label>();
+    auto queue = std::priority_queue<queue_entry, std::vector<queue_entry>, std::greater<queue_entry>>();
+    
+    // Indexed over (s, k), the labels in the k-th safe interval of s
+    auto in_interval = uint_matrix_3d(d.ns + 2);
+    
+    // Label a is at least as good as label b, in the same safe interval, if the train can wait from a's time to b's time
+    // and still cost no more than b
+    auto dominates = [&] (const label& a, const label& b) {
+        if(a.t > b.t || (a.t < b.t && d.seg.type.at(a.seg) == 'X')) {
+            return false;
+        }
+        
+        return a.cost + stay_cost(a.seg, a.t, b.t) <= b.cost;
+    };
+    
+    auto push = [&] (label l) {
+        if(l.seg != tau) {
+            auto& here = in_interval.at(l.seg).at(l.interval);
+            
+            for(auto k : here) {
+                if(!labels.at(k).dead && dominates(labels.at(k), l)) {
+                    return;
+                }
+            }
+            
+            for(auto k : here) {
+                if(!labels.at(k).dead && dominates(l, labels.at(k))) {
+                    labels.at(k).dead = true;
+                }
+            }
+            
+            here.push_back(labels.size());
+        }
+        
+        auto f = l.cost + (l.seg == tau ? 0.0 : lower_bound(l.seg, l.t));
+        
+        queue.push(std::make_pair(f, static_cast<unsigned int>(labels.size())));
+        labels.push_back(l);
+    };
+    
+    auto intervals_of = [&] (unsigned int s) -> const bv<interval>& {
+        const auto& ivs = intervals(s);
+        
+        if(in_interval.at(s).size() != ivs.size()) {
+            in_interval.at(s) = uint_matrix_2d(ivs.size());
+        }
+        
+        return ivs;
+    };
+    
+    // Indexed over the nodes of old_p, cost of the path up to the train's entry in the node's segment
+    auto kept_cost = [&] (unsigned int k) {
+        auto c = delay_price * (static_cast<double>(old_p.at(1).t) - static_cast<double>(entry_time));
+        
+        for(auto m = 1u; m < k; m++) {
+            auto s = old_p.at(m).seg;
+            auto s_next = old_p.at(m + 1).seg;
+            auto te = old_p.at(m + 1).t;
+            auto exit = (s_next != tau || std::find(dest.begin(), dest.end(), s) != dest.end()) ? exit_cost(s, te - 1, s_next) : 0.0;
+            
+            c += stay_cost(s, old_p.at(m).t, te) - delay_price * d.net.min_travel_time.at(i).at(s) + exit;
+        }
+        
+        return c;
+    };
+    
+    // Number of segments of old_p the train has entered by now: they are kept, and nothing else is entered before now + 1
+    auto n_kept = 0u;
+    auto not_before = (old_p.empty() ? 1u : now + 1u);
+    
+    while(n_kept + 2u < old_p.size() && old_p.at(n_kept + 1u).t <= now) {
+        n_kept++;
+    }
+    
+    if(n_kept > 0u && old_p.back().t <= now) {
+        n_labels = 0u;
+        cost = kept_cost(old_p.size() - 1u);
+        
+        return old_p;
+    }
+    
+    if(n_kept > 0u) {
+        auto parent = no_parent;
+        
+        for(auto k = 1u; k < n_kept; k++) {
+            labels.push_back(label{old_p.at(k).seg, 0u, old_p.at(k).t, kept_cost(k), parent, true});
+            parent = labels.size() - 1u;
+        }
+        
+        auto s = old_p.at(n_kept).seg;
+        auto t = old_p.at(n_kept).t;
+        const auto& ivs = intervals_of(s);
+        
+        for(auto k = 0u; k < ivs.size(); k++) {
+            if(ivs.at(k).from <= t && t <= ivs.at(k).to) {
+                push(label{s, k, t, kept_cost(n_kept), parent, false});
+            }
+        }
+    }
+    
+    for(auto s : (n_kept > 0u ? uint_vector() : d.trn.orig_segs.at(i))) {
+        auto mtt = d.net.min_travel_time.at(i).at(s);
+        
+        if(!usable(s) || mtt > d.ni || (constructive.active && constructive.only_start_at_main && d.seg.type.at(s) == 'S')) {
+            continue;
+        }
+        
+        const auto& ivs = intervals_of(s);
+        
+        for(auto k = 0u; k < ivs.size(); k++) {
+            if(ivs.at(k).to + 1 < mtt) {
+                continue;
+            }
+            
+            auto from = std::max({ivs.at(k).from, entry_time, not_before});
+            auto to = std::min(ivs.at(k).to + 1 - mtt, d.ni - mtt);
+            
+            if(d.trn.has_fixed_entry.at(i) || (constructive.active && constructive.fix_start)) {
+                if(entry_time < from || entry_time > to) {
+                    continue;
+                }
+                
+                from = to = entry_time;
+            }
+            
+            for(auto te : entries(0u, s, from, to)) {
+                push(label{s, k, te, delay_price * (te - entry_time), no_parent, false});
+            }
+        }
+    }
+    
+    while(!queue.empty()) {
+        auto current = queue.top().second;
+        
+        queue.pop();
+        
+        auto l = labels.at(current);
+        
+        if(l.dead) {
+            continue;
+        }
+        
+        if(l.seg == tau) {
+            auto reversed = bv<path::node>();
+            
+            reversed.push_back(path::node(tau, l.t));
+            
+            for(auto k = l.parent; k != no_parent; k = labels.at(k).parent) {
+                reversed.push_back(path::node(labels.at(k).seg, labels.at(k).t));
+            }
+            
+            reversed.push_back(path::node(0u, reversed.back().t - 1));
+            
+            n_labels = labels.size();
+            cost = l.cost;
+            
+            return bv<path::node>(reversed.rbegin(), reversed.rend());
+        }
+        
+        auto s = l.seg;
+        auto mtt = d.net.min_travel_time.at(i).at(s);
+        auto iv = intervals(s).at(l.interval);
+        auto earliest_exit = l.t + mtt - 1;
+        auto latest_exit = std::min(d.seg.type.at(s) == 'X' ? earliest_exit : iv.to, d.ni);
+        
+        if(earliest_exit > latest_exit) {
+            continue;
+        }
+        
+        for(auto s2 : next.at(s)) {
+            if(s2 == tau) {
+                // The cost is piecewise linear in the exit time, and it only decreases until the arrival window opens
+                auto window_start = static_cast<int>(d.trn.want_time.at(i)) - static_cast<int>(d.tiw.wt_left);
+                auto first_exit = std::max(earliest_exit, not_before - 1u);
+                auto exits = uint_vector();
+                
+                if(first_exit <= latest_exit) {
+                    exits.push_back(first_exit);
+                }
+                
+                if(window_start > static_cast<int>(first_exit)) {
+                    exits.push_back(std::min(static_cast<unsigned int>(window_start), latest_exit));
+                }
+                
+                if(constructive.active && constructive.fix_end) {
+                    exits.clear();
+                    
+                    if(d.trn.want_time.at(i) >= first_exit && d.trn.want_time.at(i) <= latest_exit) {
+                        exits.push_back(d.trn.want_time.at(i));
+                    }
+                }
+                
+                for(auto x : exits) {
+                    push(label{tau, 0u, x + 1, l.cost + stay_cost(s, l.t, x + 1) - delay_price * mtt + exit_cost(s, x, tau), current, false});
+                }
+                
+                continue;
+            }
+            
+            auto mtt2 = d.net.min_travel_time.at(i).at(s2);
+            
+            if(mtt2 > d.ni) {
+                continue;
+            }
+            
+            const auto& ivs2 = intervals_of(s2);
+            
+            for(auto k2 = 0u; k2 < ivs2.size() && ivs2.at(k2).from <= latest_exit + 1; k2++) {
+                if(ivs2.at(k2).to + 1 < mtt2) {
+                    continue;
+                }
+                
+                auto from = std::max({earliest_exit + 1, ivs2.at(k2).from, not_before});
+                auto to = std::min({latest_exit + 1, ivs2.at(k2).to + 1 - mtt2, d.ni + 1 - mtt2});
+                if(from > to) {
+                    continue;
+                }
+                
+                for(auto te : entries(s, s2, from, to)) {
+                    push(label{s2, k2, te, l.cost + stay_cost(s, l.t, te) - delay_price * mtt + exit_cost(s, te - 1, s2), current, false});
+                }
+            }
+        }
+        
+        // Escape arc: the train is still in the network at the end of the time horizon
+        if(latest_exit == d.ni && std::find(dest.begin(), dest.end(), s) == dest.end() && (d.seg.type.at(s) != 'X' || earliest_exit == d.ni)) {
+            push(label{tau, 0u, d.ni + 1, l.cost + stay_cost(s, l.t, d.ni + 1) - delay_price * mtt, current, false});
+        }
+    }
+    
+    n_labels = labels.size();
+    
+    return boost::none;
+}
+
+auto safe_interval_planner::usable(unsigned int s) const -> bool {
+    if(d.seg.type.at(s) != 'S') {
+        return true;
+    }
+    
+    return !d.trn.is_hazmat.at(train) && d.trn.length.at(train) <= d.seg.original_length.at(s);
+}
+
+auto safe_interval_planner::intervals(unsigned int s) -> const bv<interval>& {
+    if(safe_ready.at(s)) {
+        return safe.at(s);
+    }
+    
+    const auto i = train;
+    const auto h = d.headway;
+    const auto& constructive = d.p.heuristics.constructive;
+    
+    // Indexed over t, number of time intervals before t during which another train is in s
+    auto n_taken = uint_vector(d.ni + 3, 0u);
+    
+    for(auto t = 0u; t <= d.ni + 1; t++) {
+        auto j = occ.train_at.at(s).at(t);
+        
+        n_taken.at(t + 1) = n_taken.at(t) + ((j != occupancy::no_train && j != i) ? 1u : 0u);
+    }
+    
+    // Indexed over t, is true if a heavy train enters a siding of s less than one headway before or after t
+    auto near_heavy = bool_vector(d.ni + 2, false);
+    
+    if(!d.trn.is_sa.at(i)) {
+        for(auto sd : d.net.sidings) {
+            const auto& mains = d.net.main_tracks.at(sd);
+            
+            if(std::find(mains.begin(), mains.end(), s) == mains.end()) {
+                continue;
+            }
+            
+            for(auto t = 1u; t <= d.ni; t++) {
+                auto j = occ.heavy_entering.at(sd).at(t);
+                
+                if(j == occupancy::no_train || j == i) {
+                    continue;
+                }
+                
+                for(auto tt = (t > h ? t - h : 0u); tt <= std::min(t + h, d.ni + 1); tt++) {
+                    near_heavy.at(tt) = true;
+                }
+            }
+        }
+    }
+    
+    auto start = 0u;
+    auto open = false;
+    
+    for(auto t = std::max(d.net.min_time_to_arrive.at(i).at(s), 1u); t <= d.ni + 1; t++) {
+        auto ok = (t <= d.ni);
+        
+        if(ok) {
+            auto from = (t > h ? t - h : 0u);
+            auto to = std::min(t + h, d.ni + 1);
+            
+            ok = !d.mnt.is_mow.at(s).at(t) &&
+                 !near_heavy.at(t) &&
+                 n_taken.at(to + 1) == n_taken.at(from) &&
+                 d.cor.contains(i, s, t) &&
+                 !(constructive.active && constructive.corridor.active && t > d.net.min_time_to_arrive_at_chain_end(i, s, d.trn) + constructive.corridor.max_delay_over_fastest_route);
+        }
+        
+        if(ok && !open) {
+            start = t;
+            open = true;
+        } else if(!ok && open) {
+            safe.at(s).push_back(interval(start, t - 1));
+            open = false;
+        }
+    }
+    
+    safe_ready.at(s) = true;
+    
+    return safe.at(s);
+}
+
+auto safe_interval_planner::can_enter(unsigned int s, unsigned int t) const -> bool {
+    if(d.seg.type.at(s) != 'S') {
+        return true;
+    }
+    
+    // A train can only enter a siding when another train runs on the main tracks, and a heavy train only when it is an SA one
+    auto h = d.headway;
+    auto from = (t > h ? t - h : 0u);
+    
+    return occ.on_main_tracks(train, s, from, t + h, false) && !(d.trn.is_heavy.at(train) && occ.on_main_tracks(train, s, from, t + h, true));
+}
+
+auto safe_interval_planner::first_entry(unsigned int s, unsigned int from, unsigned int to) const -> boost::optional<unsigned int> {
+    for(auto t = from; t <= to; t++) {
+        if(t >= d.net.min_time_to_arrive.at(train).at(s) && can_enter(s, t)) {
+            return t;
+        }
+    }
+    
+    return boost::none;
+}
+
+auto safe_interval_planner::entries(unsigned int s_prev, unsigned int s, unsigned int from, unsigned int to) -> uint_vector {
+    auto candidates = uint_vector({from});
+    
+    // Waiting in an unpreferred segment costs more than waiting before it, and waiting before a cross-over is the only way to
+    // enter it later: in these cases the train might want to enter s as late as possible, or just in time for what comes next
+    if(d.seg.type.at(s) == 'X' || costlier_wait(s_prev, s)) {
+        const auto& jit = just_in_time(s);
+        
+        candidates.push_back(to);
+        candidates.insert(candidates.end(), jit.begin(), jit.end());
+    }
+    
+    auto times = uint_vector();
+    
+    for(auto c : candidates) {
+        if(c < from || c > to) {
+            continue;
+        }
+        
+        auto te = first_entry(s, c, to);
+        
+        if(te && std::find(times.begin(), times.end(), *te) == times.end()) {
+            times.push_back(*te);
+        }
+    }
+    
+    return times;
+}
+
+auto safe_interval_planner::just_in_time(unsigned int s) -> const uint_vector& {
+    if(jit_ready.at(s)) {
+        return jit_entries.at(s);
+    }
+    
+    auto mtt = d.net.min_travel_time.at(train).at(s);
+    auto window_start = static_cast<int>(d.trn.want_time.at(train)) - static_cast<int>(d.tiw.wt_left);
+    auto times = uint_vector();
+    
+    // Leave at the end of the time horizon, through an escape arc
+    times.push_back(d.ni + 1 - mtt);
+    
+    for(auto s_next : next.at(s)) {
+        if(s_next == d.ns + 1) {
+            // Arrive at the start of the arrival window
+            if(window_start + 1 >= static_cast<int>(mtt)) {
+                times.push_back(window_start + 1 - mtt);
+            }
+            
+            continue;
+        }
+        
+        // Leave when the next safe interval starts or, for a siding, when the train can enter it
+        for(const auto& iv : intervals(s_next)) {
+            auto could_enter = false;
+            
+            for(auto t = iv.from; t <= iv.to; t++) {
+                auto can = can_enter(s_next, t);
+                
+                if(can && !could_enter && t >= mtt) {
+                    times.push_back(t - mtt);
+                }
+                
+                if(d.seg.type.at(s_next) != 'S') {
+                    break;
+                }
+                
+                could_enter = can;
+            }
+        }
+        
+        // Leave just in time to enter s_next just in time
+        if(d.seg.type.at(s_next) == 'X' || costlier_wait(s, s_next)) {
+            for(auto t : just_in_time(s_next)) {
+                if(t >= mtt) {
+                    times.push_back(t - mtt);
+                }
+            }
+        }
+    }
+    
+    jit_entries.at(s) = times;
+    jit_ready.at(s) = true;
+    
+    return jit_entries.at(s);
+}
+
+auto safe_interval_planner::costlier_wait(unsigned int s_prev, unsigned int s) const -> bool {
+    return d.net.unpreferred.at(train).at(s) && (s_prev == 0u || !d.net.unpreferred.at(train).at(s_prev));
+}
+
+auto safe_interval_planner::stay_cost(unsigned int s, unsigned int from, unsigned int to) const -> double {
+    auto c = d.pri.delay.at(d.trn.type.at(train)) * (to - from);
+    
+    // The unpreferred price is paid for every time interval spent in the segment, up to the last but one of the time horizon
+    if(d.net.unpreferred.at(train).at(s) && from < d.ni) {
+        c += d.pri.unpreferred * (std::min(to, d.ni) - from);
+    }
+    
+    return c;
+}
+
+auto safe_interval_planner::exit_cost(unsigned int s, unsigned int t, unsigned int s_next) const -> double {
+    const auto i = train;
+    auto c = 0.0;
+    
+    for(auto n = 0u; n < d.trn.sa_num.at(i); n++) {
+        const auto& segs = d.trn.sa_segs.at(i).at(n);
+        auto threshold = d.trn.sa_times.at(i).at(n) + d.tiw.sa_right + 1;
+        
+        if(t >= threshold && std::find(segs.begin(), segs.end(), s) != segs.end()) {
+            c += d.pri.sa * (t - threshold);
+        }
+    }
+    
+    if(s_next == d.ns + 1) {
+        auto want = static_cast<int>(d.trn.want_time.at(i));
+        auto it = static_cast<int>(t);
+        
+        if(it < want - static_cast<int>(d.tiw.wt_left)) {
+            c += d.pri.wt * (want - static_cast<int>(d.tiw.wt_left) - it);
+        }
+        
+        if(it > want + static_cast<int>(d.tiw.wt_right) + 1) {
+            c += d.pri.wt * (it - want - static_cast<int>(d.tiw.wt_right) - 1);
+        }
+    }
+    
+    return c;
+}
+
+auto safe_interval_planner::lower_bound(unsigned int s, unsigned int t) const -> double {
+    const auto i = train;
+    const auto delay_price = d.pri.delay.at(d.trn.type.at(i));
+    
+    // Either the train stays in the network until the end of the time horizon, spending at most max_time_to_go
+    // at minimum travel time, or it reaches tau not before min_time_to_go
+    auto escape = delay_price * std::max(0, static_cast<int>(d.ni + 1) - static_cast<int>(t + max_time_to_go.at(s)));
+    
+    if(min_time_to_go.at(s) == std::numeric_limits<unsigned int>::max() || t + min_time_to_go.at(s) - 1 > d.ni) {
+        return escape;
+    }
+    
+    auto arrival = static_cast<int>(t + min_time_to_go.at(s) - 1);
+    auto window_end = static_cast<int>(d.trn.want_time.at(i) + d.tiw.wt_right) + 1;
+    auto late = d.pri.wt * std::max(0, arrival - window_end);
+    
+    return std::min(escape, late);
+}
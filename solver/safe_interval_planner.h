@@ -0,0 +1,102 @@
+#ifndef SAFE_INTERVAL_PLANNER_H
+#define SAFE_INTERVAL_PLANNER_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/occupancy.h>
+#include <data/path.h>
+
+#include <boost/optional.hpp>
+
+/*! \brief This class finds the cheapest path of a single train around the trains already in an occupancy table, without
+ *  using the time-expanded graph. For each segment, it only considers the safe intervals, i.e. the maximal sets of consecutive
+ *  time intervals during which the train can be in the segment respecting the headway with the other trains and the MOWs.
+ *  An A* search runs over (segment, safe interval) pairs, entering each interval as early as possible; a label is only
+ *  discarded when another label in the same interval can wait until its time at a lower cost. The cost of a path is the
+ *  same the MIP solver would give it, and the lower bounds only use the minimum travel times of the train.
+ */
+struct safe_interval_planner {
+    /*! \brief A safe interval: the train can be in the segment at any time in [from, to] */
+    struct interval {
+        /*! First time interval */
+        unsigned int from;
+        
+        /*! Last time interval */
+        unsigned int to;
+        
+        /*! Basic constructor */
+        interval(unsigned int from, unsigned int to) : from{from}, to{to} {}
+    };
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Id of the train */
+    unsigned int train;
+    
+    /*! Reference to the table of the trains already scheduled */
+    const occupancy& occ;
+    
+    /*! Cost of the last path found by plan() */
+    double cost;
+    
+    /*! Number of labels created by the last search */
+    unsigned int n_labels;
+    
+    /*! Basic constructor */
+    safe_interval_planner(const data& d, unsigned int train, const occupancy& occ);
+    
+    /*! Returns the cheapest path of the train, which must start at sigma and end at tau, or boost::none if there is none */
+    auto plan() -> boost::optional<bv<path::node>>;
+    
+    /*! Same as plan(), but the path keeps the nodes of old_p entered up to time now, and enters no other segment before then:
+     *  the search starts from the segment the train is in at that time. If old_p is empty, this is the same as plan() */
+    auto plan_from(const bv<path::node>& old_p, unsigned int now) -> boost::optional<bv<path::node>>;
+
+private:
+    
+    /*! A train entering segment seg at time t, in its interval-th safe interval, with the given cost before entering it */
+    struct label {
+        unsigned int seg;
+        unsigned int interval;
+        unsigned int t;
+        double cost;
+        unsigned int parent;
+        bool dead;
+    };
+    
+    /*! Indexed over s, the segments the train can move to from s (including tau when s is a destination segment) */
+    uint_matrix_2d next;
+    
+    /*! Indexed over s, minimum time needed to go from the entry in s to the arrival at tau */
+    uint_vector min_time_to_go;
+    
+    /*! Indexed over s, maximum time the train can spend at minimum travel time in s and the segments after it */
+    uint_vector max_time_to_go;
+    
+    /*! Indexed over s, the safe intervals of s, computed the first time they are needed */
+    bv<bv<interval>> safe;
+    
+    /*! Indexed over s, tells wether the safe intervals of s have been computed */
+    bool_vector safe_ready;
+    
+    /*! Indexed over s, the times at which entering s lets the train leave it exactly when something cheaper becomes possible,
+     *  e.g. when a safe interval of the next segment starts; computed the first time they are needed */
+    uint_matrix_2d jit_entries;
+    
+    /*! Indexed over s, tells wether the just-in-time entries of s have been computed */
+    bool_vector jit_ready;
+    
+    auto usable(unsigned int s) const -> bool;
+    auto intervals(unsigned int s) -> const bv<interval>&;
+    auto can_enter(unsigned int s, unsigned int t) const -> bool;
+    auto first_entry(unsigned int s, unsigned int from, unsigned int to) const -> boost::optional<unsigned int>;
+    auto just_in_time(unsigned int s) -> const uint_vector&;
+    auto costlier_wait(unsigned int s_prev, unsigned int s) const -> bool;
+    auto entries(unsigned int s_prev, unsigned int s, unsigned int from, unsigned int to) -> uint_vector;
+    auto stay_cost(unsigned int s, unsigned int from, unsigned int to) const -> double;
+    auto exit_cost(unsigned int s, unsigned int t, unsigned int s_next) const -> double;
+    auto lower_bound(unsigned int s, unsigned int t) const -> double;
+};
+
+#endif
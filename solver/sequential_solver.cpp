@@ -1,9 +1,52 @@
 #include <solver/sequential_solver.h>
+#include <data/occupancy.h>
+#include <data/schedule_evaluator.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
+#include <solver/safe_interval_planner.h>
 #include <solver/solver.h>
 
+#if USE_GRAPHER
+    #include <grapher/grapher.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace {
+    // Serialises the output of orderings evaluated in parallel
+    std::mutex output_mutex;
+}
+
+auto sequential_solver::ordering_result::is_better_than(const ordering_result& other) const -> bool {
+    return (n_scheduled > other.n_scheduled || (n_scheduled == other.n_scheduled && cost < other.cost));
+}
 
 auto sequential_solver::solve_sequentially() -> boost::optional<bv<path>> {
+    if(d.p.sequential.portfolio.active) {
+        return solve_with_portfolio();
+    }
+    
+    auto order = uint_vector(d.nt);
+    std::iota(order.begin(), order.end(), 0u);
+    
+    return solve_sequentially(order);
+}
+
+auto sequential_solver::solve_sequentially(const uint_vector& order) -> boost::optional<bv<path>> {
+    return solve_ordering(order, d.p.cplex.threads, false);
+}
+
+auto sequential_solver::solve_ordering(const uint_vector& order, unsigned int cplex_threads, bool quiet) -> boost::optional<bv<path>> {
+    assert(order.size() == d.nt);
+    
     auto trains_to_schedule = uint_vector();
     auto paths = bv<path>();
     
@@ -11,23 +54,62 @@ auto sequential_solver::solve_sequentially() -> boost::optional<bv<path>> {
         paths.push_back(path(d, i));
     }
     
-    for(auto i = 0u; i < d.nt; i++) {
+    for(auto k = 0u; k < order.size(); k++) {
+        auto i = order.at(k);
+        
+        if(anytime::expired()) {
+            {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << "SEQUENTIAL_SOLVER >> Out of time: the remaining trains are scheduled by the safe-interval planner" << std::endl;
+            }
+            
+            complete_with_planner(paths, uint_vector(order.begin() + k, order.end()));
+            break;
+        }
+        
+        profiler::span iteration("sequential/iteration", i);
+        
         auto local_d = d;
         
         trains_to_schedule.push_back(i);
         paths.at(i).make_empty();
         
-        std::cout << "SEQUENTIAL_SOLVER >> Trains to schedule: ";
-        std::copy(trains_to_schedule.begin(), trains_to_schedule.end(), std::ostream_iterator<unsigned int>(std::cout, " "));
-        std::cout << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << "SEQUENTIAL_SOLVER >> Trains to schedule: ";
+            std::copy(trains_to_schedule.begin(), trains_to_schedule.end(), std::ostream_iterator<unsigned int>(std::cout, " "));
+            std::cout << std::endl;
+        }
         
         local_d.gr.only_trains(trains_to_schedule, d.nt, d.ns, d.ni);
         constrain_graph_by_paths(local_d.gr, paths);
         
         auto s = solver(local_d);
+        auto n = static_cast<double>(order.size());
+        
+        s.threads = cplex_threads;
+        s.quiet = quiet;
+        
+        // Each model has one more train than the previous one, so it gets a proportionally larger share of the time left
+        s.time_limit = anytime::step_time(s.time_limit, k + 1.0, (n * (n + 1.0) - k * (k + 1.0)) / 2.0);
+        
         auto p_sol = s.solve();
+        auto completed = false;
+        
+        if(!p_sol && anytime::is_limited()) {
+            // Most likely the model ran out of time: a complete schedule at the deadline is worth more than an optimal one after it
+            complete_with_planner(paths, uint_vector(order.begin() + k, order.end()));
+            completed = true;
+        }
         
-        if(p_sol) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        
+        if(completed) {
+            std::cout << "SEQUENTIAL_SOLVER >> Trains ";
+            std::copy(order.begin() + k, order.end(), std::ostream_iterator<unsigned int>(std::cout, " "));
+            std::cout << "completed by the planner after the time budget" << std::endl;
+            break;
+        } else if(p_sol) {
             paths = *p_sol;
             std::cout << "SEQUENTIAL_SOLVER >> Paths: "<< std::endl;
             for(const auto& p : paths) {
@@ -36,7 +118,7 @@ auto sequential_solver::solve_sequentially() -> boost::optional<bv<path>> {
                 }
             }
         } else {
-            if(i > 0u) {
+            if(trains_to_schedule.size() > 1u) {
                 std::cout << "SEQUENTIAL_SOLVER >> Scheduled trains: ";
                 std::copy(trains_to_schedule.begin(), trains_to_schedule.end() - 1, std::ostream_iterator<unsigned int>(std::cout, " "));
                 std::cout << "- Could not schedule train: " << i << std::endl;
@@ -55,6 +137,186 @@ auto sequential_solver::solve_sequentially() -> boost::optional<bv<path>> {
     return paths;
 }
 
+auto sequential_solver::complete_with_planner(bv<path>& paths, const uint_vector& trains) const -> void {
+    auto occ = occupancy(d);
+    
+    for(const auto& p : paths) {
+        if(!p.is_empty() && !p.is_dummy()) {
+            occ.reserve(p.train, p.p);
+        }
+    }
+    
+    for(auto i : trains) {
+        auto planner = safe_interval_planner(d, i, occ);
+        auto nodes = planner.plan();
+        
+        if(!nodes) {
+            paths.at(i) = path(d, i);
+            continue;
+        }
+        
+        occ.reserve(i, *nodes);
+        paths.at(i) = path(d, i, *nodes, planner.cost);
+    }
+}
+
+auto sequential_solver::solve_with_portfolio() -> boost::optional<bv<path>> {
+    auto t_start = std::chrono::steady_clock::now();
+    auto results = make_orderings();
+    std::atomic<unsigned int> next(0u);
+    
+    // The orderings evaluated at the same time share the CPLEX threads, and only the best one writes its output files
+    auto n_threads = std::max(1u, std::min(d.p.sequential.portfolio.threads, static_cast<unsigned int>(results.size())));
+    auto cplex_threads = std::max(1u, d.p.cplex.threads / n_threads);
+    
+    // Each ordering works on its own copies of the graph, so they can be evaluated independently
+    auto worker = [&] () {
+        for(auto k = next++; k < results.size(); k = next++) {
+            auto& res = results.at(k);
+            auto paths = solve_ordering(res.order, cplex_threads, true);
+            
+            if(paths) {
+                res.paths = *paths;
+                
+                for(const auto& p : res.paths) {
+                    if(!p.is_empty() && !p.is_dummy()) {
+                        res.n_scheduled++;
+                        res.cost += p.cost;
+                    }
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << "SEQUENTIAL_SOLVER >> Ordering " << res.strategy << ": " << res.n_scheduled << "/" << d.nt << " trains scheduled, cost: " << res.cost << std::endl;
+        }
+    };
+    
+    auto threads = std::vector<std::thread>();
+    
+    for(auto n = 0u; n < n_threads; n++) {
+        threads.emplace_back(worker);
+    }
+    
+    for(auto& t : threads) {
+        t.join();
+    }
+    
+    auto best = std::min_element(results.begin(), results.end(),
+        [] (const ordering_result& r1, const ordering_result& r2) { return r1.is_better_than(r2); }
+    );
+    
+    if(best == results.end() || best->paths.empty()) {
+        return boost::none;
+    }
+    
+    std::cout << "SEQUENTIAL_SOLVER >> Best ordering: " << best->strategy << " (";
+    std::copy(best->order.begin(), best->order.end(), std::ostream_iterator<unsigned int>(std::cout, " "));
+    std::cout << "), " << best->n_scheduled << "/" << d.nt << " trains scheduled, cost: " << best->cost << std::endl;
+    
+    print_results(*best, n_threads * cplex_threads, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    
+    return best->paths;
+}
+
+auto sequential_solver::print_results(const ordering_result& best, unsigned int threads, double seconds) const -> void {
+    auto evaluation = schedule_evaluator(d).evaluate(best.paths);
+    auto row = results::row("portfolio", d, threads);
+    
+    row.add("strategy", best.strategy)
+       .add("scheduled", best.n_scheduled)
+       .add("time_total", seconds)
+       .add("upper_bound", best.cost)
+       .add(evaluation.objective)
+       .add("violations", evaluation.violations.size())
+       .add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
+    
+    for(const auto& p : best.paths) {
+        p.print_summary(std::cerr);
+    }
+    
+    #if USE_GRAPHER
+        profiler::span phase("grapher/write_graph");
+        
+        auto ger = grapher(d, best.paths);
+        ger.write_graph();
+    #endif
+}
+
+auto sequential_solver::make_orderings() const -> bv<ordering_result> {
+    auto results = bv<ordering_result>();
+    auto index_order = uint_vector(d.nt);
+    std::iota(index_order.begin(), index_order.end(), 0u);
+    
+    auto add_ordering = [&] (std::string strategy, uint_vector order) {
+        // Different strategies often agree, and there is no point in evaluating the same ordering twice
+        auto same_order = [&] (const ordering_result& r) { return r.order == order; };
+        
+        if(std::none_of(results.begin(), results.end(), same_order)) {
+            results.push_back(ordering_result(strategy, order));
+        }
+    };
+    
+    auto sorted_by = [&] (auto cmp) {
+        auto order = index_order;
+        std::stable_sort(order.begin(), order.end(), cmp);
+        return order;
+    };
+    
+    // Slack between the earliest possible arrival and the want time at the arrival terminal
+    auto slack = [&] (unsigned int i) {
+        return static_cast<long>(d.trn.want_time.at(i)) - static_cast<long>(d.gr.first_time_we_need_tau.at(i));
+    };
+    
+    add_ordering("index", index_order);
+    
+    add_ordering("priority", sorted_by([&] (unsigned int i, unsigned int j) {
+        return std::make_pair(d.trn.type.at(i), d.trn.entry_time.at(i)) < std::make_pair(d.trn.type.at(j), d.trn.entry_time.at(j));
+    }));
+    
+    add_ordering("entry_time", sorted_by([&] (unsigned int i, unsigned int j) {
+        return std::make_pair(d.trn.entry_time.at(i), d.trn.type.at(i)) < std::make_pair(d.trn.entry_time.at(j), d.trn.type.at(j));
+    }));
+    
+    add_ordering("slack", sorted_by([&] (unsigned int i, unsigned int j) {
+        return slack(i) < slack(j);
+    }));
+    
+    auto by_entry_time = sorted_by([&] (unsigned int i, unsigned int j) {
+        return d.trn.entry_time.at(i) < d.trn.entry_time.at(j);
+    });
+    auto eastbound = uint_vector();
+    auto westbound = uint_vector();
+    
+    for(auto i : by_entry_time) {
+        (d.trn.is_eastbound.at(i) ? eastbound : westbound).push_back(i);
+    }
+    
+    auto alternate = uint_vector();
+    
+    for(auto k = 0u; k < std::max(eastbound.size(), westbound.size()); k++) {
+        if(k < eastbound.size()) {
+            alternate.push_back(eastbound.at(k));
+        }
+        if(k < westbound.size()) {
+            alternate.push_back(westbound.at(k));
+        }
+    }
+    
+    add_ordering("alternate_directions", alternate);
+    
+    for(auto k = 0u; k < d.p.sequential.portfolio.random_restarts; k++) {
+        auto order = index_order;
+        auto mt = std::mt19937(d.p.sequential.portfolio.seed + k);
+        
+        std::shuffle(order.begin(), order.end(), mt);
+        add_ordering("random_" + std::to_string(k), order);
+    }
+    
+    return results;
+}
+
 auto sequential_solver::constrain_graph_by_paths(graph& gr, const bv<path>& paths) -> void {
     assert(paths.size() == d.nt);
 
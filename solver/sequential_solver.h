@@ -8,13 +8,49 @@
 
 #include <boost/optional.hpp>
 
+#include <string>
+
 /*! \brief This class represents a solver that schedules the trains sequentially */
 struct sequential_solver {
+    /*! \brief This struct packs the outcome of scheduling the trains in a certain order */
+    struct ordering_result {
+        /*! Name of the strategy that generated the ordering */
+        std::string strategy;
+        
+        /*! Order in which the trains were scheduled */
+        uint_vector order;
+        
+        /*! Paths found */
+        bv<path> paths;
+        
+        /*! Number of trains that could be scheduled */
+        unsigned int n_scheduled;
+        
+        /*! Total cost of the paths */
+        double cost;
+        
+        /*! Basic constructor */
+        ordering_result(std::string strategy, uint_vector order) : strategy{strategy}, order{order}, n_scheduled{0u}, cost{0.0} {}
+        
+        /*! Tells wether this result is better than the other, i.e. schedules more trains or the same number of trains at a lower cost */
+        auto is_better_than(const ordering_result& other) const -> bool;
+    };
+    
     const data& d;
     
-    /*! Schedule the trains one by one */
+    /*! Schedule the trains one by one, either in index order or trying a portfolio of orderings, depending on the params */
     virtual auto solve_sequentially() -> boost::optional<bv<path>>;
     
+    /*! Schedule the trains one by one, in the given order. Each MIP gets a share of the time left in the current phase of the
+     *  wall-clock budget; once the budget is over, or if a MIP fails while a budget is enforced, the trains left are scheduled
+     *  by the safe-interval planner around the others.
+     */
+    auto solve_sequentially(const uint_vector& order) -> boost::optional<bv<path>>;
+    
+    /*! Schedule the trains according to several ordering strategies, evaluated in parallel, and keep the best solution. The
+     *  orderings share the CPLEX threads and write no output files: the results and the graph are only written for the best one */
+    auto solve_with_portfolio() -> boost::optional<bv<path>>;
+    
     /*! Remove all arcs incompatible with the paths */
     auto constrain_graph_by_paths(graph& gr, const bv<path>& paths) -> void;
     
@@ -23,8 +59,12 @@ struct sequential_solver {
     
 private:
     
+    auto solve_ordering(const uint_vector& order, unsigned int cplex_threads, bool quiet) -> boost::optional<bv<path>>;
+    auto make_orderings() const -> bv<ordering_result>;
+    auto complete_with_planner(bv<path>& paths, const uint_vector& trains) const -> void;
     auto fix_path_for(graph& gr, const path& p) -> void;
     auto remove_incompatible(graph& gr, unsigned int j, const path& p) -> void;
+    auto print_results(const ordering_result& best, unsigned int threads, double seconds) const -> void;
 };
 
 #endif
@@ -1,4 +1,9 @@
 #include <solver/solver.h>
+#include <data/schedule_evaluator.h>
+#include <profiler/memory.h>
+#include <profiler/profiler.h>
+#include <profiler/results.h>
+#include <solver/anytime.h>
 
 #if USE_GRAPHER
     #include <grapher/grapher.h>
@@ -10,8 +15,16 @@
 #include <sstream>
 #include <thread>
 #include <limits>
+#include <mutex>
+
+namespace {
+    // Several solvers can run in parallel (e.g. when evaluating a portfolio of orderings) and they all write to the same files
+    std::mutex files_mutex;
+}
 
 auto solver::solve() -> boost::optional<bv<path>> {
+    profiler::span phase("solver/solve");
+    
     using namespace std::chrono;
     
     auto t_start = high_resolution_clock::time_point();
@@ -28,24 +41,50 @@ auto solver::solve() -> boost::optional<bv<path>> {
     var_matrix_4d var_x(env, d.nt);
     var_matrix_2d var_excess_travel_time(env, d.nt);
     
+    auto model_size = memory::model_estimate(d);
+    auto graph_bytes = memory::graph_bytes(d.gr);
+    
+    if(d.p.memory.budget_mb > 0u && graph_bytes + model_size.bytes > memory::megabytes(d.p.memory.budget_mb)) {
+        std::cerr << "solver.cpp::solve() \t The model would have " << model_size.columns << " columns and " << model_size.rows << " rows, ";
+        std::cerr << "which do not fit in the memory budget of " << d.p.memory.budget_mb << " MB" << std::endl;
+        env.end();
+        return boost::none;
+    }
+    
     create_model(env, model, var_x, var_excess_travel_time);
-
+    memory::checkpoint("model/build", graph_bytes + model_size.bytes);
+    
     IloCplex cplex(model);
-
-    cplex.exportModel("model.lp");
-    cplex.setParam(IloCplex::TiLim, d.p.cplex.time_limit);
-    cplex.setParam(IloCplex::Threads, d.p.cplex.threads);
+    
+    if(!quiet) {
+        std::lock_guard<std::mutex> lock(files_mutex);
+        cplex.exportModel("model.lp");
+    }
+    
+    cplex.setParam(IloCplex::TiLim, std::min(time_limit, anytime::time_left()));
+    cplex.setParam(IloCplex::Threads, threads);
     cplex.setParam(IloCplex::NodeLim, 0);
+    
+    #if USE_INTEGER_COSTS
+        // The objective's coefficients are whole cents and all the variables are integer: a better solution is better by at least one cent
+        cplex.setParam(IloCplex::ObjDif, 0.999);
+    #endif
+    
     cplex.setOut(env.getNullStream());
-
+    
     t_start = high_resolution_clock::now();
     
-    auto success_at_root_node = cplex.solve();
+    auto success_at_root_node = false;
+    
+    {
+        profiler::span phase("cplex/root");
+        success_at_root_node = cplex.solve();
+    }
     
     t_end = high_resolution_clock::now();
     time_span = duration_cast<duration<double>>(t_end - t_start);
     t.cplex_at_root = time_span.count();
-
+    
     // Check that CPLEX gives a negative status at root, but not just because it couldn't find a feasible solution.
     // In fact, we want to stop only if the problem is proven infeasible.
     // Not having found a feasible solution is ok, we can still find it later.
@@ -54,6 +93,7 @@ auto solver::solve() -> boost::optional<bv<path>> {
         std::cerr << "bc_solver.cpp::solve() \t CPLEX status: " << cplex.getStatus() << std::endl;
         std::cerr << "bc_solver.cpp::solve() \t CPLEX ext status: " << cplex.getCplexStatus() << std::endl;
         
+        std::lock_guard<std::mutex> lock(files_mutex);
         cplex.exportModel("model_err.lp");
         return boost::none;
     }
@@ -67,14 +107,21 @@ auto solver::solve() -> boost::optional<bv<path>> {
     }
     
     cplex.setParam(IloCplex::NodeLim, 2100000000);
+    cplex.setParam(IloCplex::TiLim, std::max(0.0, std::min(time_limit - t.cplex_at_root, anytime::time_left())));
     
     t_start = high_resolution_clock::now();
     
-    auto success_at_later_node = cplex.solve();
+    auto success_at_later_node = false;
+    
+    {
+        profiler::span phase("cplex/tree");
+        success_at_later_node = cplex.solve();
+    }
     
     t_end = high_resolution_clock::now();
     time_span = duration_cast<duration<double>>(t_end - t_start);
     t.cplex_total = t.cplex_at_root + time_span.count();
+    memory::checkpoint("cplex/solve", graph_bytes + model_size.bytes);
     
     if(!success_at_later_node) {
         std::cerr << "Cplex infeasible at later node: " << cplex.getStatus() << " - " << cplex.getCplexStatus() << std::endl;
@@ -88,14 +135,19 @@ auto solver::solve() -> boost::optional<bv<path>> {
             ub_at_end = std::numeric_limits<double>::max();
         }
         
-        std::cerr << "Cplex UB value: " << ub_at_end << std::endl;
+        if(!quiet) {
+            std::cerr << "Cplex UB value: " << ub_at_end << std::endl;
+        }
     }
     
     auto paths = make_paths(env, cplex, var_x, var_excess_travel_time);
     
-    print_results(ub_at_root, ub_at_end, lb_at_root, lb_at_end);
-    print_summary(paths);
-    print_graph(paths);
+    if(!quiet) {
+        std::lock_guard<std::mutex> lock(files_mutex);
+        print_results(paths, ub_at_root, ub_at_end, lb_at_root, lb_at_end);
+        print_summary(paths);
+        print_graph(paths);
+    }
     
     env.end();
     
@@ -103,9 +155,11 @@ auto solver::solve() -> boost::optional<bv<path>> {
 }
 
 auto solver::make_paths(IloEnv& env, IloCplex& cplex, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> bv<path> {
+    profiler::span phase("solver/make_paths");
+    
     auto x = uint_matrix_4d(d.nt, uint_matrix_3d(d.ns + 2, uint_matrix_2d(d.ni + 2, uint_vector(d.ns + 2, 0u))));
     auto paths = bv<path>();
-
+    
     for(auto i = 0u; i < d.nt; i++) {
         auto cost = 0.0;
         
@@ -140,30 +194,38 @@ auto solver::print_summary(const bv<path>& paths) const -> void {
 
 auto solver::print_graph(const bv<path>& paths) const -> void {
     #if USE_GRAPHER
+        profiler::span phase("grapher/write_graph");
+        
         auto ger = grapher(d, paths);
         ger.write_graph();
     #endif
 }
 
-auto solver::print_results(double ub_at_root, double ub_at_end, double lb_at_root, double lb_at_end) const -> void {
-    std::ofstream results_file;
-    results_file.open(d.p.results_file, std::ios::out | std::ios::app);
-    
-    results_file << d.ins.file_name << "\t";
-    results_file << t.variable_creation << "\t";
-    results_file << t.constraints_creation << "\t";
-    results_file << t.objf_creation << "\t";
-    results_file << t.cplex_at_root << "\t";
-    results_file << t.cplex_total << "\t";
-    results_file << ub_at_root << "\t";
-    results_file << ub_at_end << "\t";
-    results_file << lb_at_root << "\t";
-    results_file << lb_at_end << std::endl;
-    
-    results_file.close();
+auto solver::print_results(const bv<path>& paths, double ub_at_root, double ub_at_end, double lb_at_root, double lb_at_end) const -> void {
+    // Bounds which were never found are stored as the largest double, and are written as missing values
+    auto bound = [] (double value) { return (value < std::numeric_limits<double>::max() ? value : std::numeric_limits<double>::quiet_NaN()); };
+    auto evaluation = schedule_evaluator(d).evaluate(paths);
+    auto row = results::row("mip", d, threads);
+    
+    row.add("time_variables", t.variable_creation)
+       .add("time_constraints", t.constraints_creation)
+       .add("time_objective_function", t.objf_creation)
+       .add("time_cplex_at_root", t.cplex_at_root)
+       .add("time_cplex_total", t.cplex_total)
+       .add("ub_at_root", bound(ub_at_root))
+       .add("ub_at_end", bound(ub_at_end))
+       .add("lb_at_root", bound(lb_at_root))
+       .add("lb_at_end", bound(lb_at_end))
+       .add(evaluation.objective)
+       .add("violations", evaluation.violations.size())
+       .add_profiler_totals();
+    
+    results::append(d.p.results_file, row);
 }
 
 auto solver::create_variables(IloEnv& env, IloModel& model, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/variables");
+    
     std::stringstream name;
     
     for(auto i = 0u; i < d.nt; i++) {        
@@ -192,6 +254,8 @@ auto solver::create_variables(IloEnv& env, IloModel& model, var_matrix_4d& var_x
 }
 
 auto solver::create_constraints_exit_sigma(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_exit_sigma");
+    
     cst_vector cst_exit_sigma(env, d.nt);
     std::stringstream name;
     
@@ -215,11 +279,13 @@ auto solver::create_constraints_exit_sigma(IloEnv& env, IloModel& model, var_mat
         cst_exit_sigma[i] = IloRange(env, 1, expr, 1, name.str().c_str());
         expr.end();
     }
-    
+   
    model.add(cst_exit_sigma);
 }
 
 auto solver::create_constraints_enter_tau(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_enter_tau");
+    
     cst_vector cst_enter_tau(env, d.nt);
     std::stringstream name;
     
@@ -254,6 +320,8 @@ auto solver::create_constraints_enter_tau(IloEnv& env, IloModel& model, var_matr
 }
 
 auto solver::create_constraints_flow(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_flow");
+    
     cst_matrix_3d cst_flow(env, d.nt);
     std::stringstream name;
     
@@ -299,6 +367,8 @@ auto solver::create_constraints_flow(IloEnv& env, IloModel& model, var_matrix_4d
 }
 
 auto solver::create_constraints_max_one_train(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_max_one_train");
+    
     cst_matrix_2d cst_max_one_train(env, d.ns + 2);
     std::stringstream name;
     
@@ -326,6 +396,8 @@ auto solver::create_constraints_max_one_train(IloEnv& env, IloModel& model, var_
 }
 
 auto solver::create_constraints_set_excess_travel_time(IloEnv& env, IloModel& model, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/constraints_set_excess_travel_time");
+    
     cst_matrix_2d cst_set_excess_travel_time(env, d.nt);
     std::stringstream name;
     
@@ -370,10 +442,14 @@ auto solver::create_constraints_set_excess_travel_time(IloEnv& env, IloModel& mo
 }
 
 auto solver::create_constraints_min_travel_time(IloEnv& env, IloModel& model, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/constraints_min_travel_time");
+    
     // var_excess_travel_time >= 0 already implies min travel time constraints are respected
 }
 
 auto solver::create_constraints_headway_1(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_headway_1");
+    
     cst_matrix_2d cst_headway_1(env, d.ns + 2);
     std::stringstream name;
     
@@ -383,7 +459,7 @@ auto solver::create_constraints_headway_1(IloEnv& env, IloModel& model, var_matr
         for(auto t = 1u; t <= d.ni; t++) {
             name.str(""); name << "cst_headway1_" << s << "_" << t;
             IloExpr expr(env);
-                        
+            
             auto min_time = static_cast<unsigned int>(std::max(1, static_cast<int>(t - d.headway)));
             
             for(auto i = 0u; i < d.nt; i++) {
@@ -395,7 +471,7 @@ auto solver::create_constraints_headway_1(IloEnv& env, IloModel& model, var_matr
                     }
                 }
             }
-                        
+            
             cst_headway_1[s][t] = IloRange(env, -IloInfinity, expr, 1, name.str().c_str());
             expr.end();
         }
@@ -405,9 +481,11 @@ auto solver::create_constraints_headway_1(IloEnv& env, IloModel& model, var_matr
 }
 
 auto solver::create_constraints_headway_2(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_headway_2");
+    
     cst_matrix_2d cst_headway_2(env, d.ns + 2);
     std::stringstream name;
-        
+    
     for(auto s = 1u; s <= d.ns; s++) {
         cst_headway_2[s] = cst_vector(env, d.ni + 2);
         
@@ -423,7 +501,7 @@ auto solver::create_constraints_headway_2(IloEnv& env, IloModel& model, var_matr
                         expr += var_x[i][ss][t-1][s];
                     }
                 }
-                                
+                
                 for(auto ss : d.gr.bar_delta[i][s]) {
                     for(auto tt = min_time; tt < t; tt++) {
                         if(d.gr.adj[i][s][tt][ss]) {
@@ -442,25 +520,27 @@ auto solver::create_constraints_headway_2(IloEnv& env, IloModel& model, var_matr
 }
 
 auto solver::create_constraints_headway_3(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_headway_3");
+    
     cst_matrix_2d cst_headway_3(env, d.ns + 2);
     std::stringstream name;
-
+    
     for(auto s = 1u; s <= d.ns; s++) {
         cst_headway_3[s] = cst_vector(env, d.ni + 2);
-
+        
         for(auto t = 1u; t <= d.ni; t++) {
             name.str(""); name << "cst_headway3_" << s << "_" << t;
             IloExpr expr(env);
             
             auto max_time = std::min(d.ni + 1, t + d.headway);
-
+            
             for(auto i = 0u; i < d.nt; i++) {
                 for(auto ss : d.gr.bar_delta[i][s]) {
                     if(d.gr.adj[i][s][t][ss]) {
                         expr += var_x[i][s][t][ss];
                     }
                 }
-
+                
                 // Escape arcs
                 if( t == d.ni && // If it's the last time interval
                     d.gr.adj[i][s][d.ni][d.ns+1] && // And s is connected to tau
@@ -468,7 +548,7 @@ auto solver::create_constraints_headway_3(IloEnv& env, IloModel& model, var_matr
                 ) {
                     expr += var_x[i][s][d.ni][d.ns+1];
                 }
-
+                
                 for(auto ss : d.gr.bar_inverse_delta[i][s]) {
                     for(auto tt = t + 1; tt <= max_time; tt++) {
                         if(d.gr.adj[i][ss][tt-1][s]) {
@@ -481,12 +561,14 @@ auto solver::create_constraints_headway_3(IloEnv& env, IloModel& model, var_matr
             cst_headway_3[s][t] = IloRange(env, -IloInfinity, expr, 1, name.str().c_str());
             expr.end();
         }
-
+        
         model.add(cst_headway_3[s]);
     }
 }
 
 auto solver::create_constraints_siding(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_siding");
+    
     cst_matrix_3d cst_siding(env, d.nt);
     std::stringstream name;
     
@@ -533,29 +615,31 @@ auto solver::create_constraints_siding(IloEnv& env, IloModel& model, var_matrix_
 }
 
 auto solver::create_constraints_heavy(IloEnv& env, IloModel& model, var_matrix_4d& var_x) -> void {
+    profiler::span phase("model/constraints_heavy");
+    
     cst_matrix_3d cst_heavy(env, d.nt);
     std::stringstream name;
     
     for(auto i = 0u; i < d.nt; i++) {
         if(d.trn.is_heavy[i]) {
             cst_heavy[i] = cst_matrix_2d(env, d.ns + 2);
-        
+            
             for(auto s : d.net.sidings) {
                 cst_heavy[i][s] = cst_vector(env, d.ni + 2);
-            
+                
                 for(auto t = 1u; t <= d.ni; t++) {
                     name.str(""); name << "cst_heavy_" << i << "_" << s << "_" << t;
                     IloExpr expr(env);
                     
                     auto min_time = static_cast<unsigned int>(std::max(1, static_cast<int>(t - d.headway)));
                     auto max_time = std::min(d.ni + 1, t + d.headway);
-                
+                    
                     for(auto ss : d.gr.bar_inverse_delta[i][s]) {
                         if(d.gr.adj[i][ss][t-1][s]) {
                             expr += var_x[i][ss][t-1][s];
                         }
                     }
-                
+                    
                     for(auto j = 0u; j < d.nt; j++) {
                         if(!d.trn.is_sa[j] && j != i) {
                             for(auto tt = min_time; tt <= max_time; tt++) {
@@ -573,7 +657,7 @@ auto solver::create_constraints_heavy(IloEnv& env, IloModel& model, var_matrix_4
                     cst_heavy[i][s][t] = IloRange(env, -IloInfinity, expr, 1, name.str().c_str());
                     expr.end();
                 }
-            
+                
                 model.add(cst_heavy[i][s]);
             }
         }
@@ -581,6 +665,8 @@ auto solver::create_constraints_heavy(IloEnv& env, IloModel& model, var_matrix_4
 }
 
 auto solver::create_constraints_cant_stop(IloEnv& env, IloModel& model, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/constraints_cant_stop");
+    
     // This constraint is equivalent to setting var_excess_travel_time = 0 on x-overs
     for(auto i = 0u; i < d.nt; i++) {
         for(auto s : d.net.xovers) {
@@ -590,8 +676,10 @@ auto solver::create_constraints_cant_stop(IloEnv& env, IloModel& model, var_matr
 }
 
 auto solver::create_objective_function(IloEnv& env, IloModel& model, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/objective");
+    
     IloExpr expr(env);
-
+    
     for(auto i = 0u; i < d.nt; i++) {
         for(auto s = 1u; s <= d.ns; s++) {
             expr += d.pri.delay[d.trn.type[i]] * var_excess_travel_time[i][s];
@@ -612,12 +700,14 @@ auto solver::create_objective_function(IloEnv& env, IloModel& model, var_matrix_
     IloRange cst_positive_obj(env, 0, expr, IloInfinity, "cst_positive_obj");
     
     expr.end();
-
+    
     model.add(obj);
     model.add(cst_positive_obj);
 }
 
 auto solver::create_model(IloEnv& env, IloModel& model, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> void {
+    profiler::span phase("model/build");
+    
     using namespace std::chrono;
     
     auto t_start = high_resolution_clock::time_point();
@@ -629,7 +719,7 @@ auto solver::create_model(IloEnv& env, IloModel& model, var_matrix_4d& var_x, va
     t_start = high_resolution_clock::now();
     create_variables(env, model, var_x, var_excess_travel_time);
     t_end = high_resolution_clock::now();
-
+    
     time_span = duration_cast<duration<double>>(t_end - t_start);
     t.variable_creation = time_span.count();
     
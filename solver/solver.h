@@ -35,9 +35,19 @@ struct solver {
     
     /*! Timing data */
     times t;
+    
+    /*! Seconds CPLEX may spend on the model, root node included; never more than what is left of the wall-clock budget */
+    double time_limit;
+    
+    /*! If true, the solver only returns the paths: it writes no model file, results row, summary or graph. This is meant for the
+     *  models solved within another solver, which writes its output once, for its final schedule */
+    bool quiet;
+    
+    /*! Number of threads CPLEX may use, e.g. fewer than in the params when several models are solved at the same time */
+    unsigned int threads;
 
     /*! Basic constructor */
-    solver(data& d) : d{d}, t{times()} {};
+    solver(data& d) : d{d}, t{times()}, time_limit{static_cast<double>(d.p.cplex.time_limit)}, quiet{false}, threads{d.p.cplex.threads} {};
     
     /*! Solve the model and returns the generated paths (if the problem is feasible) or boost::none */
     auto solve() -> boost::optional<bv<path>>;
@@ -63,7 +73,7 @@ private:
     
     auto make_paths(IloEnv& env, IloCplex& cplex, var_matrix_4d& var_x, var_matrix_2d& var_excess_travel_time) -> bv<path>;
     
-    auto print_results(double ub_at_root, double ub_at_end, double lb_at_root, double lb_at_end) const -> void;
+    auto print_results(const bv<path>& paths, double ub_at_root, double ub_at_end, double lb_at_root, double lb_at_end) const -> void;
     auto print_summary(const bv<path>& paths) const -> void;
     auto print_graph(const bv<path>& paths) const -> void;
 };
@@ -0,0 +1,331 @@
+#include <solver/train_dp.h>
+#include <solver/dp_kernel.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+train_dp::layered_graph::layered_graph(const data& d, unsigned int train) {
+    const auto inf = std::numeric_limits<double>::infinity();
+    const auto i = train;
+    const auto tau = d.ns + 1;
+    const auto& v = d.gr.v.at(i);
+    const auto& adj = d.gr.adj.at(i);
+    const auto& costs = d.gr.costs.at(i);
+    
+    width = d.ns + 2;
+    first_arc = uint_vector(width + 1, 0u);
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        first_arc.at(s) = from.size();
+        
+        for(auto ss : d.gr.bar_inverse_delta.at(i).at(s)) {
+            from.push_back(static_cast<int>(ss));
+        }
+    }
+    
+    first_arc.at(tau) = from.size();
+    first_arc.at(width) = from.size();
+    
+    exists = bool_vector((d.ni + 2) * width, false);
+    stop_arc = double_vector((d.ni + 2) * width, inf);
+    move_arc = double_vector((d.ni + 2) * from.size(), inf);
+    tau_arc = double_vector((d.ni + 2) * width, inf);
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 1u; t <= d.ni; t++) {
+            exists.at(t * width + s) = v.at(s).at(t);
+            
+            if(adj.at(s).at(t - 1).at(s)) {
+                stop_arc.at(t * width + s) = costs.at(s).at(t - 1).at(s);
+            }
+            
+            if(adj.at(s).at(t).at(tau)) {
+                tau_arc.at(t * width + s) = costs.at(s).at(t).at(tau);
+            }
+            
+            for(auto k = first_arc.at(s); k < first_arc.at(s + 1); k++) {
+                auto ss = static_cast<unsigned int>(from.at(k));
+                
+                if(adj.at(ss).at(t - 1).at(s)) {
+                    move_arc.at(t * from.size() + k) = costs.at(ss).at(t - 1).at(s);
+                }
+            }
+        }
+    }
+}
+
+train_dp::train_dp(const data& d, unsigned int train) : train_dp(d, train, std::make_shared<const layered_graph>(d, train)) {}
+
+train_dp::train_dp(const data& d, unsigned int train, std::shared_ptr<const layered_graph> layers) : d{d}, train{train}, layers{layers}, priced_cost{0.0} {
+    occupancy_price = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    entry_price = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    exit_price = double_matrix_2d(d.ns + 2, double_vector(d.ni + 2, 0.0));
+    can_be_at = bool_matrix_2d(d.ns + 2, bool_vector(d.ni + 2, true));
+    can_enter = bool_matrix_2d(d.ns + 2, bool_vector(d.ni + 2, true));
+    can_exit = bool_matrix_2d(d.ns + 2, bool_vector(d.ni + 2, true));
+}
+
+auto train_dp::restrict_to(const occupancy& occ) -> void {
+    auto h = d.headway;
+    auto no_train = occupancy::no_train;
+    auto blocked = bool_matrix_2d(d.ns + 2, bool_vector(d.ni + 2, false));
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 0u; t <= d.ni + 1; t++) {
+            auto j = occ.train_at.at(s).at(t);
+            blocked.at(s).at(t) = (j != no_train && j != train);
+        }
+    }
+    
+    // A non-SA train cannot run on the main tracks of a siding around the time a heavy train enters it
+    if(!d.trn.is_sa.at(train)) {
+        for(auto sd : d.net.sidings) {
+            for(auto t = 1u; t <= d.ni; t++) {
+                auto j = occ.heavy_entering.at(sd).at(t);
+                
+                if(j == no_train || j == train) {
+                    continue;
+                }
+                
+                for(auto mm : d.net.main_tracks.at(sd)) {
+                    for(auto tt = (t > h ? t - h : 0u); tt <= std::min(t + h, d.ni + 1); tt++) {
+                        blocked.at(mm).at(tt) = true;
+                    }
+                }
+            }
+        }
+    }
+    
+    // Indexed over (s, t), number of blocked time intervals before t
+    auto n_blocked = uint_matrix_2d(d.ns + 2, uint_vector(d.ni + 3, 0u));
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 0u; t <= d.ni + 1; t++) {
+            n_blocked.at(s).at(t + 1) = n_blocked.at(s).at(t) + (blocked.at(s).at(t) ? 1u : 0u);
+        }
+    }
+    
+    auto any_blocked = [&] (unsigned int s, int from, int to) {
+        from = std::max(from, 0);
+        to = std::min(to, static_cast<int>(d.ni + 1));
+        return (from <= to && n_blocked.at(s).at(to + 1) > n_blocked.at(s).at(from));
+    };
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 0u; t <= d.ni + 1; t++) {
+            auto it = static_cast<int>(t);
+            
+            // Two trains in the same segment must be at least one headway apart
+            can_be_at.at(s).at(t) = !blocked.at(s).at(t);
+            can_enter.at(s).at(t) = !any_blocked(s, it - static_cast<int>(h), it - 1);
+            can_exit.at(s).at(t) = !any_blocked(s, it + 1, it + static_cast<int>(h));
+            
+            if(d.seg.type.at(s) == 'S' && can_enter.at(s).at(t)) {
+                auto from = (t > h ? t - h : 0u);
+                
+                can_enter.at(s).at(t) = occ.on_main_tracks(train, s, from, t + h, false) && !(d.trn.is_heavy.at(train) && occ.on_main_tracks(train, s, from, t + h, true));
+            }
+        }
+    }
+}
+
+auto train_dp::solve() -> boost::optional<bv<path::node>> {
+    const auto inf = std::numeric_limits<double>::infinity();
+    const auto i = train;
+    const auto tau = d.ns + 1;
+    const auto& gr = d.gr;
+    const auto& g = *layers;
+    const auto w = g.width;
+    const auto n_arcs = static_cast<unsigned int>(g.from.size());
+    const auto delay_price = d.pri.delay.at(d.trn.type.at(i));
+    
+    // Indexed over (t, s) as t * w + s, cheapest cost of being in s at time t, having spent at least the minimum travel time in s
+    auto best = double_vector((d.ni + 2) * w, inf);
+    
+    // Indexed over (t, s) as t * w + s, segment the train was in before entering s, or s itself if it was already in s at time t - 1
+    auto pred = uint_vector((d.ni + 2) * w, 0u);
+    
+    // Indexed over (t, s) as t * w + s, cheapest cost of entering s at time t from another segment, and that segment
+    auto enter = double_vector((d.ni + 2) * w, inf);
+    auto enter_pred = uint_vector((d.ni + 2) * w, 0u);
+    
+    // Indexed over (t, s) as t * w + s, cost of the stop arc from (s, t - 1) to (s, t) plus the occupancy price, or +infinity if the train cannot use it
+    auto stop_arc = double_vector((d.ni + 2) * w, inf);
+    
+    // Indexed over (t, s) as t * w + s, cost of the stop arcs from (s, 1) to (s, t), and number of missing ones among them
+    auto stop_cost = double_vector((d.ni + 2) * w, 0.0);
+    auto n_missing = uint_vector((d.ni + 2) * w, 0u);
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        for(auto t = 1u; t <= d.ni; t++) {
+            auto ok = g.stop_arc.at(t * w + s) < inf && can_be_at.at(s).at(t);
+            
+            if(ok) {
+                stop_arc.at(t * w + s) = g.stop_arc.at(t * w + s) + occupancy_price.at(s).at(t);
+            }
+            
+            stop_cost.at(t * w + s) = stop_cost.at((t - 1) * w + s) + (ok ? stop_arc.at(t * w + s) : 0.0);
+            n_missing.at(t * w + s) = n_missing.at((t - 1) * w + s) + (ok ? 0u : 1u);
+        }
+    }
+    
+    // Buffers for one layer
+    auto depart = double_vector(w, inf);
+    auto arrival = double_vector(n_arcs, inf);
+    auto stay = double_vector(w, inf);
+    auto move = double_vector(w, inf);
+    auto move_pred = uint_vector(w, 0u);
+    
+    for(auto t = 1u; t <= d.ni; t++) {
+        // Leave a segment at time t - 1 and enter another at time t
+        depart.at(0u) = 0.0;
+        
+        for(auto s = 1u; s <= d.ns; s++) {
+            depart.at(s) = (can_exit.at(s).at(t - 1) ? best.at((t - 1) * w + s) + exit_price.at(s).at(t - 1) : inf);
+        }
+        
+        if(n_arcs > 0u) {
+            dp_kernel::gather_arcs(depart.data(), g.from.data(), &g.move_arc.at(t * n_arcs), arrival.data(), n_arcs);
+        }
+        
+        for(auto s = 1u; s <= d.ns; s++) {
+            stay.at(s) = inf;
+            move.at(s) = inf;
+            
+            if(!g.exists.at(t * w + s) || !can_be_at.at(s).at(t)) {
+                continue;
+            }
+            
+            if(can_enter.at(s).at(t)) {
+                auto cost = inf;
+                auto ps = 0u;
+                
+                for(auto k = g.first_arc.at(s); k < g.first_arc.at(s + 1); k++) {
+                    if(arrival.at(k) < cost) {
+                        cost = arrival.at(k);
+                        ps = static_cast<unsigned int>(g.from.at(k));
+                    }
+                }
+                
+                if(cost < inf) {
+                    enter.at(t * w + s) = cost + entry_price.at(s).at(t) + occupancy_price.at(s).at(t);
+                    enter_pred.at(t * w + s) = ps;
+                }
+            }
+            
+            // Stay one more time interval: this is never allowed in a cross-over
+            if(d.seg.type.at(s) != 'X') {
+                stay.at(s) = stop_arc.at(t * w + s) + delay_price;
+            }
+            
+            // Enter s at time te and stay for exactly the minimum travel time
+            auto mtt = d.net.min_travel_time.at(i).at(s);
+            
+            if(t < mtt) {
+                continue;
+            }
+            
+            auto te = t + 1 - mtt;
+            
+            if(n_missing.at(t * w + s) == n_missing.at(te * w + s) && enter.at(te * w + s) < inf) {
+                move.at(s) = enter.at(te * w + s) + stop_cost.at(t * w + s) - stop_cost.at(te * w + s);
+                move_pred.at(s) = enter_pred.at(te * w + s);
+            }
+        }
+        
+        dp_kernel::relax_layer(&best.at((t - 1) * w), stay.data(), move.data(), move_pred.data(), &best.at(t * w), &pred.at(t * w), w);
+    }
+    
+    auto best_cost = inf;
+    auto best_s = 0u;
+    auto best_t = 0u;
+    
+    for(auto s = 1u; s <= d.ns; s++) {
+        // There is nothing after an escape arc, so there is no headway to respect
+        auto escape = (std::find(gr.bar_delta.at(i).at(s).begin(), gr.bar_delta.at(i).at(s).end(), tau) == gr.bar_delta.at(i).at(s).end());
+        
+        for(auto t = 1u; t <= d.ni; t++) {
+            if(best.at(t * w + s) == inf || g.tau_arc.at(t * w + s) == inf) {
+                continue;
+            }
+            
+            if(!escape && !can_exit.at(s).at(t)) {
+                continue;
+            }
+            
+            auto cost = best.at(t * w + s) + exit_price.at(s).at(t) + g.tau_arc.at(t * w + s);
+            
+            if(cost < best_cost) {
+                best_cost = cost;
+                best_s = s;
+                best_t = t;
+            }
+        }
+    }
+    
+    if(gr.adj.at(i).at(0).at(0).at(tau) && gr.costs.at(i).at(0).at(0).at(tau) < best_cost) {
+        // Dummy path!
+        priced_cost = gr.costs.at(i).at(0).at(0).at(tau);
+        return bv<path::node>({path::node(0u, 0u), path::node(tau, 1u)});
+    }
+    
+    if(best_cost == inf) {
+        return boost::none;
+    }
+    
+    auto reversed = bv<path::node>();
+    auto s = best_s;
+    auto t = best_t;
+    
+    reversed.push_back(path::node(tau, t + 1));
+    
+    while(true) {
+        auto ps = pred.at(t * w + s);
+        
+        if(ps == s) {
+            t--;
+            continue;
+        }
+        
+        auto te = t + 1 - d.net.min_travel_time.at(i).at(s);
+        
+        reversed.push_back(path::node(s, te));
+        
+        if(ps == 0u) {
+            reversed.push_back(path::node(0u, te - 1));
+            break;
+        }
+        
+        s = ps;
+        t = te - 1;
+    }
+    
+    priced_cost = best_cost;
+    
+    return bv<path::node>(reversed.rbegin(), reversed.rend());
+}
+
+auto train_dp::cost_of(const bv<path::node>& p) const -> double {
+    const auto i = train;
+    const auto& costs = d.gr.costs.at(i);
+    auto cost = 0.0;
+    
+    for(auto k = 0u; k + 1 < p.size(); k++) {
+        auto s = p.at(k).seg;
+        auto leaving_time = p.at(k + 1).t - 1;
+        
+        // Stop arcs
+        for(auto t = p.at(k).t; t < leaving_time; t++) {
+            cost += costs.at(s).at(t).at(s);
+        }
+        
+        cost += costs.at(s).at(leaving_time).at(p.at(k + 1).seg);
+        
+        if(s != 0u) {
+            cost += d.pri.delay.at(d.trn.type.at(i)) * (leaving_time + 1 - p.at(k).t - d.net.min_travel_time.at(i).at(s));
+        }
+    }
+    
+    return cost;
+}
@@ -0,0 +1,95 @@
+#ifndef TRAIN_DP_H
+#define TRAIN_DP_H
+
+#include <data/array.h>
+#include <data/data.h>
+#include <data/occupancy.h>
+#include <data/path.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+
+/*! \brief This class finds the cheapest path of a single train in its time-expanded graph by dynamic programming over time.
+ *  Besides the arc costs, the train pays the delay price for each time interval it spends in a segment over the minimum travel
+ *  time (it can never spend less, and it can never spend more in a cross-over) and some extra prices, e.g. lagrangian multipliers.
+ */
+struct train_dp {
+    /*! \brief The train's graph laid out one time layer after the other, as the dynamic programming reads it. Each layer is a
+     *  contiguous array over the segments, and the movement arcs between two layers are listed by head, with a gather table giving
+     *  their tails. Missing arcs cost +infinity. The layers only depend on the graph, so they can be shared by all the solves on it.
+     */
+    struct layered_graph {
+        /*! Length of a layer: ns + 2 */
+        unsigned int width;
+        
+        /*! Indexed over k, tail of the k-th movement arc: the arcs entering s are those from first_arc[s] to first_arc[s + 1] */
+        bv<int> from;
+        
+        /*! Indexed over s, first movement arc entering s */
+        uint_vector first_arc;
+        
+        /*! Indexed over (t, s) as t * width + s, tells wether the node (s, t) is in the graph */
+        bool_vector exists;
+        
+        /*! Indexed over (t, s) as t * width + s, cost of the stop arc from (s, t - 1) to (s, t) */
+        double_vector stop_arc;
+        
+        /*! Indexed over (t, k) as t * from.size() + k, cost of the k-th movement arc from layer t - 1 to layer t */
+        double_vector move_arc;
+        
+        /*! Indexed over (t, s) as t * width + s, cost of the arc from (s, t) to tau */
+        double_vector tau_arc;
+        
+        /*! Builds the layers of the train's graph */
+        layered_graph(const data& d, unsigned int train);
+    };
+    
+    /*! Reference to the data object */
+    const data& d;
+    
+    /*! Id of the train */
+    unsigned int train;
+    
+    /*! Layers of the train's graph */
+    std::shared_ptr<const layered_graph> layers;
+    
+    /*! Indexed over (s, t), is the extra price the train pays for being in segment s at time t */
+    double_matrix_2d occupancy_price;
+    
+    /*! Indexed over (s, t), is the extra price the train pays for entering segment s at time t from another segment */
+    double_matrix_2d entry_price;
+    
+    /*! Indexed over (s, t), is the extra price the train pays for leaving segment s at time t */
+    double_matrix_2d exit_price;
+    
+    /*! Indexed over (s, t), is true iff the train can be in segment s at time t */
+    bool_matrix_2d can_be_at;
+    
+    /*! Indexed over (s, t), is true iff the train can enter segment s at time t from another segment */
+    bool_matrix_2d can_enter;
+    
+    /*! Indexed over (s, t), is true iff the train can leave segment s at time t */
+    bool_matrix_2d can_exit;
+    
+    /*! Cost, including the extra prices, of the last path found by solve() */
+    double priced_cost;
+    
+    /*! Basic constructor: no extra prices and no restrictions other than the train's graph */
+    train_dp(const data& d, unsigned int train);
+    
+    /*! Constructor reusing the layers of the train's graph built for a previous solve */
+    train_dp(const data& d, unsigned int train, std::shared_ptr<const layered_graph> layers);
+    
+    /*! Forbids the train to conflict with the trains already in the occupancy table, i.e. to violate the headway with them,
+     *  to enter a siding when no train runs on its main tracks or, if heavy, when a non-SA train runs on them */
+    auto restrict_to(const occupancy& occ) -> void;
+    
+    /*! Returns the cheapest path, including the extra prices, or boost::none if the train has no feasible path */
+    auto solve() -> boost::optional<bv<path::node>>;
+    
+    /*! Cost of a path of the train, without the extra prices: this is the same cost the MIP solver gives the path */
+    auto cost_of(const bv<path::node>& p) const -> double;
+};
+
+#endif